@@ -60,6 +60,7 @@ typedef enum {
     CHKSUM_NONE                     = 1,
     CHKSUM_CRC32                    = 2,
     CHKSUM_MD5                      = 3,
+    CHKSUM_CRC32C                   = 4,    /* Castagnoli, hardware assisted */
     CHKSUM_TYPES_MAX,
 } ec_checksum_type_t;
 
@@ -88,6 +89,48 @@ struct ec_args {
     void *priv_args2;       /** flexible placeholder for
                               * future backend args */
     ec_checksum_type_t ct;  /* fragment checksum type */
+
+    uint64_t pool_max_bytes; /* bytes of fragment buffers the instance may
+                              * keep cached for reuse (optional, 0 disables
+                              * the buffer pool) */
+    int flags;              /* EC_ARGS_* instance options (optional) */
+    int num_threads;        /* worker threads that split large encodes,
+                              * decodes and reconstructs by column range
+                              * (optional, 0 runs them on the caller) */
+    int payload_align;      /* alignment of the fragment payloads the
+                              * library allocates: 16, 32, 64 or 4096
+                              * (optional, 0 means 16) */
+};
+
+/* ec_args.flags */
+#define EC_ARGS_POOL_PREFAULT   0x1     /* fault in new pool buffers up front */
+#define EC_ARGS_SLAB_ENCODE     0x2     /* one allocation per encoded stripe */
+
+/* Fragment buffer pool occupancy, see liberasurecode_get_pool_stats() */
+struct ec_pool_stats {
+    uint64_t max_bytes;         /* configured cap (ec_args.pool_max_bytes) */
+    uint64_t cached_bytes;      /* bytes parked in the pool for reuse */
+    uint64_t cached_buffers;    /* buffers parked in the pool for reuse */
+    uint64_t in_use_bytes;      /* bytes handed out and not returned yet */
+    uint64_t in_use_buffers;    /* buffers handed out and not returned yet */
+    uint64_t hits;              /* allocations served from the pool */
+    uint64_t misses;            /* allocations that went to the system */
+    uint64_t drops;             /* returned buffers released to the system */
+};
+
+/* Decode input handling, see liberasurecode_get_decode_stats() */
+struct ec_decode_stats {
+    uint64_t unaligned_in_place;    /* unaligned fragments used as passed in */
+    uint64_t unaligned_copies;      /* unaligned fragments copied to aligned
+                                     * buffers, for backends that need them */
+    uint64_t unaligned_copy_bytes;  /* bytes copied for those */
+};
+
+/* Part of a fragment, see liberasurecode_get_fragment_ranges() */
+struct ec_fragment_range {
+    int index;                  /* fragment index, -1 for any fragment */
+    uint64_t offset;            /* byte offset in the fragment, header included */
+    uint64_t length;            /* number of bytes */
 };
 
 /* =~=*=~==~=*=~== liberasurecode frontend API functions =~=*=~==~=~=*=~==~= */
@@ -116,15 +159,39 @@ int liberasurecode_backend_available(const ec_backend_id_t backend_id);
  *          w - word size, in bits
  *          hd - hamming distance (=m for Reed-Solomon)
  *          ct - fragment checksum type (stored with the fragment metadata)
+ *          pool_max_bytes - cap on cached fragment buffers (0 = no pool)
+ *          flags - EC_ARGS_* instance options
+ *          num_threads - worker threads per instance (0 = none)
+ *          payload_align - fragment payload alignment (0 = 16 bytes)
  *        backend-specific arguments
  *          null_args - arguments for the null backend
  *          flat_xor_hd, jerasure do not require any special args
  *      
  * @return liberasurecode instance descriptor (int > 0)
+ *
+ * Callers built against this header reach it through
+ * liberasurecode_instance_create_sized(), which also reads the ec_args
+ * fields added in 1.7.0 (pool_max_bytes onwards).  Binaries built
+ * against older headers call it directly and get the defaults for them.
  */
 int liberasurecode_instance_create(const ec_backend_id_t id,
                                    struct ec_args *args);
 
+/**
+ * Same as liberasurecode_instance_create(), reading args_size bytes of
+ * args: the caller's sizeof(struct ec_args).  Fields past args_size,
+ * unknown to the caller, take their defaults.
+ *
+ * @return liberasurecode instance descriptor (int > 0), -EINVALIDPARAMS
+ *         if args_size does not even cover ct
+ */
+int liberasurecode_instance_create_sized(const ec_backend_id_t id,
+                                         struct ec_args *args,
+                                         size_t args_size);
+
+#define liberasurecode_instance_create(id, args) \
+    liberasurecode_instance_create_sized((id), (args), sizeof(struct ec_args))
+
 /**
  * Close a liberasurecode instance
  *
@@ -149,6 +216,12 @@ int liberasurecode_instance_destroy(int desc);
  * @param fragment_len - pointer to _output_ length of each fragment, assuming
  *        all fragments are the same length
  *
+ * If the instance was created with EC_ARGS_SLAB_ENCODE, the two arrays and
+ * all k + m fragments share a single allocation, with the fragments in
+ * index order, each starting on a 64-byte boundary, so a stripe can be
+ * written out with one writev().  Release it with
+ * liberasurecode_encode_cleanup() as usual.
+ *
  * @return 0 on success, -error code otherwise
  */
 int liberasurecode_encode(int desc,
@@ -156,6 +229,32 @@ int liberasurecode_encode(int desc,
         char ***encoded_data, char ***encoded_parity,   /* output */
         uint64_t *fragment_len);                        /* output */
 
+/**
+ * Erasure encode data scattered over an iovec list
+ *
+ * Same as liberasurecode_encode(), except that the data fragments are
+ * filled straight from the iovec list, so the caller does not have to
+ * coalesce the segment into one contiguous buffer first.  The fragments
+ * are released with liberasurecode_encode_cleanup().
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param iov - list of buffers holding the data to encode, in order
+ * @param iovcnt - number of entries in iov
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_iov(int desc,
+        const struct iovec *iov, int iovcnt,            /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len);                        /* output */
+
 /**
  * Cleanup structures allocated by librasurecode_encode
  *
@@ -175,6 +274,77 @@ int liberasurecode_encode(int desc,
 int liberasurecode_encode_cleanup(int desc, char **encoded_data,
         char **encoded_parity);
 
+/**
+ * Erasure encode a data buffer into caller-provided fragment buffers
+ *
+ * Same as liberasurecode_encode(), except that headers and payloads are
+ * written straight into buffers owned by the caller, so nothing has to be
+ * allocated or handed back to liberasurecode_encode_cleanup().  Use
+ * liberasurecode_get_fragment_buffer_size() to size the buffers.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param encoded_data - array of k caller-owned buffers (char *) that
+ *        receive the data fragments, each 16-byte aligned
+ * @param encoded_parity - array of m caller-owned buffers (char *) that
+ *        receive the parity fragments, each 16-byte aligned
+ * @param fragment_buffer_len - size in bytes of each of the k + m buffers
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_into(int desc,
+        const char *orig_data, uint64_t orig_data_size, /* input */
+        char **encoded_data, char **encoded_parity,     /* output */
+        uint64_t fragment_buffer_len,                   /* input */
+        uint64_t *fragment_len);                        /* output */
+
+/**
+ * Erasure encode a batch of independent data buffers
+ *
+ * Same as calling liberasurecode_encode() on each object, but the
+ * per-call setup is paid once for the whole batch and all the stripes
+ * share one allocation, which matters for small objects.  Either every
+ * object is encoded or none is.  The stripes are released together with
+ * liberasurecode_encode_batch_cleanup(), not liberasurecode_encode_cleanup().
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_objects - number of objects to encode
+ * @param orig_data - array of num_objects data buffers to encode
+ * @param orig_data_size - array of num_objects data lengths
+ * @param encoded_data - _output_ array of num_objects (char **) arrays of
+ *        k data fragments (char *), allocated by the callee
+ * @param encoded_parity - _output_ array of num_objects (char **) arrays
+ *        of m parity fragments (char *), allocated by the callee
+ * @param fragment_len - _output_ array of num_objects fragment lengths
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_batch(int desc, int num_objects,
+        const char **orig_data, const uint64_t *orig_data_size, /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len);                        /* output */
+
+/**
+ * Cleanup the stripes allocated by liberasurecode_encode_batch
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_objects - number of objects passed to the encode
+ * @param encoded_data - array of data fragment arrays returned by
+ *        liberasurecode_encode_batch
+ * @param encoded_parity - array of parity fragment arrays returned by
+ *        liberasurecode_encode_batch
+ *
+ * @return 0 in success; -error otherwise
+ */
+int liberasurecode_encode_batch_cleanup(int desc, int num_objects,
+        char ***encoded_data, char ***encoded_parity);
+
 /**
  * Reconstruct original data from a set of k encoded fragments
  *
@@ -198,6 +368,176 @@ int liberasurecode_decode(int desc,
         int force_metadata_checks,                      /* input */
         char **out_data, uint64_t *out_data_len);       /* output */
 
+/**
+ * Reconstruct original data from a set of k encoded fragments into a
+ * caller-provided buffer
+ *
+ * Same as liberasurecode_decode(), except that the data fragments are
+ * reassembled (or decoded) straight into 'out_data', so no output buffer
+ * is allocated and liberasurecode_decode_cleanup() is not needed.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_data - caller buffer that receives the decoded data
+ * @param out_data_cap - size in bytes of out_data, must be at least the
+ *        original data size stored in the fragment headers
+ * @param out_data_len - _output_ length of decoded output
+ *
+ * @return 0 on success, -EINVALIDPARAMS if out_data_cap is too small,
+ *         -error code otherwise
+ */
+int liberasurecode_decode_into(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int force_metadata_checks,                      /* input */
+        char *out_data, uint64_t out_data_cap,          /* output */
+        uint64_t *out_data_len);                        /* output */
+
+/**
+ * Reconstruct a batch of independent objects
+ *
+ * Same as calling liberasurecode_decode() on each object, but the
+ * per-call setup is paid once for the whole batch and the decoded objects
+ * share one output allocation.  Either every object is decoded or none
+ * is.  The output is released with liberasurecode_decode_batch_cleanup().
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_objects - number of objects to decode
+ * @param available_fragments - array of num_objects arrays of erasure
+ *        encoded fragments (> = k each)
+ * @param num_fragments - array of num_objects fragment counts
+ * @param fragment_len - array of num_objects fragment lengths
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_data - _output_ array of num_objects pointers to decoded data
+ * @param out_data_len - _output_ array of num_objects decoded lengths
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_batch(int desc, int num_objects,
+        char ***available_fragments,                    /* input */
+        const int *num_fragments,                       /* input */
+        const uint64_t *fragment_len,                   /* input */
+        int force_metadata_checks,                      /* input */
+        char **out_data, uint64_t *out_data_len);       /* output */
+
+/**
+ * Cleanup the buffer allocated by liberasurecode_decode_batch
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_objects - number of objects passed to the decode
+ * @param out_data - array of decoded data pointers returned by
+ *        liberasurecode_decode_batch
+ *
+ * @return 0 on success; -error otherwise
+ */
+int liberasurecode_decode_batch_cleanup(int desc, int num_objects,
+        char **out_data);
+
+/**
+ * Reconstruct a byte range of the original data
+ *
+ * When the data fragments holding the range are available, only the
+ * slice of each is copied out.  Otherwise the backend decode is run on
+ * just the byte window of the fragments around the range, for backends
+ * whose codes work on independent byte columns, and on the whole
+ * fragments for the others.  Only the fragment headers and the parts
+ * reported by liberasurecode_get_fragment_ranges() are read, so the
+ * rest of each fragment buffer need not be filled in.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param offset - offset of the range in the original data
+ * @param length - length of the range
+ * @param out - caller buffer of at least length bytes
+ *
+ * @return 0 on success, -EINVALIDPARAMS if the range is past the end of
+ *         the data, -error code otherwise
+ */
+int liberasurecode_decode_range(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        uint64_t offset, uint64_t length,               /* input */
+        char *out);                                     /* output */
+
+/**
+ * Work out which fragment bytes are needed to decode a byte range
+ *
+ * Reports, for a range of an object (or segment) of orig_data_size
+ * bytes, the slice of each data fragment holding it.  If any of those
+ * fragments is unavailable, decode_window is the part needed from each
+ * of k available fragments instead.  The fragment headers are always
+ * needed as well.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data_size - size of the original data
+ * @param offset - offset of the range in the original data
+ * @param length - length of the range
+ * @param ranges - _output_ array of data fragment ranges
+ * @param num_ranges - capacity of ranges on input (k is always enough),
+ *        number of ranges used on output
+ * @param decode_window - _output_ range needed from any k fragments when
+ *        a data fragment in ranges is missing (index is -1)
+ *
+ * @return 0 on success, -EECMETHODNOTIMPL if the backend data fragments
+ *         do not hold the plaintext, -error code otherwise
+ */
+int liberasurecode_get_fragment_ranges(int desc,
+        uint64_t orig_data_size, uint64_t offset, uint64_t length,
+        struct ec_fragment_range *ranges, int *num_ranges,
+        struct ec_fragment_range *decode_window);
+
+/**
+ * Decode a set of fragments into an iovec view of the original data
+ *
+ * Instead of concatenating the payloads into a new buffer, the returned
+ * iovecs point straight into the data fragment payloads passed in (trimmed
+ * to the original data size), ready for writev()/sendmsg().  Only missing
+ * data fragments are rebuilt; the buffers holding them are handed back in
+ * 'decoded_fragments'.  The available fragments must stay valid for as
+ * long as the iovecs are in use.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param iov - _output_ array of at least k iovecs
+ * @param iovcnt - capacity of iov on input, number of iovecs used on output
+ * @param decoded_fragments - _output_ buffers backing rebuilt data (may be
+ *          NULL when nothing had to be rebuilt); caller invokes
+ *          liberasurecode_decode_iov_cleanup() once done with the iovecs
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_iov(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int force_metadata_checks,                      /* input */
+        struct iovec *iov, int *iovcnt,                 /* output */
+        char ***decoded_fragments);                     /* output */
+
+/**
+ * Cleanup buffers allocated by liberasurecode_decode_iov
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param decoded_fragments - buffers returned by liberasurecode_decode_iov
+ *
+ * @return 0 on success; -error otherwise
+ */
+int liberasurecode_decode_iov_cleanup(int desc, char **decoded_fragments);
+
 /**
  * Cleanup structures allocated by librasurecode_decode
  *
@@ -232,6 +572,28 @@ int liberasurecode_reconstruct_fragment(int desc,
         int destination_idx,                            /* input */
         char* out_fragment);                            /* output */
 
+/**
+ * Reconstruct several missing fragments from a subset of available
+ * fragments, in one pass over them where the backend supports it
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - size in bytes of the fragments
+ * @param destination_idxs - -1 terminated list of missing idxs to
+ *        reconstruct
+ * @param out_fragments - output buffers of fragment_len bytes, one per
+ *        entry of destination_idxs
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_reconstruct_fragments(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int *destination_idxs,                          /* input */
+        char **out_fragments);                          /* output */
+
 /**
  * Return a list of lists with valid rebuild indexes given
  * a list of missing indexes.
@@ -251,6 +613,79 @@ int liberasurecode_fragments_needed(int desc,
         int *fragments_to_exclude,
         int *fragments_needed);
 
+/* ==~=*=~==~=*=~==~=*=~==~= liberasurecode decode plans =~=*=~==~=*=~==~=*= */
+
+struct ec_decode_plan;
+
+/**
+ * Create a reusable decode plan
+ *
+ * A plan does the setup work of decoding a given set of available
+ * fragments (for the matrix backends, inverting the decoding matrix) once,
+ * so that rebuilding the same missing fragments across many stripes only
+ * pays for the arithmetic.  The plan must be destroyed before the
+ * liberasurecode instance.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_idx_bitmap - bit i set if fragment i will be passed in
+ *        (at least k bits set)
+ * @param wanted_idx_bitmap - missing fragments that
+ *        liberasurecode_reconstruct_with_plan() rebuilds
+ *
+ * @return plan on success, NULL on error
+ */
+struct ec_decode_plan *liberasurecode_plan_create(int desc,
+        uint64_t available_idx_bitmap, uint64_t wanted_idx_bitmap);
+
+/**
+ * Reconstruct original data with a plan, as liberasurecode_decode() does
+ *
+ * @param plan - plan from liberasurecode_plan_create()
+ * @param available_fragments - the fragments of the plan's available
+ *        bitmap, in any order
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_data - _output_ pointer to decoded data, freed with
+ *        liberasurecode_decode_cleanup()
+ * @param out_data_len - _output_ length of decoded output
+ *
+ * @return 0 on success, -EINVALIDPARAMS if the fragments do not match
+ *         the plan, -error code otherwise
+ */
+int liberasurecode_decode_with_plan(struct ec_decode_plan *plan,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int force_metadata_checks,                      /* input */
+        char **out_data, uint64_t *out_data_len);       /* output */
+
+/**
+ * Reconstruct the wanted fragments of a plan
+ *
+ * @param plan - plan from liberasurecode_plan_create()
+ * @param available_fragments - the fragments of the plan's available
+ *        bitmap, in any order
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - size in bytes of the fragments
+ * @param out_fragments - fragment_len sized output buffers, one per bit
+ *        of the wanted bitmap, lowest index first
+ *
+ * @return 0 on success, -EINVALIDPARAMS if the fragments do not match
+ *         the plan, -error code otherwise
+ */
+int liberasurecode_reconstruct_with_plan(struct ec_decode_plan *plan,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        char **out_fragments);                          /* output */
+
+/**
+ * Destroy a decode plan
+ *
+ * @param plan - plan from liberasurecode_plan_create()
+ */
+void liberasurecode_plan_destroy(struct ec_decode_plan *plan);
+
 
 /* ==~=*=~==~=*=~== liberasurecode fragment metadata routines ==~*==~=*=~==~ */
 
@@ -310,6 +745,25 @@ int is_invalid_fragment(int desc, char *fragment);
 int liberasurecode_verify_stripe_metadata(int desc,
         char **fragments, int num_fragments);
 
+/**
+ * Verify the payloads of a subset of fragments generated by encode()
+ * against their checksums.  The fragments are checked in parallel on the
+ * instance thread pool (see ec_args.num_threads) when it has one.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - fragments part of the EC stripe to verify
+ * @param num_fragments - number of fragments, at most 64
+ * @param bad_fragments - _output_ bitmap, bit i is set when fragments[i]
+ *        is damaged: NULL, bad header, or payload not matching its
+ *        checksum.  Fragments without a checksum only get their header
+ *        checked.
+ *
+ * @return 0 on success (whatever the bitmap says), -error code otherwise
+ */
+int liberasurecode_verify_stripe_payloads(int desc,
+        char **fragments, int num_fragments, uint64_t *bad_fragments);
+
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
 /**
@@ -377,6 +831,54 @@ int liberasurecode_get_minimum_encode_size(int desc);
  */
 int liberasurecode_get_fragment_size(int desc, int data_len);
 
+/**
+ * This will return the size of the buffer needed to hold one complete
+ * fragment (header included) when encoding data_len bytes, i.e. the
+ * per-fragment buffer size expected by liberasurecode_encode_into().
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data_len - original data length in bytes
+ *
+ * @return fragment buffer size - sizeof(fragment_header)
+ *                                + liberasurecode_get_fragment_size()
+ *                                if an error, return value will be negative
+ */
+int liberasurecode_get_fragment_buffer_size(int desc, int data_len);
+
+/**
+ * Report the occupancy of the instance's fragment buffer pool.
+ *
+ * Encode, decode and reconstruct draw their fragment and output buffers
+ * from the pool when the instance was created with a non-zero
+ * ec_args.pool_max_bytes; buffers given back through the matching
+ * *_cleanup() calls are kept for reuse up to that many bytes.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param stats - _output_ pool counters
+ *
+ * @return 0 on success, -EINVALIDPARAMS if the instance has no pool,
+ *         otherwise -error
+ */
+int liberasurecode_get_pool_stats(int desc, struct ec_pool_stats *stats);
+
+/**
+ * Report how decode and reconstruct dealt with fragments whose payload
+ * was not aligned to ec_args.payload_align (16 bytes by default).
+ *
+ * The flat_xor_hd, ISA-L and builtin rs_vand backends work on unaligned
+ * payloads in place; the others get an aligned copy of each such
+ * fragment first.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param stats - _output_ counters since the instance was created
+ *
+ * @return 0 on success, otherwise -error
+ */
+int liberasurecode_get_decode_stats(int desc, struct ec_decode_stats *stats);
+
 /**
  * This will return the liberasurecode version for the descriptor
  *
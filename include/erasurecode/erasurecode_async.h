@@ -0,0 +1,228 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode asynchronous submission API header
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#ifndef _ERASURECODE_ASYNC_H_
+#define _ERASURECODE_ASYNC_H_
+
+#include "erasurecode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Jobs submitted here run on a pool of worker threads owned by the
+ * library and shared by every instance.  The pool is started by the
+ * first submission.  Each worker has its own job queue; submissions are
+ * spread over the queues round robin and a worker whose queue runs dry
+ * steals the oldest job from the others, so a burst on one instance
+ * still spreads over every core.
+ *
+ * Buffers passed to a submit call, and the locations its results are
+ * written to, must stay valid until the job completes.  Destroying an
+ * instance waits for its submitted jobs; the ones that had not started
+ * yet complete with -EBACKENDNOTAVAIL.
+ */
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Pool configuration =*=~==~=*=~==~=*=~==~=*=~= */
+
+struct ec_async_config {
+    int num_threads;                /* workers, 0 = one per online CPU */
+    int max_jobs;                   /* jobs submitted and not yet completed,
+                                     * all instances (0 = no limit) */
+    int max_jobs_per_instance;      /* same, for any one instance (0 = no
+                                     * limit); keeps a busy instance from
+                                     * starving the others */
+};
+
+/**
+ * Configure the asynchronous worker pool
+ *
+ * The job limits apply from the next submission on.  num_threads is
+ * only read when the pool starts, so it has to be set before the first
+ * submission or after liberasurecode_async_shutdown().
+ *
+ * @param config - new settings
+ *
+ * @return 0 on success, -EINVALIDPARAMS on negative settings
+ */
+int liberasurecode_async_configure(const struct ec_async_config *config);
+
+/**
+ * Wait for every submitted job to complete and stop the worker pool
+ *
+ * Must not be called from a completion callback, nor while other threads
+ * may still submit jobs.  A later submission starts a new pool.
+ */
+void liberasurecode_async_shutdown(void);
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Completion queues =*=~==~=*=~==~=*=~==~=*=~== */
+
+struct ec_completion_queue;
+
+/* A completed job, as returned by ec_completion_queue_poll() */
+struct ec_async_completion {
+    void *user_data;                /* from the submission */
+    int ret;                        /* what the synchronous call returned */
+};
+
+/**
+ * Create a completion queue
+ *
+ * A completion queue collects the completions of the jobs submitted to
+ * it, to be picked up by ec_completion_queue_poll().  Its file descriptor
+ * (an eventfd where available) is readable whenever completions are
+ * waiting, so it can be watched from an event loop.
+ *
+ * @return completion queue on success, NULL on error
+ */
+struct ec_completion_queue *ec_completion_queue_create(void);
+
+/**
+ * Destroy a completion queue, dropping the completions not polled
+ *
+ * No job submitted to the queue may still be in flight.
+ *
+ * @param cq - completion queue from ec_completion_queue_create()
+ */
+void ec_completion_queue_destroy(struct ec_completion_queue *cq);
+
+/**
+ * File descriptor to watch for readability, owned by the queue
+ *
+ * @param cq - completion queue from ec_completion_queue_create()
+ */
+int ec_completion_queue_fd(struct ec_completion_queue *cq);
+
+/**
+ * Pick up completed jobs, without blocking
+ *
+ * @param cq - completion queue from ec_completion_queue_create()
+ * @param completions - _output_ array of max_completions completions
+ * @param max_completions - size of the completions array
+ *
+ * @return number of completions returned (0 if none are waiting),
+ *         -EINVALIDPARAMS on bad arguments
+ */
+int ec_completion_queue_poll(struct ec_completion_queue *cq,
+        struct ec_async_completion *completions, int max_completions);
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Job submission =*=~==~=*=~==~=*=~==~=*=~==~=*= */
+
+/**
+ * Called on a worker thread when a job completes
+ *
+ * The callback must not block for long, destroy the job's instance or
+ * shut the pool down.
+ *
+ * @param user_data - opaque argument from the submission
+ * @param ret - what the synchronous call returned
+ */
+typedef void (*ec_async_cb)(void *user_data, int ret);
+
+/* Where a job's completion goes: exactly one of cb and cq is set */
+struct ec_async_done {
+    ec_async_cb cb;                 /* called on the worker thread, or */
+    struct ec_completion_queue *cq; /* posted to this completion queue */
+    void *user_data;
+};
+
+/**
+ * Submit a liberasurecode_encode() call
+ *
+ * On completion, the encoded fragments are released with
+ * liberasurecode_encode_cleanup() as usual.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param encoded_data - _output_ pointer to encoded data array
+ * @param encoded_parity - _output_ pointer to encoded parity array
+ * @param fragment_len - _output_ length of each output fragment
+ * @param done - where to deliver the completion
+ *
+ * @return 0 if the job was queued, -EAGAIN if a job limit was reached,
+ *         -error code otherwise (the job is not queued and no
+ *         completion will be delivered)
+ */
+int liberasurecode_submit_encode(int desc,
+        const char *orig_data, uint64_t orig_data_size,
+        char ***encoded_data, char ***encoded_parity,
+        uint64_t *fragment_len, const struct ec_async_done *done);
+
+/**
+ * Submit a liberasurecode_decode() call
+ *
+ * On completion, the decoded data is released with
+ * liberasurecode_decode_cleanup() as usual.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_data - _output_ pointer to decoded data
+ * @param out_data_len - _output_ length of decoded output
+ * @param done - where to deliver the completion
+ *
+ * @return 0 if the job was queued, -EAGAIN if a job limit was reached,
+ *         -error code otherwise
+ */
+int liberasurecode_submit_decode(int desc,
+        char **available_fragments, int num_fragments,
+        uint64_t fragment_len, int force_metadata_checks,
+        char **out_data, uint64_t *out_data_len,
+        const struct ec_async_done *done);
+
+/**
+ * Submit a liberasurecode_reconstruct_fragment() call
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - size in bytes of the fragments
+ * @param destination_idx - missing idx to reconstruct
+ * @param out_fragment - output of reconstruct
+ * @param done - where to deliver the completion
+ *
+ * @return 0 if the job was queued, -EAGAIN if a job limit was reached,
+ *         -error code otherwise
+ */
+int liberasurecode_submit_reconstruct(int desc,
+        char **available_fragments, int num_fragments,
+        uint64_t fragment_len, int destination_idx, char *out_fragment,
+        const struct ec_async_done *done);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _ERASURECODE_ASYNC_H_
@@ -66,6 +66,12 @@ struct ec_backend_args {
 #define ISCOMPATIBLEWITH    is_compatible_with
 #define GETMETADATASIZE     get_backend_metadata_size
 #define GETENCODEOFFSET     get_encode_offset
+#define PLANCREATE      plan_create
+#define PLANDECODE      plan_decode
+#define PLANRECONSTRUCT plan_reconstruct
+#define PLANDESTROY     plan_destroy
+#define RECONSTRUCTMANY reconstruct_many
+#define ISUNALIGNEDSAFE is_unaligned_safe
 
 #define FN_NAME(s)      str(s)
 #define str(s)          #s
@@ -96,6 +102,35 @@ struct ec_backend_op_stubs {
 
     size_t (*GETMETADATASIZE)(void *desc, int blocksize);
     size_t (*GETENCODEOFFSET)(void *desc, int metadata_size);
+
+    /*
+     * Optional decode plans: the setup work (matrix inversion and the
+     * like) for one missing fragment pattern, done once and reused by
+     * every decode/reconstruct of that pattern.  PLANCREATE returning
+     * NULL makes the caller fall back to DECODE and RECONSTRUCT.
+     */
+    void * (*PLANCREATE)(void *desc, int *missing_idxs);
+    int (*PLANDECODE)(void *desc, void *plan,
+            char **data, char **parity, int blocksize);
+    int (*PLANRECONSTRUCT)(void *desc, void *plan,
+            char **data, char **parity, int destination_idx, int blocksize);
+    void (*PLANDESTROY)(void *desc, void *plan);
+
+    /*
+     * Optional: rebuild every fragment of the -1 terminated
+     * destination_idxs list in one call, sharing the decoding matrix
+     * setup.  Without it the caller runs RECONSTRUCT once per destination.
+     */
+    int (*RECONSTRUCTMANY)(void *desc,
+            char **data, char **parity, int *missing_idxs,
+            int *destination_idxs, int blocksize);
+
+    /*
+     * Optional: whether the loaded library takes payloads at any
+     * address.  Backends over a dlopen'd library answer per instance, as
+     * an older build of the library may still need aligned buffers.
+     */
+    bool (*ISUNALIGNEDSAFE)(void *desc);
 };
 
 /* ==~=*=~==~=*=~==~=*=~= backend struct definitions =~=*=~==~=*=~==~=*==~== */
@@ -128,8 +163,12 @@ typedef struct ec_backend {
 
     int                         idesc;              /* liberasurecode instance handle */
     struct ec_backend_desc      desc;               /* EC backend instance handle */
-
-    SLIST_ENTRY(ec_backend)     link;
+    struct ec_pool              *pool;              /* fragment buffer pool, or NULL */
+    struct ec_thread_pool       *threads;           /* column worker threads, or NULL */
+    int                         async_jobs;         /* submitted jobs not yet completed */
+    uint64_t                    unaligned_in_place; /* see struct ec_decode_stats */
+    uint64_t                    unaligned_copies;
+    uint64_t                    unaligned_copy_bytes;
 } *ec_backend_t;
 
 /* ~=*=~==~=*=~==~=*=~==~=*= frontend <-> backend API =*=~==~=*=~==~=*=~==~= */
@@ -158,10 +197,21 @@ ec_backend_t liberasurecode_backend_lookup_by_name(const char *name);
  * Look up a backend instance by descriptor
  *
  * Returns pointer to a registered liberasurecode instance
- * The caller must hold active_instances_rwlock
+ * The caller must ensure the instance is not destroyed concurrently
  */
 ec_backend_t liberasurecode_backend_instance_get_by_desc(int desc);
 
+/**
+ * Look up a backend instance by descriptor and take a reference on it,
+ * holding off liberasurecode_instance_destroy() until it is dropped
+ *
+ * Returns pointer to a registered liberasurecode instance, or NULL
+ */
+ec_backend_t liberasurecode_backend_instance_get(int desc);
+
+/* Drop a reference taken with liberasurecode_backend_instance_get() */
+void liberasurecode_backend_instance_put(ec_backend_t instance);
+
 /* Common function for backends */
 /**
  * A function to return 0 for generic usage on backends for get_encode_offset
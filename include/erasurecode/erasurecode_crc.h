@@ -0,0 +1,83 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode checksum kernels header
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#ifndef _ERASURECODE_CRC_H_
+#define _ERASURECODE_CRC_H_
+
+#include "erasurecode_stdinc.h"
+
+/*
+ * Plain CRC-32, bit for bit the same as zlib's crc32().  Folds with
+ * PCLMULQDQ when the CPU has it, slicing-by-8 otherwise, and hands off
+ * to ISA-L's crc32_gzip_refl() once an ISA-L backend has loaded it.
+ */
+uint32_t liberasurecode_crc32(uint32_t crc, const void *buf, size_t size);
+
+/* CRC-32 of A followed by B, from those of A and B and the length of B */
+uint32_t liberasurecode_crc32_combine(uint32_t crc1, uint32_t crc2,
+                                      size_t size2);
+
+/* Name of the CRC-32 implementation in use, for diagnostics */
+const char *liberasurecode_crc32_impl(void);
+
+/* Switch liberasurecode_crc32() over to ISA-L if it is loaded */
+void liberasurecode_crc32_probe_isal(void);
+
+/*
+ * CRC-32C (Castagnoli), as used by iSCSI, ext4 and friends.  Uses the
+ * SSE4.2 crc32 instruction when the CPU has it, slicing-by-8 tables
+ * otherwise; the choice is made on first use.  Chain calls by passing the
+ * previous result as crc, starting from 0.
+ */
+uint32_t liberasurecode_crc32c(uint32_t crc, const void *buf, size_t size);
+
+/* As liberasurecode_crc32_combine(), for CRC-32C */
+uint32_t liberasurecode_crc32c_combine(uint32_t crc1, uint32_t crc2,
+                                       size_t size2);
+
+/* Name of the CRC-32C implementation in use, for diagnostics */
+const char *liberasurecode_crc32c_impl(void);
+
+/*
+ * MD5, digest returned as the four little-endian state words (so the
+ * bytes of digest[] on a little-endian host are the usual 16-byte digest).
+ */
+void liberasurecode_md5(const void *buf, size_t size, uint32_t digest[4]);
+
+/*
+ * MD5 of nbufs equal-length buffers at once, several per SIMD register
+ * (eight lanes with AVX2, four otherwise).  Meant for the k + m fragments
+ * of a stripe.
+ */
+void liberasurecode_md5_mb(const void **bufs, int nbufs, size_t size,
+                           uint32_t (*digests)[4]);
+
+/* Name of the multi-buffer MD5 engine in use, for diagnostics */
+const char *liberasurecode_md5_impl(void);
+
+#endif  // _ERASURECODE_CRC_H_
@@ -90,6 +90,8 @@ void *alloc_zeroed_buffer(int size);
 void *alloc_and_set_buffer(int size, int value);
 void *check_and_free_buffer(void *buf);
 void *get_aligned_buffer16(int size);
+void *get_aligned_buffer(int size, int alignment);
+void *get_aligned_buffer_uninit(int size, int alignment);
 
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
@@ -46,6 +46,36 @@ void init_fragment_header(char *buf)
 
 char *alloc_fragment_buffer(int size);
 int free_fragment_buffer(char *buf);
+void *instance_alloc_buffer(ec_backend_t instance, int size);
+void *instance_alloc_buffer_uninit(ec_backend_t instance, int size);
+char *instance_alloc_fragment_buffer(ec_backend_t instance, int size);
+char *instance_alloc_fragment_buffer_uninit(ec_backend_t instance, int size);
+int instance_payload_align(ec_backend_t instance);
+void instance_free_buffer(ec_backend_t instance, void *buf);
+bool is_backend_column_independent(ec_backend_t instance);
+bool is_backend_unaligned_capable(ec_backend_t instance);
+bool is_backend_parity_overwriting(ec_backend_t instance);
+int instance_backend_encode(ec_backend_t instance,
+        char **data, char **parity, int blocksize);
+int instance_backend_encode_tiled(ec_backend_t instance,
+        const struct iovec *iov, int iovcnt, uint64_t orig_data_size,
+        char **data, char **parity, int blocksize, uint32_t *chksums);
+int instance_backend_decode(ec_backend_t instance,
+        char **data, char **parity, int *missing_idxs, int blocksize);
+int instance_backend_decode_plan(ec_backend_t instance, void *plan,
+        char **data, char **parity, int *missing_idxs, int blocksize);
+int instance_backend_reconstruct(ec_backend_t instance,
+        char **data, char **parity, int *missing_idxs, int destination_idx,
+        int blocksize);
+int instance_backend_reconstruct_plan(ec_backend_t instance, void *plan,
+        char **data, char **parity, int *missing_idxs, int destination_idx,
+        int blocksize);
+int instance_backend_reconstruct_many(ec_backend_t instance, void *plan,
+        char **data, char **parity, int *missing_idxs, int *destination_idxs,
+        int blocksize);
+int instance_payload_checksums(ec_backend_t instance, ec_checksum_type_t ct,
+        const void **payloads, const uint32_t *sizes, int num_payloads,
+        uint32_t (*digests)[4]);
 int get_aligned_data_size(ec_backend_t instance, int data_len);
 char *get_data_ptr_from_fragment(char *buf);
 int get_data_ptr_array_from_fragments(char **data_array, char **fragments,
@@ -65,6 +95,8 @@ int get_fragment_buffer_size(char *buf);
 int set_orig_data_size(char *buf, int orig_data_size);
 int get_orig_data_size(char *buf);
 int set_checksum(ec_checksum_type_t ct, char *buf, int blocksize);
+int set_stripe_checksums(ec_backend_t instance, ec_checksum_type_t ct,
+        char **fragments, int num_fragments, int blocksize);
 int get_checksum(char *buf);
 int set_libec_version(char *fragment);
 int get_libec_version(char *fragment, uint32_t *ver);
@@ -0,0 +1,54 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode fragment buffer pool header
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#ifndef _ERASURECODE_POOL_H_
+#define _ERASURECODE_POOL_H_
+
+#include "erasurecode.h"
+#include "erasurecode_stdinc.h"
+
+/*
+ * Per-instance cache of fragment sized buffers.
+ *
+ * Buffers are binned into size classes (four per power of two, from 4 KiB
+ * up to 256 MiB) and parked on free lists sharded by calling thread, so
+ * that threads working on the same instance rarely contend.  Buffers
+ * handed out by the pool are 64-byte aligned and must be returned with
+ * ec_pool_free(), never free().
+ */
+struct ec_pool;
+
+struct ec_pool *ec_pool_create(uint64_t max_bytes, int prefault);
+void ec_pool_destroy(struct ec_pool *pool);
+
+void *ec_pool_alloc(struct ec_pool *pool, uint64_t size, int zero);
+void ec_pool_free(struct ec_pool *pool, void *buf);
+
+void ec_pool_get_stats(struct ec_pool *pool, struct ec_pool_stats *stats);
+
+#endif  // _ERASURECODE_POOL_H_
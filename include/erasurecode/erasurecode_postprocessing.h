@@ -33,6 +33,10 @@ int finalize_fragments_after_encode(ec_backend_t instance,
         int k, int m, int blocksize,  uint64_t orig_data_size,
         char **encoded_data, char **encoded_parity);
 
+int finalize_fragments_after_encode_chksums(ec_backend_t instance,
+        int k, int m, int blocksize, uint64_t orig_data_size,
+        char **encoded_data, char **encoded_parity, const uint32_t *chksums);
+
 void add_fragment_metadata(ec_backend_t instance, char *fragment,
         int idx, uint64_t orig_data_size, int blocksize,
         ec_checksum_type_t ct, int add_chksum);
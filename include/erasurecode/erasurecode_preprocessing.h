@@ -36,7 +36,62 @@ int prepare_fragments_for_encode(
         char **encoded_data, char **encoded_parity,     /* output */
         int *blocksize);
 
+int prepare_fragments_for_encode_iov(
+        ec_backend_t instance,
+        int k, int m,
+        const struct iovec *iov, int iovcnt,            /* input */
+        uint64_t orig_data_size,                        /* input */
+        char **encoded_data, char **encoded_parity,     /* output */
+        int *blocksize);
+
+int prepare_fragments_for_encode_tiled(
+        ec_backend_t instance,
+        int k, int m,
+        uint64_t orig_data_size,                        /* input */
+        char **encoded_data, char **encoded_parity,     /* output */
+        int *blocksize);
+
+int prepare_fragments_for_encode_into(
+        ec_backend_t instance,
+        int k, int m,
+        const char *orig_data, uint64_t orig_data_size, /* input */
+        char **encoded_data, char **encoded_parity,     /* input/output */
+        int *blocksize);
+
+int prepare_fragments_for_encode_into_iov(
+        ec_backend_t instance,
+        int k, int m,
+        const struct iovec *iov, int iovcnt,            /* input */
+        uint64_t orig_data_size,                        /* input */
+        char **encoded_data, char **encoded_parity,     /* input/output */
+        int *blocksize);
+
+/* Alignment of each fragment in an encode slab */
+#define EC_SLAB_ALIGN   64
+
+int prepare_fragments_for_encode_slab(
+        ec_backend_t instance,
+        int k, int m,
+        const struct iovec *iov, int iovcnt,            /* input */
+        uint64_t orig_data_size,                        /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        int *blocksize);
+
+void free_encode_slab(
+        ec_backend_t instance, int k,
+        char **encoded_data, char **encoded_parity);
+
+int prepare_fragments_for_encode_batch(
+        ec_backend_t instance,
+        int k, int m, int num_objects,
+        const char **orig_data, const uint64_t *orig_data_size, /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        int *blocksizes);
+
+bool keep_unaligned_fragment(ec_backend_t instance, int fragment_size);
+
 int prepare_fragments_for_decode(
+        ec_backend_t instance,
         int k, int m,
         char **data, char **parity,
         int *missing_idxs,
@@ -50,8 +105,14 @@ int get_fragment_partition(
         int *missing);
 
 int fragments_to_string(
+        ec_backend_t instance,
         int k, int m,
         char **fragments, int num_fragments,
         char **orig_payload, uint64_t *payload_len);
 
+int fragments_to_buffer(
+        int k, int m,
+        char **fragments, int num_fragments,
+        char *out, uint64_t out_len, uint64_t *payload_len);
+
 #endif
@@ -96,10 +96,25 @@
 #define rwlock_trywrlock pthread_rwlock_trywrlock
 #define rwlock_unlock pthread_rwlock_unlock
 #define rwlock_destroy pthread_rwlock_destroy
+#define mutex_t pthread_mutex_t
+#define mutex_init(m) pthread_mutex_init((m), NULL)
+#define mutex_lock pthread_mutex_lock
+#define mutex_trylock pthread_mutex_trylock
+#define mutex_unlock pthread_mutex_unlock
+#define mutex_destroy pthread_mutex_destroy
+#define cond_t pthread_cond_t
+#define cond_init(c) pthread_cond_init((c), NULL)
+#define cond_wait pthread_cond_wait
+#define cond_signal pthread_cond_signal
+#define cond_broadcast pthread_cond_broadcast
+#define cond_destroy pthread_cond_destroy
 #endif
 #ifdef HAVE_ERRNO_H
 # include <errno.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
 
 #if defined(__GNUC__) && __GNUC__ >= 4
 # define DECLSPEC	__attribute__ ((visibility("default")))
@@ -0,0 +1,168 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode streaming segment encoder/decoder API header
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#ifndef _ERASURECODE_STREAM_H_
+#define _ERASURECODE_STREAM_H_
+
+#include "erasurecode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Streaming encoder =*=~==~=*=~==~=*=~==~=*=~== */
+
+struct ec_stream_encoder;
+
+/**
+ * Called once per encoded segment
+ *
+ * The fragments live in one of the encoder's two stripe buffers.  They
+ * stay valid while the following segment is encoded into the other
+ * buffer, up to the callback for segment_idx + 2, so the caller can
+ * still be shipping segment N while segment N + 1 is encoded.
+ *
+ * @param arg - opaque argument given to ec_stream_encoder_create()
+ * @param segment_idx - index of the segment, counting from 0
+ * @param encoded_data - array of k data fragments
+ * @param encoded_parity - array of m parity fragments
+ * @param fragment_len - length of each fragment
+ *
+ * @return 0 to carry on, -error to abort the feed/flush in progress
+ */
+typedef int (*ec_stream_encoder_cb)(void *arg, uint64_t segment_idx,
+        char **encoded_data, char **encoded_parity, uint64_t fragment_len);
+
+/**
+ * Create a streaming encoder
+ *
+ * Data fed to the encoder is cut into segments of segment_size bytes,
+ * each encoded as if passed to liberasurecode_encode().  Buffer sizing
+ * and allocation are done once here and reused for every segment.  The
+ * encoder must be destroyed before the liberasurecode instance.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param segment_size - size in bytes of every segment but the last
+ * @param cb - callback receiving each encoded segment
+ * @param cb_arg - opaque argument passed to cb
+ *
+ * @return encoder on success, NULL on error
+ */
+struct ec_stream_encoder *ec_stream_encoder_create(int desc,
+        uint64_t segment_size, ec_stream_encoder_cb cb, void *cb_arg);
+
+/**
+ * Feed data to a streaming encoder
+ *
+ * Any number of bytes may be fed at a time; every segment completed by
+ * this call is encoded and handed to the callback before it returns.
+ *
+ * @param encoder - encoder from ec_stream_encoder_create()
+ * @param data - data to encode
+ * @param len - length of data
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int ec_stream_encoder_feed(struct ec_stream_encoder *encoder,
+        const char *data, uint64_t len);
+
+/**
+ * Encode whatever data is buffered as a final, short segment
+ *
+ * @param encoder - encoder from ec_stream_encoder_create()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int ec_stream_encoder_flush(struct ec_stream_encoder *encoder);
+
+/**
+ * Destroy a streaming encoder, dropping any data not flushed
+ *
+ * @param encoder - encoder from ec_stream_encoder_create()
+ */
+void ec_stream_encoder_destroy(struct ec_stream_encoder *encoder);
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Streaming decoder =*=~==~=*=~==~=*=~==~=*=~== */
+
+struct ec_stream_decoder;
+
+/**
+ * Create a streaming decoder
+ *
+ * The decoder reassembles an object one segment at a time, as encoded by
+ * liberasurecode_encode() or a streaming encoder with the same
+ * segment_size.  Decoded segments are written to a ring of ring_size
+ * output buffers allocated here, and the scratch buffers used to rebuild
+ * missing fragments are reused from one segment to the next.  The
+ * decoder must be destroyed before the liberasurecode instance.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param segment_size - largest original segment size, in bytes
+ * @param ring_size - number of output buffers in the ring (> = 1)
+ *
+ * @return decoder on success, NULL on error
+ */
+struct ec_stream_decoder *ec_stream_decoder_create(int desc,
+        uint64_t segment_size, int ring_size);
+
+/**
+ * Decode the next segment from a set of its fragments
+ *
+ * The decoded data is written to the next buffer of the ring and stays
+ * valid for the next ring_size - 1 calls.  As long as the same fragment
+ * indexes are passed in, the missing fragment pattern worked out for the
+ * previous segment is reused, and so is the backend decode plan (the
+ * inverted decoding matrix) for as long as the same fragments are missing.
+ *
+ * @param decoder - decoder from ec_stream_decoder_create()
+ * @param fragments - erasure encoded fragments of the segment (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param out_data - _output_ pointer to the decoded segment
+ * @param out_data_len - _output_ length of the decoded segment
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int ec_stream_decoder_feed(struct ec_stream_decoder *decoder,
+        char **fragments, int num_fragments, uint64_t fragment_len,
+        char **out_data, uint64_t *out_data_len);
+
+/**
+ * Destroy a streaming decoder, including its ring of output buffers
+ *
+ * @param decoder - decoder from ec_stream_decoder_create()
+ */
+void ec_stream_decoder_destroy(struct ec_stream_decoder *decoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _ERASURECODE_STREAM_H_
@@ -0,0 +1,53 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode worker thread pool header
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#ifndef _ERASURECODE_THREADPOOL_H_
+#define _ERASURECODE_THREADPOOL_H_
+
+#include "erasurecode_stdinc.h"
+
+/*
+ * Per-instance pool of worker threads.
+ *
+ * ec_thread_pool_run() is a parallel for: it splits a job into ntasks
+ * tasks, runs them on the workers and on the calling thread, and returns
+ * once all of them are done.  Several threads may run jobs on the same
+ * pool at once; idle workers help whichever job is queued first.
+ */
+struct ec_thread_pool;
+
+typedef void (*ec_thread_task_fn)(void *arg, int task);
+
+struct ec_thread_pool *ec_thread_pool_create(int num_threads);
+void ec_thread_pool_destroy(struct ec_thread_pool *pool);
+
+int ec_thread_pool_size(struct ec_thread_pool *pool);
+void ec_thread_pool_run(struct ec_thread_pool *pool, int ntasks,
+        ec_thread_task_fn fn, void *arg);
+
+#endif  // _ERASURECODE_THREADPOOL_H_
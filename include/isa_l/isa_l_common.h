@@ -29,6 +29,9 @@
 
 #define ISA_L_W 8
 
+/* Decode tables kept per instance, see isa_l_get_decode_tables() */
+#define ISA_L_DECODE_TABLES_CACHED 16
+
 /* Forward declarations */
 typedef void (*ec_encode_data_func)(int, int, int, unsigned char*, unsigned char **, unsigned char **);
 typedef void (*ec_init_tables_func)(int, int, unsigned char*, unsigned char *);
@@ -36,6 +39,18 @@ typedef void (*gf_gen_encoding_matrix_func)(unsigned char*, int, int);
 typedef int (*gf_invert_matrix_func)(unsigned char*, unsigned char*, const int);
 typedef unsigned char (*gf_mul_func)(unsigned char, unsigned char);
 
+/*
+ * Expanded ec_encode_data() tables that rebuild the fragments of one
+ * missing index pattern, or only the wanted ones for a reconstruct
+ */
+typedef struct {
+    uint64_t missing_bm;
+    uint64_t wanted_bm;         /* rows, in index order */
+    int refs;                   /* cache slot + calls using the tables */
+    uint64_t last_used;         /* LRU clock stamp */
+    unsigned char g_tbls[];     /* k * rows * 32 bytes */
+} isa_l_decode_tables;
+
 typedef struct {
     /* calls required for init */
     ec_init_tables_func ec_init_tables;
@@ -56,6 +71,11 @@ typedef struct {
     int k;
     int m;
     int w;
+
+    /* LRU cache of decode tables, by missing and wanted patterns */
+    mutex_t decode_tables_lock;
+    isa_l_decode_tables *decode_tables[ISA_L_DECODE_TABLES_CACHED];
+    uint64_t decode_tables_clock;
 } isa_l_descriptor;
 
 int isa_l_encode(void *desc, char **data, char **parity, int blocksize);
@@ -63,6 +83,14 @@ int isa_l_decode(void *desc, char **data, char **parity, int *missing_idxs,
         int blocksize);
 int isa_l_reconstruct(void *desc, char **data, char **parity,
         int *missing_idxs, int destination_idx, int blocksize);
+int isa_l_reconstruct_many(void *desc, char **data, char **parity,
+        int *missing_idxs, int *destination_idxs, int blocksize);
+void * isa_l_plan_create(void *desc, int *missing_idxs);
+int isa_l_plan_decode(void *desc, void *plan, char **data, char **parity,
+        int blocksize);
+int isa_l_plan_reconstruct(void *desc, void *plan, char **data,
+        char **parity, int destination_idx, int blocksize);
+void isa_l_plan_destroy(void *desc, void *plan);
 int isa_l_min_fragments(void *desc, int *missing_idxs,
         int *fragments_to_exclude, int *fragments_needed);
 int isa_l_element_size(void* desc);
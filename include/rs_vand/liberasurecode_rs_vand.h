@@ -42,3 +42,8 @@ int is_identity_matrix(int *matrix, int n);
 int liberasurecode_rs_vand_encode(int *generator_matrix, char **data, char **parity, int k, int m, int blocksize);
 int liberasurecode_rs_vand_decode(int *generator_matrix, char **data, char **parity, int k, int m, int *missing, int blocksize, int rebuild_parity);
 int liberasurecode_rs_vand_reconstruct(int *generator_matrix, char **data, char **parity, int k, int m, int *missing, int destination_idx, int blocksize);
+void *liberasurecode_rs_vand_plan_create(int *generator_matrix, int k, int m, int *missing);
+void liberasurecode_rs_vand_plan_free(void *plan);
+int liberasurecode_rs_vand_decode_plan(void *plan, char **data, char **parity, int blocksize);
+int liberasurecode_rs_vand_reconstruct_plan(void *plan, char **data, char **parity, int destination_idx, int blocksize);
+int liberasurecode_rs_vand_unaligned_safe(void);
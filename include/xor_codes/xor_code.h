@@ -77,6 +77,8 @@ void fast_memcpy(char *dst, char *src, int size);
 
 void xor_bufs_and_store(char *buf1, char *buf2, int blocksize);
 
+int xor_code_unaligned_safe(void);
+
 void xor_code_encode(xor_code_t *code_desc, char **data, char **parity, int blocksize);
 
 void selective_encode(xor_code_t *code_desc, char **data, char **parity, int *missing_parity, int blocksize);
@@ -32,6 +32,7 @@
 
 #include "erasurecode.h"
 #include "erasurecode_backend.h"
+#include "erasurecode_crc.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
 #include "isa_l_common.h"
@@ -176,34 +177,35 @@ static unsigned char* get_inverse_rows(int k,
     return inverse_rows;
 }
 
-int isa_l_decode(void *desc, char **data, char **parity,
-        int *missing_idxs, int blocksize)
+/*
+ * Build the ec_encode_data() tables that rebuild the wanted_bm subset of
+ * the missing fragments from the first k available fragments
+ */
+static isa_l_decode_tables *isa_l_build_decode_tables(
+        isa_l_descriptor *isa_l_desc, int *missing_idxs,
+        uint64_t missing_bm, uint64_t wanted_bm)
 {
-    isa_l_descriptor *isa_l_desc = (isa_l_descriptor*)desc;
-
-    unsigned char *g_tbls = NULL;
+    isa_l_decode_tables *tables = NULL;
     unsigned char *decode_matrix = NULL;
     unsigned char *decode_inverse = NULL;
     unsigned char *inverse_rows = NULL;
-    unsigned char **decoded_elements = NULL;
-    unsigned char **available_fragments = NULL;
     int k = isa_l_desc->k;
     int m = isa_l_desc->m;
     int n = k + m;
-    int ret = -1;
-    int i, j;
+    int rows = 0;
+    int row = 0;
+    int i;
 
-    int num_missing_elements = get_num_missing_elements(missing_idxs);
-    uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
+    if (0 == wanted_bm || (wanted_bm & ~missing_bm)) {
+        goto out;
+    }
 
     decode_matrix = isa_l_get_decode_matrix(k, m, isa_l_desc->matrix, missing_idxs);
-
     if (NULL == decode_matrix) {
         goto out;
     }
 
     decode_inverse = (unsigned char*)malloc(sizeof(unsigned char) * k * k);
-
     if (NULL == decode_inverse) {
         goto out;
     }
@@ -213,138 +215,171 @@ int isa_l_decode(void *desc, char **data, char **parity,
         goto out;
     }
 
-    // Generate g_tbls from computed decode matrix (k x k) matrix
-    g_tbls = malloc(sizeof(unsigned char) * (k * m * 32));
-    if (NULL == g_tbls) {
-        goto out;
-    }
-
     inverse_rows = get_inverse_rows(k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, isa_l_desc->gf_mul);
-
-    decoded_elements = (unsigned char**)malloc(sizeof(unsigned char*)*num_missing_elements);
-    if (NULL == decoded_elements) {
-        goto out;
-    }
-
-    available_fragments = (unsigned char**)malloc(sizeof(unsigned char*)*k);
-    if (NULL == available_fragments) {
+    if (NULL == inverse_rows) {
         goto out;
     }
 
-    j = 0;
+    /*
+     * Inverse rows are in missing index order, keep the wanted ones
+     * (packed in place, a row never moves up past itself)
+     */
     for (i = 0; i < n; i++) {
-        if (missing_bm & (1 << i)) {
+        if (!(missing_bm & (1ULL << i))) {
             continue;
         }
-        if (j == k) {
-            break;
-        }
-        if (i < k) {
-            available_fragments[j] = (unsigned char*)data[i];
-        } else {
-            available_fragments[j] = (unsigned char*)parity[i-k];
+        if (wanted_bm & (1ULL << i)) {
+            memmove(&inverse_rows[rows * k], &inverse_rows[row * k], k);
+            rows++;
         }
-        j++;
+        row++;
     }
 
-    // Grab pointers to memory needed for missing data fragments
-    j = 0;
-    for (i = 0; i < k; i++) {
-        if (missing_bm & (1 << i)) {
-            decoded_elements[j] = (unsigned char*)data[i];
-            j++;
-        }
-    }
-    for (i = k; i < n; i++) {
-        if (missing_bm & (1 << i)) {
-            decoded_elements[j] = (unsigned char*)parity[i - k];
-            j++;
-        }
+    // Generate g_tbls from computed decode matrix (k x k) matrix
+    tables = malloc(sizeof(*tables) + (k * rows * 32));
+    if (NULL == tables) {
+        goto out;
     }
+    tables->missing_bm = missing_bm;
+    tables->wanted_bm = wanted_bm;
+    tables->refs = 1;
+    tables->last_used = 0;
 
-    isa_l_desc->ec_init_tables(k, num_missing_elements, inverse_rows, g_tbls);
-
-    isa_l_desc->ec_encode_data(blocksize, k, num_missing_elements, g_tbls, (unsigned char**)available_fragments,
-                               (unsigned char**)decoded_elements);
-
-    ret = 0;
+    isa_l_desc->ec_init_tables(k, rows, inverse_rows, tables->g_tbls);
 
 out:
-    free(g_tbls);
     free(decode_matrix);
     free(decode_inverse);
     free(inverse_rows);
-    free(decoded_elements);
-    free(available_fragments);
 
-    return ret;
+    return tables;
 }
 
-int isa_l_reconstruct(void *desc, char **data, char **parity,
-        int *missing_idxs, int destination_idx, int blocksize)
+/* Look a pattern up in the decode tables cache, lock held */
+static isa_l_decode_tables *isa_l_find_decode_tables(
+        isa_l_descriptor *isa_l_desc, uint64_t missing_bm,
+        uint64_t wanted_bm)
 {
-    isa_l_descriptor *isa_l_desc = (isa_l_descriptor*) desc;
-    unsigned char *g_tbls = NULL;
-    unsigned char *decode_matrix = NULL;
-    unsigned char *decode_inverse = NULL;
-    unsigned char *inverse_rows = NULL;
-    unsigned char *reconstruct_buf = NULL;
-    unsigned char **available_fragments = NULL;
-    int k = isa_l_desc->k;
-    int m = isa_l_desc->m;
-    int n = k + m;
-    int ret = -1;
-    int i, j;
-    uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
-    int inverse_row = -1;
-
-    /**
-     * Get available elements and compute the inverse of their
-     * corresponding rows.
-     */
-    decode_matrix = isa_l_get_decode_matrix(k, m, isa_l_desc->matrix, missing_idxs);
+    isa_l_decode_tables *tables;
+    int i;
 
-    if (NULL == decode_matrix) {
-        goto out;
+    for (i = 0; i < ISA_L_DECODE_TABLES_CACHED; i++) {
+        tables = isa_l_desc->decode_tables[i];
+        if (NULL != tables && tables->missing_bm == missing_bm &&
+                tables->wanted_bm == wanted_bm) {
+            tables->refs++;
+            tables->last_used = ++isa_l_desc->decode_tables_clock;
+            return tables;
+        }
     }
 
-    decode_inverse = (unsigned char*)malloc(sizeof(unsigned char) * k * k);
+    return NULL;
+}
 
-    if (NULL == decode_inverse) {
-        goto out;
+/* Drop a reference on decode tables, freeing them once unused */
+static void isa_l_put_decode_tables(isa_l_descriptor *isa_l_desc,
+        isa_l_decode_tables *tables)
+{
+    int refs;
+
+    mutex_lock(&isa_l_desc->decode_tables_lock);
+    refs = --tables->refs;
+    mutex_unlock(&isa_l_desc->decode_tables_lock);
+
+    if (0 == refs) {
+        free(tables);
     }
+}
 
-    int im_ret = isa_l_desc->gf_invert_matrix(decode_matrix, decode_inverse, k);
-    if (im_ret < 0) {
-        goto out;
+/*
+ * Return decode tables for a missing pattern, from the per instance LRU
+ * cache when a previous call built them.  In a degraded cluster the same
+ * few patterns come up over and over, and the matrix inversion and table
+ * expansion cost more than the decode of a small object.
+ *
+ * Release with isa_l_put_decode_tables().
+ */
+static isa_l_decode_tables *isa_l_get_decode_tables(
+        isa_l_descriptor *isa_l_desc, int *missing_idxs,
+        uint64_t wanted_bm)
+{
+    uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
+    isa_l_decode_tables *tables = NULL;
+    isa_l_decode_tables *built = NULL;
+    isa_l_decode_tables *evicted = NULL;
+    int i, victim = 0;
+
+    mutex_lock(&isa_l_desc->decode_tables_lock);
+    tables = isa_l_find_decode_tables(isa_l_desc, missing_bm, wanted_bm);
+    mutex_unlock(&isa_l_desc->decode_tables_lock);
+    if (NULL != tables) {
+        return tables;
+    }
+
+    /* Build outside the lock, another thread may race us to it */
+    built = isa_l_build_decode_tables(isa_l_desc, missing_idxs, missing_bm,
+                                      wanted_bm);
+    if (NULL == built) {
+        return NULL;
     }
 
-    /**
-     * Get the row needed to reconstruct
-     */
-    inverse_rows = get_inverse_rows(k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, isa_l_desc->gf_mul);
+    mutex_lock(&isa_l_desc->decode_tables_lock);
+    tables = isa_l_find_decode_tables(isa_l_desc, missing_bm, wanted_bm);
+    if (NULL == tables) {
+        for (i = 0; i < ISA_L_DECODE_TABLES_CACHED; i++) {
+            if (NULL == isa_l_desc->decode_tables[i]) {
+                victim = i;
+                break;
+            }
+            if (isa_l_desc->decode_tables[i]->last_used <
+                    isa_l_desc->decode_tables[victim]->last_used) {
+                victim = i;
+            }
+        }
+        evicted = isa_l_desc->decode_tables[victim];
+        if (NULL != evicted && --evicted->refs > 0) {
+            evicted = NULL;     /* still in use, the last user frees it */
+        }
 
-    // Generate g_tbls from computed decode matrix (k x k) matrix
-    g_tbls = malloc(sizeof(unsigned char) * (k * m * 32));
-    if (NULL == g_tbls) {
-        goto out;
+        built->refs = 2;
+        built->last_used = ++isa_l_desc->decode_tables_clock;
+        isa_l_desc->decode_tables[victim] = built;
+        tables = built;
+        built = NULL;
     }
+    mutex_unlock(&isa_l_desc->decode_tables_lock);
 
-    /**
-     * Fill in the available elements
-     */
-    available_fragments = (unsigned char**)malloc(sizeof(unsigned char*)*k);
-    if (NULL == available_fragments) {
-        goto out;
-    }
+    free(evicted);
+    free(built);
+
+    return tables;
+}
+
+/*
+ * Rebuild the fragments of wanted_bm in a single ec_encode_data() pass over
+ * the available fragments.  The tables must have been built for the same
+ * missing pattern, with wanted_bm rows starting at first_row.
+ */
+static void isa_l_decode_with_tables(isa_l_descriptor *isa_l_desc,
+        isa_l_decode_tables *tables, int first_row, uint64_t wanted_bm,
+        char **data, char **parity, int blocksize)
+{
+    unsigned char *decoded_elements[EC_MAX_FRAGMENTS];
+    unsigned char *available_fragments[EC_MAX_FRAGMENTS];
+    int k = isa_l_desc->k;
+    int m = isa_l_desc->m;
+    int n = k + m;
+    int i, j;
+    uint64_t missing_bm = tables->missing_bm;
+    int num_missing_elements = 0;
 
     j = 0;
     for (i = 0; i < n; i++) {
-        if (missing_bm & (1 << i)) {
+        if (missing_bm & (1ULL << i)) {
             continue;
         }
         if (j == k) {
-          break;
+            break;
         }
         if (i < k) {
             available_fragments[j] = (unsigned char*)data[i];
@@ -354,42 +389,122 @@ int isa_l_reconstruct(void *desc, char **data, char **parity,
         j++;
     }
 
-    /**
-     * Copy pointer of buffer to reconstruct
-     */
-    j = 0;
+    // Grab pointers to memory needed for the wanted fragments
     for (i = 0; i < n; i++) {
-        if (missing_bm & (1 << i)) {
-            if (i == destination_idx) {
-                if (i < k) {
-                    reconstruct_buf = (unsigned char*)data[i];
-                } else {
-                    reconstruct_buf = (unsigned char*)parity[i-k];
-                }
-                inverse_row = j;
-                break;
-            }
-            j++;
+        if (wanted_bm & (1ULL << i)) {
+            decoded_elements[num_missing_elements] = (unsigned char*)
+                    (i < k ? data[i] : parity[i - k]);
+            num_missing_elements++;
         }
     }
 
-    /**
-     * Do the reconstruction
-     */
-    isa_l_desc->ec_init_tables(k, 1, &inverse_rows[inverse_row * k], g_tbls);
+    isa_l_desc->ec_encode_data(blocksize, k, num_missing_elements,
+                               &tables->g_tbls[first_row * k * 32],
+                               (unsigned char**)available_fragments,
+                               (unsigned char**)decoded_elements);
+}
 
-    isa_l_desc->ec_encode_data(blocksize, k, 1, g_tbls, (unsigned char**)available_fragments,
-                               (unsigned char**)&reconstruct_buf);
+/* Rebuild the wanted_bm subset of the missing fragments */
+static int isa_l_rebuild(isa_l_descriptor *isa_l_desc, char **data,
+        char **parity, int *missing_idxs, uint64_t wanted_bm, int blocksize)
+{
+    isa_l_decode_tables *tables = NULL;
 
-    ret = 0;
-out:
-    free(g_tbls);
-    free(decode_matrix);
-    free(decode_inverse);
-    free(inverse_rows);
-    free(available_fragments);
+    tables = isa_l_get_decode_tables(isa_l_desc, missing_idxs, wanted_bm);
+    if (NULL == tables) {
+        return -1;
+    }
 
-    return ret;
+    isa_l_decode_with_tables(isa_l_desc, tables, 0, wanted_bm,
+                             data, parity, blocksize);
+
+    isa_l_put_decode_tables(isa_l_desc, tables);
+
+    return 0;
+}
+
+int isa_l_decode(void *desc, char **data, char **parity,
+        int *missing_idxs, int blocksize)
+{
+    return isa_l_rebuild((isa_l_descriptor*) desc, data, parity,
+                         missing_idxs, convert_list_to_bitmap(missing_idxs),
+                         blocksize);
+}
+
+int isa_l_reconstruct(void *desc, char **data, char **parity,
+        int *missing_idxs, int destination_idx, int blocksize)
+{
+    if (destination_idx < 0 || destination_idx >= EC_MAX_FRAGMENTS) {
+        return -1;
+    }
+
+    return isa_l_rebuild((isa_l_descriptor*) desc, data, parity,
+                         missing_idxs, 1ULL << destination_idx, blocksize);
+}
+
+/*
+ * Several destinations share the tables, with one output row each, and
+ * are rebuilt by the same sweep over the available fragments.
+ */
+int isa_l_reconstruct_many(void *desc, char **data, char **parity,
+        int *missing_idxs, int *destination_idxs, int blocksize)
+{
+    return isa_l_rebuild((isa_l_descriptor*) desc, data, parity,
+                         missing_idxs,
+                         convert_list_to_bitmap(destination_idxs),
+                         blocksize);
+}
+
+/*
+ * Decode plans pin the decode tables of their pattern, which hold one row
+ * per missing fragment in index order: a reconstruct only uses the row of
+ * its destination.
+ */
+void * isa_l_plan_create(void *desc, int *missing_idxs)
+{
+    return isa_l_get_decode_tables((isa_l_descriptor*) desc, missing_idxs,
+                                   convert_list_to_bitmap(missing_idxs));
+}
+
+int isa_l_plan_decode(void *desc, void *plan, char **data, char **parity,
+        int blocksize)
+{
+    isa_l_decode_tables *tables = (isa_l_decode_tables*) plan;
+
+    isa_l_decode_with_tables((isa_l_descriptor*) desc, tables, 0,
+                             tables->wanted_bm, data, parity, blocksize);
+    return 0;
+}
+
+int isa_l_plan_reconstruct(void *desc, void *plan, char **data,
+        char **parity, int destination_idx, int blocksize)
+{
+    isa_l_decode_tables *tables = (isa_l_decode_tables*) plan;
+    uint64_t missing_bm = tables->missing_bm;
+    int row = 0;
+    int i;
+
+    if (destination_idx < 0 || destination_idx >= EC_MAX_FRAGMENTS ||
+            !(missing_bm & (1ULL << destination_idx))) {
+        return -1;
+    }
+    for (i = 0; i < destination_idx; i++) {
+        if (missing_bm & (1ULL << i)) {
+            row++;
+        }
+    }
+
+    isa_l_decode_with_tables((isa_l_descriptor*) desc, tables, row,
+                             1ULL << destination_idx, data, parity,
+                             blocksize);
+
+    return 0;
+}
+
+void isa_l_plan_destroy(void *desc, void *plan)
+{
+    isa_l_put_decode_tables((isa_l_descriptor*) desc,
+                            (isa_l_decode_tables*) plan);
 }
 
 int isa_l_min_fragments(void *desc, int *missing_idxs,
@@ -432,9 +547,14 @@ int isa_l_element_size(void* desc)
 int isa_l_exit(void *desc)
 {
     isa_l_descriptor *isa_l_desc = NULL;
+    int i;
 
     isa_l_desc = (isa_l_descriptor*) desc;
 
+    for (i = 0; i < ISA_L_DECODE_TABLES_CACHED; i++) {
+        free(isa_l_desc->decode_tables[i]);
+    }
+    mutex_destroy(&isa_l_desc->decode_tables_lock);
     free(isa_l_desc->encode_tables);
     free(isa_l_desc->matrix);
     free(isa_l_desc);
@@ -517,6 +637,9 @@ void * isa_l_common_init(struct ec_backend_args *args, void *backend_sohandle,
         goto error;
     }
 
+    /* the same library also ships fast CRC routines */
+    liberasurecode_crc32_probe_isal();
+
     desc->matrix = malloc(sizeof(char) * desc->k * (desc->k + desc->m));
     if (NULL == desc->matrix) {
         goto error;
@@ -542,6 +665,10 @@ void * isa_l_common_init(struct ec_backend_args *args, void *backend_sohandle,
                          &desc->matrix[desc->k * desc->k],
                          desc->encode_tables);
 
+    memset(desc->decode_tables, 0, sizeof(desc->decode_tables));
+    desc->decode_tables_clock = 0;
+    mutex_init(&desc->decode_tables_lock);
+
     return desc;
 
 error_free:
@@ -73,6 +73,11 @@ struct ec_backend_op_stubs isa_l_rs_cauchy_op_stubs = {
     .ISCOMPATIBLEWITH           = isa_l_rs_cauchy_is_compatible_with,
     .GETMETADATASIZE            = get_backend_metadata_size_zero,
     .GETENCODEOFFSET            = get_encode_offset_zero,
+    .PLANCREATE                 = isa_l_plan_create,
+    .PLANDECODE                 = isa_l_plan_decode,
+    .PLANRECONSTRUCT            = isa_l_plan_reconstruct,
+    .PLANDESTROY                = isa_l_plan_destroy,
+    .RECONSTRUCTMANY            = isa_l_reconstruct_many,
 };
 
 struct ec_backend_common backend_isa_l_rs_cauchy = {
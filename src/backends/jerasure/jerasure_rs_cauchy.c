@@ -204,6 +204,184 @@ out:
     return ret;
 }
 
+/*
+ * Decode plan: the inverted bit-matrix for one missing fragment pattern,
+ * so that each decode or reconstruct only runs the dot products
+ */
+struct jerasure_rs_cauchy_plan {
+    int *erased;            /* k+m length list, 1 for a missing fragment */
+    int *decoding_matrix;   /* k*w x k*w bits, NULL when no data is missing */
+    int *dm_ids;            /* the k fragments the decoding rows read */
+};
+
+static void jerasure_rs_cauchy_plan_destroy(void *desc, void *plan)
+{
+    struct jerasure_rs_cauchy_plan *jerasure_plan =
+        (struct jerasure_rs_cauchy_plan*) plan;
+
+    if (NULL == jerasure_plan) {
+        return;
+    }
+    free(jerasure_plan->erased);
+    free(jerasure_plan->decoding_matrix);
+    free(jerasure_plan->dm_ids);
+    free(jerasure_plan);
+}
+
+static void * jerasure_rs_cauchy_plan_create(void *desc, int *missing_idxs)
+{
+    struct jerasure_rs_cauchy_descriptor *jerasure_desc =
+        (struct jerasure_rs_cauchy_descriptor*) desc;
+    struct jerasure_rs_cauchy_plan *plan = NULL;
+    int k = jerasure_desc->k;
+    int w = jerasure_desc->w;
+    int i;
+
+    plan = (struct jerasure_rs_cauchy_plan *)
+        alloc_zeroed_buffer(sizeof(struct jerasure_rs_cauchy_plan));
+    if (NULL == plan) {
+        return NULL;
+    }
+
+    plan->erased = jerasure_desc->jerasure_erasures_to_erased(k,
+            jerasure_desc->m, missing_idxs);
+    if (NULL == plan->erased) {
+        goto error;
+    }
+
+    for (i = 0; i < k && !plan->erased[i]; i++);
+    if (i == k) {
+        /* parity only, rebuilt from the coding bit-matrix */
+        return plan;
+    }
+
+    plan->dm_ids = (int *) alloc_zeroed_buffer(sizeof(int) * k);
+    plan->decoding_matrix = (int *)
+        alloc_zeroed_buffer(sizeof(int) * k * k * w * w);
+    if (NULL == plan->dm_ids || NULL == plan->decoding_matrix) {
+        goto error;
+    }
+    if (jerasure_desc->jerasure_make_decoding_bitmatrix(k, jerasure_desc->m,
+            w, jerasure_desc->bitmatrix, plan->erased,
+            plan->decoding_matrix, plan->dm_ids) != 0) {
+        goto error;
+    }
+
+    return plan;
+
+error:
+    jerasure_rs_cauchy_plan_destroy(desc, plan);
+    return NULL;
+}
+
+/* Rebuild fragment idx from the survivors, through the plan */
+static void jerasure_rs_cauchy_plan_rebuild(
+        struct jerasure_rs_cauchy_descriptor *jerasure_desc,
+        struct jerasure_rs_cauchy_plan *plan, char **data, char **parity,
+        int idx, int blocksize)
+{
+    int k = jerasure_desc->k;
+    int w = jerasure_desc->w;
+
+    if (idx < k) {
+        jerasure_desc->jerasure_bitmatrix_dotprod(k, w,
+                plan->decoding_matrix + (idx * k * w * w), plan->dm_ids, idx,
+                data, parity, blocksize, PYECC_CAUCHY_PACKETSIZE);
+    } else {
+        jerasure_desc->jerasure_bitmatrix_dotprod(k, w,
+                jerasure_desc->bitmatrix + ((idx - k) * k * w * w), NULL, idx,
+                data, parity, blocksize, PYECC_CAUCHY_PACKETSIZE);
+    }
+}
+
+static int jerasure_rs_cauchy_plan_decode(void *desc, void *plan,
+        char **data, char **parity, int blocksize)
+{
+    struct jerasure_rs_cauchy_descriptor *jerasure_desc =
+        (struct jerasure_rs_cauchy_descriptor*) desc;
+    struct jerasure_rs_cauchy_plan *jerasure_plan =
+        (struct jerasure_rs_cauchy_plan*) plan;
+    int i;
+
+    /* data first, missing parity is encoded from it */
+    for (i = 0; i < jerasure_desc->k + jerasure_desc->m; i++) {
+        if (jerasure_plan->erased[i]) {
+            jerasure_rs_cauchy_plan_rebuild(jerasure_desc, jerasure_plan,
+                    data, parity, i, blocksize);
+        }
+    }
+
+    return 0;
+}
+
+static int jerasure_rs_cauchy_plan_reconstruct(void *desc, void *plan,
+        char **data, char **parity, int destination_idx, int blocksize)
+{
+    struct jerasure_rs_cauchy_descriptor *jerasure_desc =
+        (struct jerasure_rs_cauchy_descriptor*) desc;
+    struct jerasure_rs_cauchy_plan *jerasure_plan =
+        (struct jerasure_rs_cauchy_plan*) plan;
+    int i;
+
+    /* parity is encoded from the data, missing data comes back first */
+    if (destination_idx >= jerasure_desc->k) {
+        for (i = 0; i < jerasure_desc->k; i++) {
+            if (jerasure_plan->erased[i]) {
+                jerasure_rs_cauchy_plan_rebuild(jerasure_desc, jerasure_plan,
+                        data, parity, i, blocksize);
+            }
+        }
+    }
+    jerasure_rs_cauchy_plan_rebuild(jerasure_desc, jerasure_plan, data, parity,
+            destination_idx, blocksize);
+
+    return 0;
+}
+
+/*
+ * Invert the decoding matrix once for all the destinations, through a
+ * throwaway plan, and rebuild missing data at most once
+ */
+static int jerasure_rs_cauchy_reconstruct_many(void *desc,
+        char **data, char **parity, int *missing_idxs,
+        int *destination_idxs, int blocksize)
+{
+    struct jerasure_rs_cauchy_descriptor *jerasure_desc =
+        (struct jerasure_rs_cauchy_descriptor*) desc;
+    struct jerasure_rs_cauchy_plan *plan = NULL;
+    uint64_t destination_bm = convert_list_to_bitmap(destination_idxs);
+    int k = jerasure_desc->k;
+    int ret = 0;
+    int i;
+
+    plan = jerasure_rs_cauchy_plan_create(desc, missing_idxs);
+    if (NULL == plan) {
+        for (i = 0; destination_idxs[i] >= 0 && ret == 0; i++) {
+            ret = jerasure_rs_cauchy_reconstruct(desc, data, parity,
+                    missing_idxs, destination_idxs[i], blocksize);
+        }
+        return ret;
+    }
+
+    /* all the missing data is needed as soon as a parity is rebuilt */
+    for (i = 0; i < k; i++) {
+        if (plan->erased[i] && ((destination_bm >> i) & 1 ||
+                destination_bm >> k)) {
+            jerasure_rs_cauchy_plan_rebuild(jerasure_desc, plan, data, parity,
+                    i, blocksize);
+        }
+    }
+    for (i = k; i < k + jerasure_desc->m; i++) {
+        if ((destination_bm >> i) & 1) {
+            jerasure_rs_cauchy_plan_rebuild(jerasure_desc, plan, data, parity,
+                    i, blocksize);
+        }
+    }
+    jerasure_rs_cauchy_plan_destroy(desc, plan);
+
+    return ret;
+}
+
 /*
  * Caller will allocate an array of size k for fragments_needed
  * 
@@ -462,6 +640,11 @@ struct ec_backend_op_stubs jerasure_rs_cauchy_op_stubs = {
     .ISCOMPATIBLEWITH           = jerasure_rs_cauchy_is_compatible_with,
     .GETMETADATASIZE            = get_backend_metadata_size_zero,
     .GETENCODEOFFSET            = get_encode_offset_zero,
+    .PLANCREATE                 = jerasure_rs_cauchy_plan_create,
+    .PLANDECODE                 = jerasure_rs_cauchy_plan_decode,
+    .PLANRECONSTRUCT            = jerasure_rs_cauchy_plan_reconstruct,
+    .PLANDESTROY                = jerasure_rs_cauchy_plan_destroy,
+    .RECONSTRUCTMANY            = jerasure_rs_cauchy_reconstruct_many,
 };
 
 struct ec_backend_common backend_jerasure_rs_cauchy = {
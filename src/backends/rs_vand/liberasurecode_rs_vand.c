@@ -55,6 +55,10 @@ typedef void (*init_liberasurecode_rs_vand_func)(int, int);
 typedef void (*deinit_liberasurecode_rs_vand_func)();
 typedef void (*free_systematic_matrix_func)(int *);
 typedef int* (*make_systematic_matrix_func)(int, int);
+typedef void* (*liberasurecode_rs_vand_plan_create_func)(int *, int, int, int *);
+typedef void (*liberasurecode_rs_vand_plan_free_func)(void *);
+typedef int (*liberasurecode_rs_vand_decode_plan_func)(void *, char **, char **, int);
+typedef int (*liberasurecode_rs_vand_reconstruct_plan_func)(void *, char **, char **, int, int);
 
 
 struct liberasurecode_rs_vand_descriptor {
@@ -73,6 +77,15 @@ struct liberasurecode_rs_vand_descriptor {
     /* calls required for reconstruct */
     liberasurecode_rs_vand_reconstruct_func liberasurecode_rs_vand_reconstruct;
 
+    /* decode plans, NULL with an older builtin library */
+    liberasurecode_rs_vand_plan_create_func liberasurecode_rs_vand_plan_create;
+    liberasurecode_rs_vand_plan_free_func liberasurecode_rs_vand_plan_free;
+    liberasurecode_rs_vand_decode_plan_func liberasurecode_rs_vand_decode_plan;
+    liberasurecode_rs_vand_reconstruct_plan_func liberasurecode_rs_vand_reconstruct_plan;
+
+    /* region ops take unaligned buffers, false with an older library */
+    bool unaligned_safe;
+
     /* fields needed to hold state */
     int *matrix;
     int k;
@@ -118,6 +131,79 @@ static int liberasurecode_rs_vand_reconstruct(void *desc, char **data, char **pa
     return 0;
 }
 
+static void * liberasurecode_rs_vand_plan_create(void *desc,
+        int *missing_idxs)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc =
+        (struct liberasurecode_rs_vand_descriptor*) desc;
+
+    if (NULL == rs_vand_desc->liberasurecode_rs_vand_plan_create) {
+        return NULL;
+    }
+    return rs_vand_desc->liberasurecode_rs_vand_plan_create(
+        rs_vand_desc->matrix, rs_vand_desc->k, rs_vand_desc->m, missing_idxs);
+}
+
+static int liberasurecode_rs_vand_plan_decode(void *desc, void *plan,
+        char **data, char **parity, int blocksize)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc =
+        (struct liberasurecode_rs_vand_descriptor*) desc;
+
+    return rs_vand_desc->liberasurecode_rs_vand_decode_plan(plan, data,
+        parity, blocksize);
+}
+
+static int liberasurecode_rs_vand_plan_reconstruct(void *desc, void *plan,
+        char **data, char **parity, int destination_idx, int blocksize)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc =
+        (struct liberasurecode_rs_vand_descriptor*) desc;
+
+    return rs_vand_desc->liberasurecode_rs_vand_reconstruct_plan(plan, data,
+        parity, destination_idx, blocksize);
+}
+
+static void liberasurecode_rs_vand_plan_destroy(void *desc, void *plan)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc =
+        (struct liberasurecode_rs_vand_descriptor*) desc;
+
+    rs_vand_desc->liberasurecode_rs_vand_plan_free(plan);
+}
+
+/*
+ * Invert the decoding matrix once for all the destinations, through a
+ * throwaway plan, rather than once per destination
+ */
+static int liberasurecode_rs_vand_reconstruct_many(void *desc,
+        char **data, char **parity, int *missing_idxs,
+        int *destination_idxs, int blocksize)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc =
+        (struct liberasurecode_rs_vand_descriptor*) desc;
+    void *plan = NULL;
+    int ret = 0;
+    int i;
+
+    plan = liberasurecode_rs_vand_plan_create(desc, missing_idxs);
+    if (NULL == plan) {
+        for (i = 0; destination_idxs[i] >= 0 && ret == 0; i++) {
+            ret = liberasurecode_rs_vand_reconstruct(desc, data, parity,
+                    missing_idxs, destination_idxs[i], blocksize);
+        }
+        return ret;
+    }
+
+    for (i = 0; destination_idxs[i] >= 0 && ret == 0; i++) {
+        ret = rs_vand_desc->liberasurecode_rs_vand_reconstruct_plan(plan,
+            data, parity, destination_idxs[i], blocksize);
+    }
+    rs_vand_desc->liberasurecode_rs_vand_plan_free(plan);
+
+    return ret;
+}
+
 static int liberasurecode_rs_vand_min_fragments(void *desc, int *missing_idxs,
         int *fragments_to_exclude, int *fragments_needed)
 {
@@ -181,6 +267,10 @@ static void * liberasurecode_rs_vand_init(struct ec_backend_args *args,
         liberasurecode_rs_vand_encode_func encodep;
         liberasurecode_rs_vand_decode_func decodep;
         liberasurecode_rs_vand_reconstruct_func reconstructp;
+        liberasurecode_rs_vand_plan_create_func plancreatep;
+        liberasurecode_rs_vand_plan_free_func planfreep;
+        liberasurecode_rs_vand_decode_plan_func plandecodep;
+        liberasurecode_rs_vand_reconstruct_plan_func planreconstructp;
         void *vptr;
     } func_handle = {.vptr = NULL};
 
@@ -234,6 +324,24 @@ static void * liberasurecode_rs_vand_init(struct ec_backend_args *args,
     if (NULL == desc->liberasurecode_rs_vand_reconstruct) {
         goto error; 
     }
+
+    /* Plans are optional, all four calls or none */
+    func_handle.vptr = dlsym(backend_sohandle, "liberasurecode_rs_vand_plan_create");
+    desc->liberasurecode_rs_vand_plan_create = func_handle.plancreatep;
+    func_handle.vptr = dlsym(backend_sohandle, "liberasurecode_rs_vand_plan_free");
+    desc->liberasurecode_rs_vand_plan_free = func_handle.planfreep;
+    func_handle.vptr = dlsym(backend_sohandle, "liberasurecode_rs_vand_decode_plan");
+    desc->liberasurecode_rs_vand_decode_plan = func_handle.plandecodep;
+    func_handle.vptr = dlsym(backend_sohandle, "liberasurecode_rs_vand_reconstruct_plan");
+    desc->liberasurecode_rs_vand_reconstruct_plan = func_handle.planreconstructp;
+    if (NULL == desc->liberasurecode_rs_vand_plan_free ||
+            NULL == desc->liberasurecode_rs_vand_decode_plan ||
+            NULL == desc->liberasurecode_rs_vand_reconstruct_plan) {
+        desc->liberasurecode_rs_vand_plan_create = NULL;
+    }
+    desc->unaligned_safe = NULL != dlsym(backend_sohandle,
+            "liberasurecode_rs_vand_unaligned_safe");
+    dlerror();    /* Clear any missing symbol error */
   
     desc->init_liberasurecode_rs_vand(desc->k, desc->m);
 
@@ -289,6 +397,14 @@ static bool liberasurecode_rs_vand_is_compatible_with(uint32_t version) {
     return version == backend_liberasurecode_rs_vand.ec_backend_version;
 }
 
+static bool liberasurecode_rs_vand_is_unaligned_safe(void *desc)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc =
+        (struct liberasurecode_rs_vand_descriptor*) desc;
+
+    return rs_vand_desc->unaligned_safe;
+}
+
 struct ec_backend_op_stubs liberasurecode_rs_vand_op_stubs = {
     .INIT                       = liberasurecode_rs_vand_init,
     .EXIT                       = liberasurecode_rs_vand_exit,
@@ -300,6 +416,12 @@ struct ec_backend_op_stubs liberasurecode_rs_vand_op_stubs = {
     .ISCOMPATIBLEWITH           = liberasurecode_rs_vand_is_compatible_with,
     .GETMETADATASIZE            = get_backend_metadata_size_zero,
     .GETENCODEOFFSET            = get_encode_offset_zero,
+    .PLANCREATE                 = liberasurecode_rs_vand_plan_create,
+    .PLANDECODE                 = liberasurecode_rs_vand_plan_decode,
+    .PLANRECONSTRUCT            = liberasurecode_rs_vand_plan_reconstruct,
+    .PLANDESTROY                = liberasurecode_rs_vand_plan_destroy,
+    .RECONSTRUCTMANY            = liberasurecode_rs_vand_reconstruct_many,
+    .ISUNALIGNEDSAFE            = liberasurecode_rs_vand_is_unaligned_safe,
 };
 
 struct ec_backend_common backend_liberasurecode_rs_vand = {
@@ -61,6 +61,7 @@ struct flat_xor_hd_descriptor {
     xor_code_encode_func  xor_code_encode;
     xor_code_decode_func xor_code_decode;
     xor_hd_fragments_needed_func  xor_hd_fragments_needed;
+    bool unaligned_safe;    /* libXorcode takes unaligned buffers */
 };
 
 static int flat_xor_hd_encode(void *desc,
@@ -147,6 +148,10 @@ static void * flat_xor_hd_init(struct ec_backend_args *args, void *sohandle)
     }
 
     bdesc->xor_desc = xor_desc;
+    /* older builds of libXorcode need 16-byte aligned buffers */
+    bdesc->unaligned_safe = NULL != sohandle &&
+        NULL != dlsym(sohandle, "xor_code_unaligned_safe");
+    dlerror();    /* Clear any missing symbol error */
 
     return (void *) bdesc;
 }
@@ -169,6 +174,14 @@ static bool flat_xor_is_compatible_with(uint32_t version) {
     return version == backend_flat_xor_hd.ec_backend_version;
 }
 
+static bool flat_xor_hd_is_unaligned_safe(void *desc)
+{
+    struct flat_xor_hd_descriptor *bdesc =
+        (struct flat_xor_hd_descriptor *) desc;
+
+    return bdesc->unaligned_safe;
+}
+
 struct ec_backend_op_stubs flat_xor_hd_op_stubs = {
     .INIT                       = flat_xor_hd_init,
     .EXIT                       = flat_xor_hd_exit,
@@ -180,6 +193,7 @@ struct ec_backend_op_stubs flat_xor_hd_op_stubs = {
     .ISCOMPATIBLEWITH           = flat_xor_is_compatible_with,
     .GETMETADATASIZE            = get_backend_metadata_size_zero,
     .GETENCODEOFFSET            = get_encode_offset_zero,
+    .ISUNALIGNEDSAFE            = flat_xor_hd_is_unaligned_safe,
 };
 
 struct ec_backend_common backend_flat_xor_hd = {
@@ -337,17 +337,20 @@ int gaussj_inversion(int *matrix, int *inverse, int n)
   return 0;
 }
 
+// Regions need not be aligned: words go through memcpy(), which compiles to
+// plain (unaligned) loads and stores
 void region_xor(char *from_buf, char *to_buf, int blocksize)
 {
   int i;
-  
-  uint32_t *_from_buf = (uint32_t*)from_buf;
-  uint32_t *_to_buf = (uint32_t*)to_buf;
+  uint32_t from_word, to_word;
   int adj_blocksize = blocksize / 4;
   int trailing_bytes = blocksize % 4;
 
   for (i = 0; i < adj_blocksize; i++) {
-    _to_buf[i] = _to_buf[i] ^ _from_buf[i];
+    memcpy(&from_word, from_buf + (i * 4), 4);
+    memcpy(&to_word, to_buf + (i * 4), 4);
+    to_word ^= from_word;
+    memcpy(to_buf + (i * 4), &to_word, 4);
   }
   
   for (i = blocksize-trailing_bytes; i < blocksize; i++) {
@@ -358,14 +361,16 @@ void region_xor(char *from_buf, char *to_buf, int blocksize)
 void region_multiply(char *from_buf, char *to_buf, int mult, int xor, int blocksize)
 {
   int i;
-  uint16_t *_from_buf = (uint16_t*)from_buf;
-  uint16_t *_to_buf = (uint16_t*)to_buf;
+  uint16_t from_word, to_word;
   int adj_blocksize = blocksize / 2;
   int trailing_bytes = blocksize % 2;
 
   if (xor) {
     for (i = 0; i < adj_blocksize; i++) {
-      _to_buf[i] = _to_buf[i] ^ (uint16_t)rs_galois_mult(_from_buf[i], mult);
+      memcpy(&from_word, from_buf + (i * 2), 2);
+      memcpy(&to_word, to_buf + (i * 2), 2);
+      to_word ^= (uint16_t)rs_galois_mult(from_word, mult);
+      memcpy(to_buf + (i * 2), &to_word, 2);
     }
   
     if (trailing_bytes == 1) {
@@ -374,7 +379,9 @@ void region_multiply(char *from_buf, char *to_buf, int mult, int xor, int blocks
     }
   } else {
     for (i = 0; i < adj_blocksize; i++) {
-      _to_buf[i] = (uint16_t)rs_galois_mult(_from_buf[i], mult);
+      memcpy(&from_word, from_buf + (i * 2), 2);
+      to_word = (uint16_t)rs_galois_mult(from_word, mult);
+      memcpy(to_buf + (i * 2), &to_word, 2);
     }
   
     if (trailing_bytes == 1) {
@@ -398,6 +405,15 @@ void region_dot_product(char **from_bufs, char *to_buf, int *matrix_row, int num
   }
 }
 
+/*
+ * Tells the backend that the region ops take buffers at any address, so
+ * unaligned fragments may be handed in as they are
+ */
+int liberasurecode_rs_vand_unaligned_safe(void)
+{
+  return 1;
+}
+
 int liberasurecode_rs_vand_encode(int *generator_matrix, char **data, char **parity, int k, int m, int blocksize)
 {
   int i;
@@ -551,3 +567,152 @@ int liberasurecode_rs_vand_reconstruct(int *generator_matrix, char **data, char
 
   return 0;
 }
+
+// A decode plan: the inverted decoding matrix for one missing pattern,
+// and the rows rebuilding each missing parity from the same k available
+// fragments, worked out once and reused by every stripe with that
+// pattern.
+struct liberasurecode_rs_vand_plan {
+  int k;
+  int m;
+  int *available;     // first k available indexes
+  int *missing;       // k + m flags
+  int *inverse;       // k x k
+  int *parity_rows;   // m x k, only set for missing parity
+};
+
+void *liberasurecode_rs_vand_plan_create(int *generator_matrix, int k, int m, int *missing)
+{
+  struct liberasurecode_rs_vand_plan *plan = NULL;
+  int *decoding_matrix = NULL;
+  int n = k + m;
+  int i, j, l;
+  int num_missing = 0;
+
+  plan = (struct liberasurecode_rs_vand_plan*)malloc(sizeof(*plan) + sizeof(int)*(k + n + (k * k) + (m * k)));
+  if (NULL == plan) {
+    return NULL;
+  }
+  plan->k = k;
+  plan->m = m;
+  plan->available = (int*)(plan + 1);
+  plan->missing = plan->available + k;
+  plan->inverse = plan->missing + n;
+  plan->parity_rows = plan->inverse + (k * k);
+
+  memset(plan->missing, 0, sizeof(int)*n);
+  memset(plan->parity_rows, 0, sizeof(int)*m*k);
+  while (missing[num_missing] > -1) {
+    plan->missing[missing[num_missing]] = 1;
+    num_missing++;
+  }
+
+  if (num_missing > m) {
+    free(plan);
+    return NULL;
+  }
+
+  for (i = 0, j = 0; j < k; i++) {
+    if (!plan->missing[i]) {
+      plan->available[j++] = i;
+    }
+  }
+
+  decoding_matrix = (int*)malloc(sizeof(int)*k*k);
+  if (NULL == decoding_matrix) {
+    free(plan);
+    return NULL;
+  }
+  create_decoding_matrix(generator_matrix, decoding_matrix, missing, k, m);
+  gaussj_inversion(decoding_matrix, plan->inverse, k);
+  free(decoding_matrix);
+
+  // Same substitution as liberasurecode_rs_vand_reconstruct()
+  for (l = k; l < n; l++) {
+    int *parity_row = &plan->parity_rows[(l - k) * k];
+
+    if (!plan->missing[l]) {
+      continue;
+    }
+    j = 0;
+    for (i = 0; i < k; i++) {
+      if (!plan->missing[i]) {
+        parity_row[j] = generator_matrix[(l * k) + i];
+        j++;
+      }
+    }
+    for (i = 0; i < k; i++) {
+      if (plan->missing[i]) {
+        for (j = 0; j < k; j++) {
+          parity_row[j] ^= rs_galois_mult(generator_matrix[(l * k) + i], plan->inverse[(i * k) + j]);
+        }
+      }
+    }
+  }
+
+  return plan;
+}
+
+void liberasurecode_rs_vand_plan_free(void *plan)
+{
+  free(plan);
+}
+
+// Dot product of a plan row with the plan's k available fragments
+static void plan_dot_product(struct liberasurecode_rs_vand_plan *plan, char **data, char **parity, char *to_buf, int *matrix_row, int blocksize)
+{
+  int i;
+  int k = plan->k;
+
+  memset(to_buf, 0, blocksize);
+  for (i = 0; i < k; i++) {
+    int idx = plan->available[i];
+    char *from_buf = idx < k ? data[idx] : parity[idx - k];
+    int mult = matrix_row[i];
+
+    if (mult == 1) {
+      region_xor(from_buf, to_buf, blocksize);
+    } else if (mult != 0) {
+      region_multiply(from_buf, to_buf, mult, 1, blocksize);
+    }
+  }
+}
+
+int liberasurecode_rs_vand_decode_plan(void *_plan, char **data, char **parity, int blocksize)
+{
+  struct liberasurecode_rs_vand_plan *plan = (struct liberasurecode_rs_vand_plan*)_plan;
+  int k = plan->k;
+  int n = k + plan->m;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    if (!plan->missing[i]) {
+      continue;
+    }
+    if (i < k) {
+      plan_dot_product(plan, data, parity, data[i], &plan->inverse[(i * k)], blocksize);
+    } else {
+      plan_dot_product(plan, data, parity, parity[i - k], &plan->parity_rows[(i - k) * k], blocksize);
+    }
+  }
+
+  return 0;
+}
+
+int liberasurecode_rs_vand_reconstruct_plan(void *_plan, char **data, char **parity, int destination_idx, int blocksize)
+{
+  struct liberasurecode_rs_vand_plan *plan = (struct liberasurecode_rs_vand_plan*)_plan;
+  int k = plan->k;
+
+  if (destination_idx < 0 || destination_idx >= k + plan->m || !plan->missing[destination_idx]) {
+    return -1;
+  }
+
+  if (destination_idx < k) {
+    plan_dot_product(plan, data, parity, data[destination_idx], &plan->inverse[(destination_idx * k)], blocksize);
+  } else {
+    plan_dot_product(plan, data, parity, parity[destination_idx - k], &plan->parity_rows[(destination_idx - k) * k], blocksize);
+  }
+
+  return 0;
+}
@@ -31,6 +31,7 @@
 // like Jerasure with GF-Complete will give users the ability to tune to their
 // architecture (Intel or ARM), CPU and memory (lots of options).
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -45,8 +46,19 @@ int *log_table = NULL;
 int *ilog_table = NULL;
 int *ilog_table_begin = NULL;
 
+// The tables are shared by every instance: build them for the first one
+// and free them with the last one.
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+static int tables_refcount = 0;
+
 void rs_galois_init_tables()
 {
+  pthread_mutex_lock(&tables_lock);
+  if (tables_refcount++ > 0) {
+    pthread_mutex_unlock(&tables_lock);
+    return;
+  }
+
   log_table = (int*)malloc(sizeof(int)*FIELD_SIZE);
   ilog_table_begin = (int*)malloc(sizeof(int)*FIELD_SIZE*3);
   int i = 0;
@@ -63,12 +75,20 @@ void rs_galois_init_tables()
     }
   }
   ilog_table = &ilog_table_begin[GROUP_SIZE];
+  pthread_mutex_unlock(&tables_lock);
 }
 
 void rs_galois_deinit_tables()
 {
-  free(log_table);
-  free(ilog_table_begin);
+  pthread_mutex_lock(&tables_lock);
+  if (tables_refcount > 0 && --tables_refcount == 0) {
+    free(log_table);
+    free(ilog_table_begin);
+    log_table = NULL;
+    ilog_table = NULL;
+    ilog_table_begin = NULL;
+  }
+  pthread_mutex_unlock(&tables_lock);
 }
 
 int rs_galois_mult(int x, int y)
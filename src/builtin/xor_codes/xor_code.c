@@ -134,7 +134,8 @@ void fast_memcpy(char *dst, char *src, int size)
 }
 
 /*
- * Buffers must be aligned to 16-byte boundaries
+ * Buffers are best aligned to 16-byte boundaries, unaligned ones take
+ * unaligned loads and stores
  *
  * Store in buf2 (opposite of memcpy convention...  Maybe change?)
  */
@@ -151,8 +152,15 @@ void xor_bufs_and_store(char *buf1, char *buf2, int blocksize)
   /*
    * XOR aligned region using 128-bit XOR
    */
-  for (i=0; i < fast_int_blocksize; i++) {
-    _buf2[i] = _mm_xor_si128(_buf1[i], _buf2[i]);
+  if (is_aligned(buf1) && is_aligned(buf2)) {
+    for (i=0; i < fast_int_blocksize; i++) {
+      _buf2[i] = _mm_xor_si128(_buf1[i], _buf2[i]);
+    }
+  } else {
+    for (i=0; i < fast_int_blocksize; i++) {
+      _mm_storeu_si128(&_buf2[i], _mm_xor_si128(_mm_loadu_si128(&_buf1[i]),
+                                                _mm_loadu_si128(&_buf2[i])));
+    }
   }
 #else
   int residual_bytes = num_unaligned_end(blocksize);
@@ -163,8 +171,19 @@ void xor_bufs_and_store(char *buf1, char *buf2, int blocksize)
   unsigned long*_buf1 = (unsigned long*)buf1; 
   unsigned long*_buf2 = (unsigned long*)buf2; 
   
-  for (i=0; i < fast_int_blocksize; i++) {
-    _buf2[i] = _buf1[i] ^ _buf2[i];
+  if (is_aligned(buf1) && is_aligned(buf2)) {
+    for (i=0; i < fast_int_blocksize; i++) {
+      _buf2[i] = _buf1[i] ^ _buf2[i];
+    }
+  } else {
+    unsigned long word1, word2;
+
+    for (i=0; i < fast_int_blocksize; i++) {
+      memcpy(&word1, &_buf1[i], sizeof(word1));
+      memcpy(&word2, &_buf2[i], sizeof(word2));
+      word2 ^= word1;
+      memcpy(&_buf2[i], &word2, sizeof(word2));
+    }
   }
 #endif
 
@@ -177,6 +196,15 @@ void xor_bufs_and_store(char *buf1, char *buf2, int blocksize)
   }
 }
 
+/*
+ * Tells the backend that xor_bufs_and_store() takes buffers at any
+ * address, so unaligned fragments may be handed in as they are
+ */
+int xor_code_unaligned_safe(void)
+{
+  return 1;
+}
+
 void xor_code_encode(xor_code_t *code_desc, char **data, char **parity, int blocksize)
 {
   int i, j;
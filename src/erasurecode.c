@@ -27,12 +27,15 @@
  */
 
 #include <assert.h>
-#include <zlib.h>
+#include <sched.h>
 #include "list.h"
 #include "erasurecode.h"
 #include "erasurecode_backend.h"
+#include "erasurecode_crc.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
+#include "erasurecode_pool.h"
+#include "erasurecode_threadpool.h"
 #include "erasurecode_preprocessing.h"
 #include "erasurecode_postprocessing.h"
 #include "erasurecode_stdinc.h"
@@ -72,44 +75,140 @@ char *ec_backends_supported_str[EC_BACKENDS_MAX];
 
 /* =~=*=~==~=*=~==~=*=~= EC backend instance management =~=*=~==~=*=~==~=*= */
 
-/* Registered erasure code backend instances */
-SLIST_HEAD(backend_list, ec_backend) active_instances =
-    SLIST_HEAD_INITIALIZER(active_instances);
-rwlock_t active_instances_rwlock = RWLOCK_INITIALIZER;
+/*
+ * Registered erasure code backend instances live in a two-level table of
+ * slots, indexed by descriptor.  A descriptor encodes its slot and the
+ * generation of the slot at registration time:
+ *
+ *   desc = (generation << EC_SLOT_BITS) | slot
+ *
+ * Each slot has a single atomic state word holding the generation, a
+ * "live" bit and a count of API calls currently using the instance.
+ * Lookups take a reference with a CAS on that word and never lock, so
+ * they are O(1).  Destroy clears the live bit (new lookups fail from then
+ * on) and waits for the in-flight calls to drain before tearing the
+ * instance down.  Reusing a slot bumps its generation, so stale
+ * descriptors are rejected.
+ */
+#define EC_SLOT_BITS            16
+#define EC_SLOT_PAGE_BITS       8
+#define EC_SLOTS_PER_PAGE       (1 << EC_SLOT_PAGE_BITS)
+#define EC_SLOT_PAGES           (1 << (EC_SLOT_BITS - EC_SLOT_PAGE_BITS))
+#define EC_SLOT_MAX_GEN         ((1 << (31 - EC_SLOT_BITS)) - 1)
+
+#define EC_SLOT_GEN_SHIFT       32
+#define EC_SLOT_LIVE            (1ULL << 31)
+#define EC_SLOT_REFS_MASK       (EC_SLOT_LIVE - 1)
+
+struct ec_instance_slot {
+    uint64_t state;             /* generation | live bit | references */
+    ec_backend_t instance;
+    int next_free;              /* free list link, -1 terminates */
+};
+
+static struct ec_instance_slot *instance_slots[EC_SLOT_PAGES];
+static int instance_slots_free = -1;    /* head of the free slot list */
+static int instance_slots_used = 0;     /* slots handed out so far */
+
+/* Serializes register/unregister; lookups do not take it */
+static mutex_t instance_slots_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int get_fragment_metadata_impl(char *fragment,
+        fragment_metadata_t *fragment_metadata, const uint32_t *digest);
+static int is_invalid_fragment_impl(int desc, char *fragment,
+        const uint32_t *digest);
+static int find_invalid_fragments(ec_backend_t instance, int desc,
+        char **fragments, int num_fragments, uint64_t *bitmap);
+
+static struct ec_instance_slot *instance_slot(int desc, uint32_t *gen)
+{
+    struct ec_instance_slot *page;
+    int slot;
+
+    if (desc <= 0) {
+        return NULL;
+    }
+    slot = desc & ((1 << EC_SLOT_BITS) - 1);
+    *gen = (uint32_t) desc >> EC_SLOT_BITS;
+
+    page = __atomic_load_n(&instance_slots[slot >> EC_SLOT_PAGE_BITS],
+                           __ATOMIC_ACQUIRE);
+    if (NULL == page) {
+        return NULL;
+    }
 
-/* Backend instance id */
-int next_backend_desc = 0;
+    return &page[slot & (EC_SLOTS_PER_PAGE - 1)];
+}
+
+static inline bool slot_state_matches(uint64_t state, uint32_t gen)
+{
+    return (state >> EC_SLOT_GEN_SHIFT) == gen && (state & EC_SLOT_LIVE);
+}
 
 /**
- * Look up a backend instance by descriptor
+ * Look up a backend instance by descriptor, without taking a reference
+ *
+ * Only safe when the caller knows the instance cannot be destroyed
+ * concurrently; API entry points use liberasurecode_backend_instance_get().
  *
  * @returns pointer to a registered liberasurecode instance
- * The caller must hold active_instances_rwlock
  */
 ec_backend_t liberasurecode_backend_instance_get_by_desc(int desc)
 {
-    struct ec_backend *b = NULL;
-    SLIST_FOREACH(b, &active_instances, link) {
-        if (b->idesc == desc)
-            break;
+    uint32_t gen = 0;
+    struct ec_instance_slot *slot = instance_slot(desc, &gen);
+
+    if (NULL == slot ||
+            !slot_state_matches(__atomic_load_n(&slot->state,
+                                                __ATOMIC_ACQUIRE), gen)) {
+        return NULL;
     }
-    return b;
+    return slot->instance;
 }
 
 /**
- * Allocated backend instance descriptor
+ * Look up a backend instance by descriptor and hold it: the instance will
+ * not be torn down until the reference is dropped with
+ * liberasurecode_backend_instance_put().
  *
- * Returns a unique descriptor for a new backend.
- * The caller must hold active_instances_rwlock
+ * @returns pointer to a registered liberasurecode instance, NULL if the
+ *          descriptor is unknown or being destroyed
+ */
+ec_backend_t liberasurecode_backend_instance_get(int desc)
+{
+    uint32_t gen = 0;
+    struct ec_instance_slot *slot = instance_slot(desc, &gen);
+    uint64_t state;
+
+    if (NULL == slot) {
+        return NULL;
+    }
+
+    state = __atomic_load_n(&slot->state, __ATOMIC_RELAXED);
+    do {
+        if (!slot_state_matches(state, gen)) {
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&slot->state, &state, state + 1,
+                1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    return slot->instance;
+}
+
+/**
+ * Drop a reference taken with liberasurecode_backend_instance_get()
  */
-int liberasurecode_backend_alloc_desc(void)
+void liberasurecode_backend_instance_put(ec_backend_t instance)
 {
-    for (;;) {
-        if (++next_backend_desc <= 0)
-            next_backend_desc = 1;
-        if (!liberasurecode_backend_instance_get_by_desc(next_backend_desc))
-            return next_backend_desc;
+    uint32_t gen = 0;
+    struct ec_instance_slot *slot;
+
+    if (NULL == instance) {
+        return;
     }
+    slot = instance_slot(instance->idesc, &gen);
+    assert(NULL != slot);
+    __atomic_fetch_sub(&slot->state, 1, __ATOMIC_RELEASE);
 }
 
 /**
@@ -117,49 +216,127 @@ int liberasurecode_backend_alloc_desc(void)
  *
  * @param instance - backend enum
  *
- * @returns new backend descriptor
+ * @returns new backend descriptor, -ENOMEM if no slot is available
  */
 int liberasurecode_backend_instance_register(ec_backend_t instance)
 {
-    int desc = -1;  /* descriptor to return */
-    int rc = 0;     /* return call value */
+    struct ec_instance_slot *slot;
+    uint32_t gen;
+    int idx;
 
-    rc = rwlock_wrlock(&active_instances_rwlock);
-    if (rc == 0) {
-        SLIST_INSERT_HEAD(&active_instances, instance, link);
-        desc = liberasurecode_backend_alloc_desc();
-        if (desc <= 0)
-            goto register_out;
-        instance->idesc = desc;
-    } else {
-        goto exit;
+    mutex_lock(&instance_slots_lock);
+
+    if (instance_slots_free < 0) {
+        /* Grow the table by a page */
+        int page_idx = instance_slots_used >> EC_SLOT_PAGE_BITS;
+        struct ec_instance_slot *page;
+        int i;
+
+        if (page_idx >= EC_SLOT_PAGES) {
+            mutex_unlock(&instance_slots_lock);
+            log_error("Too many liberasurecode instances!");
+            return -ENOMEM;
+        }
+        page = calloc(EC_SLOTS_PER_PAGE, sizeof(*page));
+        if (NULL == page) {
+            mutex_unlock(&instance_slots_lock);
+            return -ENOMEM;
+        }
+        for (i = EC_SLOTS_PER_PAGE - 1; i >= 0; i--) {
+            page[i].next_free = instance_slots_free;
+            instance_slots_free = (page_idx << EC_SLOT_PAGE_BITS) + i;
+        }
+        instance_slots_used += EC_SLOTS_PER_PAGE;
+        __atomic_store_n(&instance_slots[page_idx], page, __ATOMIC_RELEASE);
+    }
+
+    idx = instance_slots_free;
+    slot = &instance_slots[idx >> EC_SLOT_PAGE_BITS][idx & (EC_SLOTS_PER_PAGE - 1)];
+    instance_slots_free = slot->next_free;
+
+    gen = (uint32_t) (slot->state >> EC_SLOT_GEN_SHIFT) + 1;
+    if (gen > EC_SLOT_MAX_GEN) {
+        gen = 1;
+    }
+    instance->idesc = (int) ((gen << EC_SLOT_BITS) | idx);
+    slot->instance = instance;
+    /* Publish: lookups that see the live bit also see slot->instance */
+    __atomic_store_n(&slot->state,
+                     ((uint64_t) gen << EC_SLOT_GEN_SHIFT) | EC_SLOT_LIVE,
+                     __ATOMIC_RELEASE);
+
+    mutex_unlock(&instance_slots_lock);
+
+    return instance->idesc;
+}
+
+/*
+ * Retire a descriptor: make new lookups fail, then wait for the calls
+ * still using the instance to finish.  Only one caller can retire a given
+ * descriptor.
+ *
+ * Returns the instance, NULL if the descriptor is unknown or already
+ * being destroyed.
+ */
+static ec_backend_t liberasurecode_backend_instance_retire(int desc)
+{
+    uint32_t gen = 0;
+    struct ec_instance_slot *slot = instance_slot(desc, &gen);
+    uint64_t state;
+
+    if (NULL == slot) {
+        return NULL;
+    }
+
+    state = __atomic_load_n(&slot->state, __ATOMIC_RELAXED);
+    do {
+        if (!slot_state_matches(state, gen)) {
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&slot->state, &state,
+                state & ~EC_SLOT_LIVE, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    while ((__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) &
+            EC_SLOT_REFS_MASK) != 0) {
+        sched_yield();
     }
 
-register_out:
-    rwlock_unlock(&active_instances_rwlock);
-exit:
-    return desc;
+    return slot->instance;
 }
 
 /**
- * Unregister a backend instance
+ * Unregister a backend instance, waiting for in-flight calls on it
  *
  * @returns 0 on success, non-0 on error
  */
 int liberasurecode_backend_instance_unregister(ec_backend_t instance)
 {
-    int rc = 0;  /* return call value */
+    uint32_t gen = 0;
+    struct ec_instance_slot *slot;
 
-    rc = rwlock_wrlock(&active_instances_rwlock);
-    if (rc == 0) {
-        SLIST_REMOVE(&active_instances, instance, ec_backend, link);
-    }  else {
-        goto exit;
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
     }
-    rwlock_unlock(&active_instances_rwlock);
 
-exit:
-    return rc;
+    slot = instance_slot(instance->idesc, &gen);
+    if (NULL == slot) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    /* Retire it first unless liberasurecode_instance_destroy() already did */
+    if (slot_state_matches(__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE),
+                           gen) &&
+            NULL == liberasurecode_backend_instance_retire(instance->idesc)) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    mutex_lock(&instance_slots_lock);
+    slot->instance = NULL;
+    slot->next_free = instance_slots_free;
+    instance_slots_free = instance->idesc & ((1 << EC_SLOT_BITS) - 1);
+    mutex_unlock(&instance_slots_lock);
+
+    return 0;
 }
 
 /* =~=*=~==~=*=~== liberasurecode backend API helpers =~=*=~==~=*=~== */
@@ -217,6 +394,8 @@ liberasurecode_exit(void) {
     int i;
     for (i = 0; i < num_supported_backends; ++i)
         free(ec_backends_supported_str[i]);
+    for (i = 0; i < EC_SLOT_PAGES; ++i)
+        free(instance_slots[i]);
     closelog();
 }
 
@@ -244,6 +423,9 @@ int liberasurecode_backend_available(const ec_backend_id_t backend_id) {
     return 1;
 }
 
+/* struct ec_args up to ct, all that headers before 1.7.0 declare */
+#define EC_ARGS_LEGACY_SIZE     offsetof(struct ec_args, pool_max_bytes)
+
 /**
  * Create a liberasurecode instance and return a descriptor
  * for use with EC operations (encode, decode, reconstruct)
@@ -257,20 +439,34 @@ int liberasurecode_backend_available(const ec_backend_id_t backend_id) {
  *          w - word size, in bits
  *          hd - hamming distance (=m for Reed-Solomon)
  *          ct - fragment checksum type (stored with the fragment metadata)
+ *          pool_max_bytes - cap on cached fragment buffers (0 = no pool)
+ *          flags - EC_ARGS_* instance options
+ *          num_threads - worker threads per instance (0 = none)
+ *          payload_align - fragment payload alignment (0 = 16 bytes)
  *        backend-specific arguments
  *          null_args - arguments for the null backend
  *          flat_xor_hd, jerasure do not require any special args
+ * @param args_size - sizeof(struct ec_args) as the caller was built with;
+ *        fields past it are left to their defaults
  *
  * @returns liberasurecode instance descriptor (int > 0)
  */
-int liberasurecode_instance_create(const ec_backend_id_t id,
-                                   struct ec_args *args)
+int liberasurecode_instance_create_sized(const ec_backend_id_t id,
+                                         struct ec_args *args,
+                                         size_t args_size)
 {
     ec_backend_t instance = NULL;
     struct ec_backend_args bargs;
-    if (!args)
+    struct ec_args uargs;
+    if (!args || args_size < EC_ARGS_LEGACY_SIZE)
         return -EINVALIDPARAMS;
 
+    /* never read past the caller's struct */
+    memset(&uargs, 0, sizeof(uargs));
+    memcpy(&uargs, args,
+           args_size < sizeof(uargs) ? args_size : sizeof(uargs));
+    args = &uargs;
+
     if (id >= EC_BACKENDS_MAX)
         return -EBACKENDNOTSUPP;
 
@@ -281,6 +477,17 @@ int liberasurecode_instance_create(const ec_backend_id_t id,
                   EC_MAX_FRAGMENTS);
         return -EINVALIDPARAMS;
     }
+    switch (args->payload_align) {
+        case 0:
+        case 16:
+        case 32:
+        case 64:
+        case 4096:
+            break;
+        default:
+            log_error("Payload alignment must be 16, 32, 64 or 4096 bytes\n");
+            return -EINVALIDPARAMS;
+    }
 
     /* Allocate memory for ec_backend instance */
     instance = calloc(1, sizeof(*instance));
@@ -292,6 +499,24 @@ int liberasurecode_instance_create(const ec_backend_id_t id,
     memcpy(&(bargs.uargs), args, sizeof (struct ec_args));
     instance->args = bargs;
 
+    if (args->pool_max_bytes > 0) {
+        instance->pool = ec_pool_create(args->pool_max_bytes,
+                args->flags & EC_ARGS_POOL_PREFAULT);
+        if (NULL == instance->pool) {
+            free(instance);
+            return -ENOMEM;
+        }
+    }
+
+    if (args->num_threads > 0) {
+        instance->threads = ec_thread_pool_create(args->num_threads);
+        if (NULL == instance->threads) {
+            ec_pool_destroy(instance->pool);
+            free(instance);
+            return -ENOMEM;
+        }
+    }
+
     /* Open backend .so if not already open */
     /* .so handle is returned in instance->desc.backend_sohandle */
     if (!instance->desc.backend_sohandle) {
@@ -299,6 +524,8 @@ int liberasurecode_instance_create(const ec_backend_id_t id,
         if (!instance->desc.backend_sohandle) {
             /* ignore during init, return the same handle */
             print_dlerror(__func__);
+            ec_thread_pool_destroy(instance->threads);
+            ec_pool_destroy(instance->pool);
             free(instance);
             return -EBACKENDNOTAVAIL;
         }
@@ -308,16 +535,38 @@ int liberasurecode_instance_create(const ec_backend_id_t id,
     instance->desc.backend_desc = instance->common.ops->init(
             &instance->args, instance->desc.backend_sohandle);
     if (NULL == instance->desc.backend_desc) {
+        ec_thread_pool_destroy(instance->threads);
+        ec_pool_destroy(instance->pool);
         free (instance);
         return -EBACKENDINITERR;
     }
 
     /* Register instance and return a descriptor/instance id */
-    instance->idesc = liberasurecode_backend_instance_register(instance);
+    if (liberasurecode_backend_instance_register(instance) <= 0) {
+        instance->common.ops->exit(instance->desc.backend_desc);
+        liberasurecode_backend_close(instance);
+        ec_thread_pool_destroy(instance->threads);
+        ec_pool_destroy(instance->pool);
+        free(instance);
+        return -ENOMEM;
+    }
 
     return instance->idesc;
 }
 
+#undef liberasurecode_instance_create
+
+/*
+ * The entry point of binaries built against headers before 1.7.0, whose
+ * struct ec_args ends with ct.
+ */
+int liberasurecode_instance_create(const ec_backend_id_t id,
+                                   struct ec_args *args)
+{
+    return liberasurecode_instance_create_sized(id, args,
+                                                EC_ARGS_LEGACY_SIZE);
+}
+
 /**
  * Close a liberasurecode instance
  *
@@ -328,7 +577,11 @@ int liberasurecode_instance_destroy(int desc)
     ec_backend_t instance = NULL;  /* instance to destroy */
     int rc = 0;                    /* return code */
 
-    instance = liberasurecode_backend_instance_get_by_desc(desc);
+    /*
+     * Stop new calls from finding the instance and wait for the ones in
+     * flight; after this we are the only user
+     */
+    instance = liberasurecode_backend_instance_retire(desc);
     if (NULL == instance)
         return -EBACKENDNOTAVAIL;
 
@@ -341,6 +594,8 @@ int liberasurecode_instance_destroy(int desc)
     /* Remove instance from registry */
     rc = liberasurecode_backend_instance_unregister(instance);
     if (rc == 0) {
+        ec_thread_pool_destroy(instance->threads);
+        ec_pool_destroy(instance->pool);
         free(instance);
     }
 
@@ -368,7 +623,7 @@ int liberasurecode_encode_cleanup(int desc,
 {
     int i, k, m;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         return -EBACKENDNOTAVAIL;
     }
@@ -376,9 +631,16 @@ int liberasurecode_encode_cleanup(int desc,
     k = instance->args.uargs.k;
     m = instance->args.uargs.m;
 
+    if (instance->args.uargs.flags & EC_ARGS_SLAB_ENCODE) {
+        /* arrays and fragments all live in one slab */
+        free_encode_slab(instance, k, encoded_data, encoded_parity);
+        liberasurecode_backend_instance_put(instance);
+        return 0;
+    }
+
     if (encoded_data) {
         for (i = 0; i < k; i++) {
-            free(encoded_data[i]);
+            instance_free_buffer(instance, encoded_data[i]);
         }
 
         free(encoded_data);
@@ -386,46 +648,69 @@ int liberasurecode_encode_cleanup(int desc,
 
     if (encoded_parity) {
         for (i = 0; i < m; i++) {
-            free(encoded_parity[i]);
+            instance_free_buffer(instance, encoded_parity[i]);
         }
         free(encoded_parity);
     }
 
+    liberasurecode_backend_instance_put(instance);
     return 0;
 }
 
-/**
- * Erasure encode a data buffer
- *
- * @param desc - liberasurecode descriptor/handle
- *        from liberasurecode_instance_create()
- * @param orig_data - data to encode
- * @param orig_data_size - length of data to encode
- * @param encoded_data - pointer to _output_ array (char **) of k data
- *        fragments (char *), allocated by the callee
- * @param encoded_parity - pointer to _output_ array (char **) of m parity
- *        fragments (char *), allocated by the callee
- * @param fragment_len - pointer to _output_ length of each fragment, assuming
- *        all fragments are the same length
- *
- * @return 0 on success, -error code otherwise
+/*
+ * Encode path for column independent backends: copy, encode and CRC one
+ * cache-sized column tile at a time rather than making three passes over
+ * the whole stripe.  MD5 still takes its own (multi-buffer) pass.
  */
-int liberasurecode_encode(int desc,
-        const char *orig_data, uint64_t orig_data_size, /* input */
+static int liberasurecode_encode_tiled(ec_backend_t instance, int k, int m,
+        const struct iovec *iov, int iovcnt, uint64_t orig_data_size,
+        char **encoded_data, char **encoded_parity, int *blocksize)
+{
+    ec_checksum_type_t ct = instance->args.uargs.ct;
+    uint32_t chksums[EC_MAX_FRAGMENTS];
+    bool fused = (ct == CHKSUM_CRC32 || ct == CHKSUM_CRC32C);
+    int ret;
+
+    ret = prepare_fragments_for_encode_tiled(instance, k, m, orig_data_size,
+                                             encoded_data, encoded_parity,
+                                             blocksize);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = instance_backend_encode_tiled(instance, iov, iovcnt,
+                                        orig_data_size, encoded_data,
+                                        encoded_parity, *blocksize,
+                                        fused ? chksums : NULL);
+    if (ret < 0) {
+        // ensure encoded_data/parity point the head of fragment_ptr
+        get_fragment_ptr_array_from_data(encoded_data, encoded_data, k);
+        get_fragment_ptr_array_from_data(encoded_parity, encoded_parity, m);
+        return ret;
+    }
+
+    return finalize_fragments_after_encode_chksums(instance, k, m,
+            *blocksize, orig_data_size, encoded_data, encoded_parity,
+            fused ? chksums : NULL);
+}
+
+/*
+ * Common encode path for liberasurecode_encode() and
+ * liberasurecode_encode_iov(): the data to encode is described by an iovec
+ * list adding up to orig_data_size bytes.
+ */
+static int liberasurecode_encode_impl(int desc,
+        const struct iovec *iov, int iovcnt,            /* input */
+        uint64_t orig_data_size,                        /* input */
         char ***encoded_data, char ***encoded_parity,   /* output */
         uint64_t *fragment_len)                         /* output */
 {
     int k, m;
     int ret = 0;            /* return code */
+    ec_backend_t instance = NULL;
 
     int blocksize = 0;      /* length of each of k data elements */
 
-    if (orig_data == NULL) {
-        log_error("Pointer to data buffer is null!");
-        ret = -EINVALIDPARAMS;
-        goto out;
-    }
-
     if (encoded_data == NULL) {
         log_error("Pointer to encoded data buffers is null!");
         return -EINVALIDPARAMS;
@@ -442,7 +727,7 @@ int liberasurecode_encode(int desc,
         goto out;
     }
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         ret = -EBACKENDNOTAVAIL;
         goto out;
@@ -451,23 +736,48 @@ int liberasurecode_encode(int desc,
     k = instance->args.uargs.k;
     m = instance->args.uargs.m;
 
+    if (instance->args.uargs.flags & EC_ARGS_SLAB_ENCODE) {
+        *encoded_data = NULL;
+        *encoded_parity = NULL;
+        ret = prepare_fragments_for_encode_slab(instance, k, m, iov, iovcnt,
+                                                orig_data_size, encoded_data,
+                                                encoded_parity, &blocksize);
+        if (ret < 0) {
+            goto out;
+        }
+        goto encode;
+    }
+
     /*
      * Allocate arrays for data, parity and missing_idxs
      */
     *encoded_data = (char **) alloc_zeroed_buffer(sizeof(char *) * k);
     if (NULL == *encoded_data) {
         log_error("Could not allocate data buffer!");
+        ret = -ENOMEM;
         goto out;
     }
 
     *encoded_parity = (char **) alloc_zeroed_buffer(sizeof(char *) * m);
     if (NULL == *encoded_parity) {
         log_error("Could not allocate parity buffer!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    if (is_backend_column_independent(instance)) {
+        ret = liberasurecode_encode_tiled(instance, k, m, iov, iovcnt,
+                                          orig_data_size, *encoded_data,
+                                          *encoded_parity, &blocksize);
+        if (ret == 0) {
+            *fragment_len = get_fragment_size((*encoded_data)[0]);
+        }
         goto out;
     }
 
-    ret = prepare_fragments_for_encode(instance, k, m, orig_data, orig_data_size,
-                                       *encoded_data, *encoded_parity, &blocksize);
+    ret = prepare_fragments_for_encode_iov(instance, k, m, iov, iovcnt,
+                                           orig_data_size, *encoded_data,
+                                           *encoded_parity, &blocksize);
     if (ret < 0) {
         // ensure encoded_data/parity point the head of fragment_ptr
         get_fragment_ptr_array_from_data(*encoded_data, *encoded_data, k);
@@ -475,9 +785,10 @@ int liberasurecode_encode(int desc,
         goto out;
     }
 
+encode:
     /* call the backend encode function passing it desc instance */
-    ret = instance->common.ops->encode(instance->desc.backend_desc,
-                                       *encoded_data, *encoded_parity, blocksize);
+    ret = instance_backend_encode(instance, *encoded_data, *encoded_parity,
+                                  blocksize);
     if (ret < 0) {
         // ensure encoded_data/parity point the head of fragment_ptr
         get_fragment_ptr_array_from_data(*encoded_data, *encoded_data, k);
@@ -487,6 +798,9 @@ int liberasurecode_encode(int desc,
 
     ret = finalize_fragments_after_encode(instance, k, m, blocksize, orig_data_size,
                                           *encoded_data, *encoded_parity);
+    if (ret < 0) {
+        goto out;
+    }
 
     *fragment_len = get_fragment_size((*encoded_data)[0]);
 
@@ -496,81 +810,423 @@ out:
         liberasurecode_encode_cleanup(desc, *encoded_data, *encoded_parity);
         log_error("Error in liberasurecode_encode %d", ret);
     }
+    liberasurecode_backend_instance_put(instance);
     return ret;
 }
 
 /**
- * Cleanup structures allocated by librasurecode_decode
- *
- * The caller has no context, so cannot safely free memory
- * allocated by liberasurecode, so it must pass the
- * deallocation responsibility back to liberasurecode.
+ * Erasure encode a data buffer
  *
  * @param desc - liberasurecode descriptor/handle
  *        from liberasurecode_instance_create()
- * @param data - (char *) buffer of data decoded by
- *        librasurecode_decode
- * @return 0 in success; -error otherwise
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
+ * @return 0 on success, -error code otherwise
  */
-int liberasurecode_decode_cleanup(int desc, char *data)
+int liberasurecode_encode(int desc,
+        const char *orig_data, uint64_t orig_data_size, /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len)                         /* output */
 {
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
-    if (NULL == instance) {
-        return -EBACKENDNOTAVAIL;
+    struct iovec iov;
+
+    if (orig_data == NULL) {
+        log_error("Pointer to data buffer is null!");
+        return -EINVALIDPARAMS;
     }
 
-    free(data);
+    iov.iov_base = (void *) orig_data;
+    iov.iov_len = orig_data_size;
 
-    return 0;
+    return liberasurecode_encode_impl(desc, &iov, 1, orig_data_size,
+                                      encoded_data, encoded_parity,
+                                      fragment_len);
 }
 
 /**
- * Reconstruct original data from a set of k encoded fragments
+ * Erasure encode data scattered over an iovec list
  *
  * @param desc - liberasurecode descriptor/handle
  *        from liberasurecode_instance_create()
- * @param fragments - erasure encoded fragments (> = k)
- * @param num_fragments - number of fragments being passed in
- * @param fragment_len - length of each fragment (assume they are the same)
- * @param force_metadata_checks - force fragment metadata checks (default: 0)
- * @param out_data - _output_ pointer to decoded data
- * @param out_data_len - _output_ length of decoded output
+ * @param iov - list of buffers holding the data to encode, in order
+ * @param iovcnt - number of entries in iov
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
  * @return 0 on success, -error code otherwise
  */
-int liberasurecode_decode(int desc,
-        char **available_fragments,                     /* input */
-        int num_fragments, uint64_t fragment_len,       /* input */
-        int force_metadata_checks,                      /* input */
-        char **out_data, uint64_t *out_data_len)        /* output */
+int liberasurecode_encode_iov(int desc,
+        const struct iovec *iov, int iovcnt,            /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len)                         /* output */
 {
-    int i, j;
-    int ret = 0;
+    int i;
+    uint64_t orig_data_size = 0;
 
-    int k = -1, m = -1;
-    int orig_data_size = 0;
+    if (iov == NULL || iovcnt <= 0) {
+        log_error("Invalid iovec list to encode!");
+        return -EINVALIDPARAMS;
+    }
 
-    int blocksize = 0;
-    char **data = NULL;
-    char **parity = NULL;
-    char **data_segments = NULL;
-    char **parity_segments = NULL;
-    int *missing_idxs = NULL;
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_base == NULL && iov[i].iov_len > 0) {
+            log_error("Pointer to data buffer %d is null!", i);
+            return -EINVALIDPARAMS;
+        }
+        orig_data_size += iov[i].iov_len;
+    }
 
-    uint64_t realloc_bm = 0;
+    return liberasurecode_encode_impl(desc, iov, iovcnt, orig_data_size,
+                                      encoded_data, encoded_parity,
+                                      fragment_len);
+}
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
-    if (NULL == instance) {
-        ret = -EBACKENDNOTAVAIL;
+/**
+ * Erasure encode a data buffer into caller-provided fragment buffers
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param encoded_data - array of k caller-owned buffers (char *) that
+ *        receive the data fragments, each 16-byte aligned
+ * @param encoded_parity - array of m caller-owned buffers (char *) that
+ *        receive the parity fragments, each 16-byte aligned
+ * @param fragment_buffer_len - size in bytes of each of the k + m buffers
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_into(int desc,
+        const char *orig_data, uint64_t orig_data_size, /* input */
+        char **encoded_data, char **encoded_parity,     /* output */
+        uint64_t fragment_buffer_len,                   /* input */
+        uint64_t *fragment_len)                         /* output */
+{
+    int i, k, m;
+    int ret = 0;            /* return code */
+    int blocksize = 0;      /* length of each of k data elements */
+    int buffer_size = 0;    /* required size of each caller buffer */
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    ec_backend_t instance = NULL;
+
+    if (orig_data == NULL) {
+        log_error("Pointer to data buffer is null!");
+        ret = -EINVALIDPARAMS;
         goto out;
     }
 
-    if (NULL == available_fragments) {
+    if (encoded_data == NULL || encoded_parity == NULL) {
+        log_error("Pointer to encoded fragment buffers is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (fragment_len == NULL) {
+        log_error("Pointer to fragment length is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+
+    buffer_size = liberasurecode_get_fragment_buffer_size(desc, orig_data_size);
+    if (buffer_size < 0) {
+        ret = buffer_size;
+        goto out;
+    }
+    if (fragment_buffer_len < (uint64_t) buffer_size) {
+        log_error("Fragment buffers too small, need %d, but got %lu.",
+                  buffer_size, (unsigned long)fragment_buffer_len);
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    for (i = 0; i < k + m; i++) {
+        char *buf = (i < k) ? encoded_data[i] : encoded_parity[i - k];
+        if (NULL == buf || !is_addr_aligned((unsigned long) buf, 16)) {
+            log_error("Fragment buffer %d is null or not 16-byte aligned!", i);
+            ret = -EINVALIDPARAMS;
+            goto out;
+        }
+        if (i < k) {
+            data[i] = buf;
+        } else {
+            parity[i - k] = buf;
+        }
+    }
+
+    ret = prepare_fragments_for_encode_into(instance, k, m,
+                                            orig_data, orig_data_size,
+                                            data, parity, &blocksize);
+    if (ret < 0) {
+        goto out;
+    }
+
+    /* call the backend encode function passing it desc instance */
+    ret = instance_backend_encode(instance, data, parity, blocksize);
+    if (ret < 0) {
+        goto out;
+    }
+
+    ret = finalize_fragments_after_encode(instance, k, m, blocksize,
+                                          orig_data_size, data, parity);
+    if (ret < 0) {
+        goto out;
+    }
+
+    *fragment_len = get_fragment_size(data[0]);
+
+out:
+    if (ret) {
+        log_error("Error in liberasurecode_encode_into %d", ret);
+    }
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+/**
+ * Erasure encode a batch of independent data buffers
+ *
+ * Amortizes the per-call setup of liberasurecode_encode() over
+ * num_objects objects: the descriptor is resolved once and all the
+ * stripes, pointer arrays included, share a single allocation.  Either
+ * every object is encoded or none is.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_objects - number of objects to encode
+ * @param orig_data - array of num_objects data buffers to encode
+ * @param orig_data_size - array of num_objects data lengths
+ * @param encoded_data - _output_ array of num_objects (char **) arrays of
+ *        k data fragments
+ * @param encoded_parity - _output_ array of num_objects (char **) arrays
+ *        of m parity fragments
+ * @param fragment_len - _output_ array of num_objects fragment lengths
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_batch(int desc, int num_objects,
+        const char **orig_data, const uint64_t *orig_data_size, /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len)                         /* output */
+{
+    int i, k, m;
+    int ret = 0;
+    int *blocksizes = NULL;
+    ec_backend_t instance = NULL;
+
+    if (num_objects <= 0) {
+        log_error("Invalid number of objects to encode: %d", num_objects);
+        return -EINVALIDPARAMS;
+    }
+
+    if (orig_data == NULL || orig_data_size == NULL) {
+        log_error("Pointer to data buffers is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    if (encoded_data == NULL || encoded_parity == NULL ||
+            fragment_len == NULL) {
+        log_error("Pointer to encoded fragment arrays is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    for (i = 0; i < num_objects; i++) {
+        if (orig_data[i] == NULL) {
+            log_error("Pointer to data buffer %d is null!", i);
+            return -EINVALIDPARAMS;
+        }
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+
+    blocksizes = malloc(sizeof(int) * num_objects);
+    if (NULL == blocksizes) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    ret = prepare_fragments_for_encode_batch(instance, k, m, num_objects,
+                                             orig_data, orig_data_size,
+                                             encoded_data, encoded_parity,
+                                             blocksizes);
+    if (ret < 0) {
+        goto out;
+    }
+
+    /* The stripes sit back to back in the slab, encode them in order */
+    for (i = 0; i < num_objects; i++) {
+        ret = instance_backend_encode(instance, encoded_data[i],
+                                      encoded_parity[i],
+                                      blocksizes[i]);
+        if (ret < 0) {
+            break;
+        }
+        ret = finalize_fragments_after_encode(instance, k, m, blocksizes[i],
+                                              orig_data_size[i],
+                                              encoded_data[i],
+                                              encoded_parity[i]);
+        if (ret < 0) {
+            break;
+        }
+        fragment_len[i] = get_fragment_size(encoded_data[i][0]);
+    }
+
+    if (ret < 0) {
+        /* encoded_data[0] is still the start of the slab */
+        free_encode_slab(instance, k, encoded_data[0], NULL);
+        for (i = 0; i < num_objects; i++) {
+            encoded_data[i] = NULL;
+            encoded_parity[i] = NULL;
+        }
+    }
+
+out:
+    if (ret) {
+        log_error("Error in liberasurecode_encode_batch %d", ret);
+    }
+    free(blocksizes);
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+/**
+ * Cleanup the stripes allocated by liberasurecode_encode_batch
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_objects - number of objects passed to the encode
+ * @param encoded_data - array of data fragment arrays, as returned by
+ *        liberasurecode_encode_batch
+ * @param encoded_parity - array of parity fragment arrays, as returned by
+ *        liberasurecode_encode_batch
+ * @return 0 in success; -error otherwise
+ */
+int liberasurecode_encode_batch_cleanup(int desc, int num_objects,
+                                        char ***encoded_data,
+                                        char ***encoded_parity)
+{
+    int i;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    if (NULL != encoded_data && num_objects > 0) {
+        free_encode_slab(instance, instance->args.uargs.k,
+                         encoded_data[0], NULL);
+        for (i = 0; i < num_objects; i++) {
+            encoded_data[i] = NULL;
+            if (NULL != encoded_parity) {
+                encoded_parity[i] = NULL;
+            }
+        }
+    }
+
+    liberasurecode_backend_instance_put(instance);
+    return 0;
+}
+
+/**
+ * Cleanup structures allocated by librasurecode_decode
+ *
+ * The caller has no context, so cannot safely free memory
+ * allocated by liberasurecode, so it must pass the
+ * deallocation responsibility back to liberasurecode.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data - (char *) buffer of data decoded by
+ *        librasurecode_decode
+ * @return 0 in success; -error otherwise
+ */
+int liberasurecode_decode_cleanup(int desc, char *data)
+{
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    instance_free_buffer(instance, data);
+    liberasurecode_backend_instance_put(instance);
+
+    return 0;
+}
+
+/* A decode plan, see liberasurecode_plan_create() */
+struct ec_decode_plan {
+    int desc;
+    uint64_t missing_bm;        /* fragments not passed in */
+    uint64_t wanted_bm;         /* fragments to reconstruct */
+    int missing_idxs[EC_MAX_FRAGMENTS + 1];
+    void *backend_plan;         /* NULL if the backend has no plans */
+};
+
+/*
+ * Common decode path.  The original data is either returned in a buffer
+ * allocated here (out_data) or, when out_buf is set, written straight into
+ * the caller's buffer of out_buf_len bytes.  With a plan, the fragments
+ * passed in must be the ones the plan was made for.
+ */
+static int liberasurecode_decode_impl(ec_backend_t instance, int desc,
+        const struct ec_decode_plan *plan,              /* input */
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int force_metadata_checks,                      /* input */
+        char **out_data,                                /* output */
+        char *out_buf, uint64_t out_buf_len,            /* output */
+        uint64_t *out_data_len)                         /* output */
+{
+    int i, j;
+    int ret = 0;
+
+    int k = -1, m = -1;
+    int orig_data_size = 0;
+
+    int blocksize = 0;
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    char *data_segments[EC_MAX_FRAGMENTS];
+    char *parity_segments[EC_MAX_FRAGMENTS];
+    int missing_idxs[EC_MAX_FRAGMENTS + 1];
+
+    uint64_t realloc_bm = 0;
+
+    if (NULL == available_fragments) {
         log_error("Pointer to encoded fragments buffer is null!");
         ret = -EINVALIDPARAMS;
         goto out;
     }
 
-    if (NULL == out_data) {
+    if (NULL == out_data && NULL == out_buf) {
         log_error("Pointer to decoded data buffer is null!");
         ret = -EINVALIDPARAMS;
         goto out;
@@ -609,15 +1265,30 @@ int liberasurecode_decode(int desc,
         }
     }
 
+    if (out_buf && out_buf_len <
+            (uint64_t) get_orig_data_size(available_fragments[0])) {
+        log_error("Decode output buffer too small, need %d, but got %lu.",
+                  get_orig_data_size(available_fragments[0]),
+                  (unsigned long)out_buf_len);
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
     if (instance->common.id != EC_BACKEND_SHSS && instance->common.id != EC_BACKEND_LIBPHAZR) {
         /* shss (ntt_backend) & libphazr backend must force to decode */
         // TODO: Add a frag and function to handle whether the backend want to decode or not.
         /*
          * Try to re-assebmle the original data before attempting a decode
          */
-        ret = fragments_to_string(k, m,
-                                  available_fragments, num_fragments,
-                                  out_data, out_data_len);
+        if (out_buf) {
+            ret = fragments_to_buffer(k, m,
+                                      available_fragments, num_fragments,
+                                      out_buf, out_buf_len, out_data_len);
+        } else {
+            ret = fragments_to_string(instance, k, m,
+                                      available_fragments, num_fragments,
+                                      out_data, out_data_len);
+        }
 
         if (ret == 0) {
             /* We were able to get the original data without decoding! */
@@ -625,35 +1296,17 @@ int liberasurecode_decode(int desc,
         }
     }
 
-    /*
-     * Allocate arrays for data, parity and missing_idxs
-     */
-    data = alloc_zeroed_buffer(sizeof(char*) * k);
-    if (NULL == data) {
-        log_error("Could not allocate data buffer!");
-        goto out;
-    }
-
-    parity = alloc_zeroed_buffer(sizeof(char*) * m);
-    if (NULL == parity) {
-        log_error("Could not allocate parity buffer!");
-        goto out;
-    }
-
-    missing_idxs = alloc_and_set_buffer(sizeof(char*) * (k + m), -1);
-    if (NULL == missing_idxs) {
-        log_error("Could not allocate missing_idxs buffer!");
-        goto out;
+    /* Working arrays live on the stack, k + m <= EC_MAX_FRAGMENTS */
+    memset(data, 0, sizeof(data));
+    memset(parity, 0, sizeof(parity));
+    for (i = 0; i <= k + m; i++) {
+        missing_idxs[i] = -1;
     }
 
     /* If metadata checks requested, check fragment integrity upfront */
     if (force_metadata_checks) {
-        int num_invalid_fragments = 0;
-        for (i = 0; i < num_fragments; ++i) {
-            if (is_invalid_fragment(desc, available_fragments[i])) {
-                ++num_invalid_fragments;
-            }
-        }
+        int num_invalid_fragments = find_invalid_fragments(instance, desc,
+                available_fragments, num_fragments, NULL);
         if ((num_fragments - num_invalid_fragments) < k) {
             ret = -EINSUFFFRAGS;
             log_error("Not enough valid fragments available for decode!");
@@ -673,6 +1326,13 @@ int liberasurecode_decode(int desc,
         goto out;
     }
 
+    if (NULL != plan &&
+            convert_list_to_bitmap(missing_idxs) != plan->missing_bm) {
+        log_error("Fragments do not match the decode plan!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
     /*
      * Preparing the fragments for decode.  This will alloc aligned buffers
      * when unaligned buffers were passed in available_fragments.  It passes
@@ -680,7 +1340,7 @@ int liberasurecode_decode(int desc,
      * (realloc_bm).
      *
      */
-    ret = prepare_fragments_for_decode(k, m,
+    ret = prepare_fragments_for_decode(instance, k, m,
                                        data, parity, missing_idxs, 
                                        &orig_data_size, &blocksize,
                                        fragment_len, &realloc_bm);
@@ -689,13 +1349,12 @@ int liberasurecode_decode(int desc,
         goto out;
     }
 
-    data_segments = alloc_zeroed_buffer(k * sizeof(char *));
-    parity_segments = alloc_zeroed_buffer(m * sizeof(char *));
     get_data_ptr_array_from_fragments(data_segments, data, k);
     get_data_ptr_array_from_fragments(parity_segments, parity, m);
 
     /* call the backend decode function passing it desc instance */
-    ret = instance->common.ops->decode(instance->desc.backend_desc,
+    ret = instance_backend_decode_plan(instance,
+                                       plan ? plan->backend_plan : NULL,
                                        data_segments, parity_segments,
                                        missing_idxs, blocksize);
 
@@ -724,7 +1383,12 @@ int liberasurecode_decode(int desc,
     }
 
     /* Try to generate the original string */
-    ret = fragments_to_string(k, m, data, k, out_data, out_data_len);
+    if (out_buf) {
+        ret = fragments_to_buffer(k, m, data, k,
+                                  out_buf, out_buf_len, out_data_len);
+    } else {
+        ret = fragments_to_string(instance, k, m, data, k, out_data, out_data_len);
+    }
 
     if (ret < 0) {
         log_error("Could not convert decoded fragments to a string!");
@@ -735,81 +1399,879 @@ out:
     if (realloc_bm != 0) {
         for (i = 0; i < k; i++) {
             if (realloc_bm & (1 << i)) {
-                free(data[i]);
+                instance_free_buffer(instance, data[i]);
             }
         }
 
         for (i = 0; i < m; i++) {
             if (realloc_bm & (1 << (i + k))) {
-                free(parity[i]);
+                instance_free_buffer(instance, parity[i]);
             }
         }
     }
 
-    free(data);
-    free(parity);
-    free(missing_idxs);
-    free(data_segments);
-    free(parity_segments);
-
     return ret;
 }
 
 /**
- * Reconstruct a missing fragment from a subset of available fragments
+ * Reconstruct original data from a set of k encoded fragments
  *
  * @param desc - liberasurecode descriptor/handle
  *        from liberasurecode_instance_create()
- * @param fragment_len - size in bytes of the fragments
- * @param available_fragments - erasure encoded fragments
+ * @param fragments - erasure encoded fragments (> = k)
  * @param num_fragments - number of fragments being passed in
- * @param destination_idx - missing idx to reconstruct
- * @param out_fragment - output of reconstruct
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_data - _output_ pointer to decoded data
+ * @param out_data_len - _output_ length of decoded output
  * @return 0 on success, -error code otherwise
  */
-int liberasurecode_reconstruct_fragment(int desc,
+int liberasurecode_decode(int desc,
         char **available_fragments,                     /* input */
         int num_fragments, uint64_t fragment_len,       /* input */
-        int destination_idx,                            /* input */
-        char* out_fragment)                             /* output */
+        int force_metadata_checks,                      /* input */
+        char **out_data, uint64_t *out_data_len)        /* output */
 {
-    int ret = 0;
-    int blocksize = 0;
-    int orig_data_size = 0;
-    char **data = NULL;
-    char **parity = NULL;
-    int *missing_idxs = NULL;
-    char *fragment_ptr = NULL;
-    int is_destination_missing = 0;
-    int k = -1;
-    int m = -1;
-    int i;
-    uint64_t realloc_bm = 0;
-    char **data_segments = NULL;
-    char **parity_segments = NULL;
-    int set_chksum = 1;
+    int ret;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
-        ret = -EBACKENDNOTAVAIL;
-        goto out;
+        return -EBACKENDNOTAVAIL;
     }
 
-    if (NULL == available_fragments) {
-        log_error("Can not reconstruct fragment, available fragments pointer is NULL");
-        ret = -EINVALIDPARAMS;
-        goto out;
-    }
+    ret = liberasurecode_decode_impl(instance, desc, NULL,
+                                     available_fragments,
+                                     num_fragments, fragment_len,
+                                     force_metadata_checks,
+                                     out_data, NULL, 0, out_data_len);
+    liberasurecode_backend_instance_put(instance);
 
-    if (NULL == out_fragment) {
-        log_error("Can not reconstruct fragment, output fragment pointer is NULL");
-        ret = -EINVALIDPARAMS;
-        goto out;
+    return ret;
+}
+
+/**
+ * Reconstruct original data from a set of k encoded fragments into a
+ * caller-provided buffer
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_data - caller buffer that receives the decoded data
+ * @param out_data_cap - size in bytes of out_data
+ * @param out_data_len - _output_ length of decoded output
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_into(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int force_metadata_checks,                      /* input */
+        char *out_data, uint64_t out_data_cap,          /* output */
+        uint64_t *out_data_len)                         /* output */
+{
+    int ret;
+    ec_backend_t instance = NULL;
+
+    if (NULL == out_data) {
+        log_error("Pointer to decoded data buffer is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    ret = liberasurecode_decode_impl(instance, desc, NULL,
+                                     available_fragments,
+                                     num_fragments, fragment_len,
+                                     force_metadata_checks,
+                                     NULL, out_data, out_data_cap,
+                                     out_data_len);
+    liberasurecode_backend_instance_put(instance);
+
+    return ret;
+}
+
+/**
+ * Reconstruct a batch of independent objects
+ *
+ * Amortizes the per-call setup of liberasurecode_decode() over
+ * num_objects objects: the descriptor is resolved once and the decoded
+ * objects share a single output allocation.  Either every object is
+ * decoded or none is.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_objects - number of objects to decode
+ * @param available_fragments - array of num_objects fragment arrays
+ * @param num_fragments - array of num_objects fragment counts
+ * @param fragment_len - array of num_objects fragment lengths
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_data - _output_ array of num_objects pointers to decoded data
+ * @param out_data_len - _output_ array of num_objects decoded lengths
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_batch(int desc, int num_objects,
+        char ***available_fragments,                    /* input */
+        const int *num_fragments,                       /* input */
+        const uint64_t *fragment_len,                   /* input */
+        int force_metadata_checks,                      /* input */
+        char **out_data, uint64_t *out_data_len)        /* output */
+{
+    int i;
+    int ret = 0;
+    uint64_t total_size = 0;
+    char *buf = NULL;
+    ec_backend_t instance = NULL;
+
+    if (num_objects <= 0) {
+        log_error("Invalid number of objects to decode: %d", num_objects);
+        return -EINVALIDPARAMS;
+    }
+
+    if (NULL == available_fragments || NULL == num_fragments ||
+            NULL == fragment_len) {
+        log_error("Pointer to encoded fragments buffer is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    if (NULL == out_data || NULL == out_data_len) {
+        log_error("Pointer to decoded data buffers is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    /* Size every object up front so they can share one buffer */
+    for (i = 0; i < num_objects; i++) {
+        int orig_data_size;
+
+        if (NULL == available_fragments[i] || num_fragments[i] <= 0 ||
+                fragment_len[i] < sizeof(fragment_header_t)) {
+            log_error("Invalid fragments for object %d!", i);
+            ret = -EINVALIDPARAMS;
+            goto out;
+        }
+        if (is_invalid_fragment_header(
+                (fragment_header_t *) available_fragments[i][0])) {
+            log_error("Invalid fragment header information!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+        orig_data_size = get_orig_data_size(available_fragments[i][0]);
+        if (orig_data_size < 0) {
+            ret = -EBADHEADER;
+            goto out;
+        }
+        out_data_len[i] = orig_data_size;
+        total_size += (orig_data_size + EC_SLAB_ALIGN - 1) &
+                      ~(EC_SLAB_ALIGN - 1);
+    }
+
+    buf = instance_alloc_buffer_uninit(instance,
+                                       total_size ? total_size : 1);
+    if (NULL == buf) {
+        log_error("Could not allocate batch output buffer!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    total_size = 0;
+    for (i = 0; i < num_objects; i++) {
+        uint64_t cap = out_data_len[i];
+
+        out_data[i] = buf + total_size;
+        ret = liberasurecode_decode_impl(instance, desc, NULL,
+                                         available_fragments[i],
+                                         num_fragments[i], fragment_len[i],
+                                         force_metadata_checks,
+                                         NULL, out_data[i], cap,
+                                         &out_data_len[i]);
+        if (ret < 0) {
+            goto out;
+        }
+        total_size += (cap + EC_SLAB_ALIGN - 1) & ~(EC_SLAB_ALIGN - 1);
+    }
+
+out:
+    if (ret < 0) {
+        instance_free_buffer(instance, buf);
+        for (i = 0; i < num_objects; i++) {
+            out_data[i] = NULL;
+        }
+        log_error("Error in liberasurecode_decode_batch %d", ret);
+    }
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+/**
+ * Cleanup the buffer allocated by liberasurecode_decode_batch
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_objects - number of objects passed to the decode
+ * @param out_data - array of decoded data pointers, as returned by
+ *        liberasurecode_decode_batch
+ * @return 0 in success; -error otherwise
+ */
+int liberasurecode_decode_batch_cleanup(int desc, int num_objects,
+                                        char **out_data)
+{
+    int i;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    if (NULL != out_data && num_objects > 0) {
+        /* every object points into the buffer starting at out_data[0] */
+        instance_free_buffer(instance, out_data[0]);
+        for (i = 0; i < num_objects; i++) {
+            out_data[i] = NULL;
+        }
+    }
+
+    liberasurecode_backend_instance_put(instance);
+    return 0;
+}
+
+/**
+ * Decode a set of fragments into an iovec view of the original data
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param iov - _output_ array of at least k iovecs
+ * @param iovcnt - capacity of iov on input, entries used on output
+ * @param decoded_fragments - _output_ buffers backing rebuilt data, to be
+ *        released with liberasurecode_decode_iov_cleanup()
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_iov(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int force_metadata_checks,                      /* input */
+        struct iovec *iov, int *iovcnt,                 /* output */
+        char ***decoded_fragments)                      /* output */
+{
+    int i, j;
+    int ret = 0;
+    int k = -1, m = -1;
+    int orig_data_size = 0;
+    int blocksize = 0;
+    int num_missing_data = 0;
+    char *src[EC_MAX_FRAGMENTS];    /* caller's fragments, by index */
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    char *data_segments[EC_MAX_FRAGMENTS];
+    char *parity_segments[EC_MAX_FRAGMENTS];
+    int missing_idxs[EC_MAX_FRAGMENTS + 1];
+    uint64_t realloc_bm = 0;
+    uint64_t remaining;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    if (NULL != decoded_fragments) {
+        *decoded_fragments = NULL;
+    }
+
+    if (NULL == available_fragments) {
+        log_error("Pointer to encoded fragments buffer is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (NULL == iov || NULL == iovcnt || NULL == decoded_fragments) {
+        log_error("Pointer to decoded iovec output is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+
+    if (*iovcnt < k) {
+        log_error("Need room for %d iovecs, but got %d!", k, *iovcnt);
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (num_fragments < k) {
+        log_error("Not enough fragments to decode, got %d, need %d!",
+                  num_fragments, k);
+        ret = -EINSUFFFRAGS;
+        goto out;
+    }
+
+    if (fragment_len < sizeof(fragment_header_t)) {
+        log_error("Fragments not long enough to include headers! "
+                  "Need %zu, but got %lu.", sizeof(fragment_header_t),
+                  (unsigned long)fragment_len);
+        ret = -EBADHEADER;
+        goto out;
+    }
+
+    if (instance->common.id == EC_BACKEND_SHSS ||
+            instance->common.id == EC_BACKEND_LIBPHAZR) {
+        /*
+         * shss & libphazr data fragments do not hold the original data,
+         * so there is nothing to point into: hand back a full decode.
+         */
+        char *out_data = NULL;
+        uint64_t out_data_len = 0;
+
+        *decoded_fragments = alloc_zeroed_buffer(sizeof(char *) * k);
+        if (NULL == *decoded_fragments) {
+            ret = -ENOMEM;
+            goto out;
+        }
+        ret = liberasurecode_decode(desc, available_fragments, num_fragments,
+                                    fragment_len, force_metadata_checks,
+                                    &out_data, &out_data_len);
+        if (ret < 0) {
+            goto out;
+        }
+        (*decoded_fragments)[0] = out_data;
+        iov[0].iov_base = out_data;
+        iov[0].iov_len = out_data_len;
+        *iovcnt = out_data_len > 0 ? 1 : 0;
+        goto out;
+    }
+
+    for (i = 0; i < num_fragments; ++i) {
+        /* Verify metadata checksum */
+        if (is_invalid_fragment_header(
+                (fragment_header_t *) available_fragments[i])) {
+            log_error("Invalid fragment header information!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+    }
+
+    /* If metadata checks requested, check fragment integrity upfront */
+    if (force_metadata_checks) {
+        int num_invalid_fragments = find_invalid_fragments(instance, desc,
+                available_fragments, num_fragments, NULL);
+        if ((num_fragments - num_invalid_fragments) < k) {
+            log_error("Not enough valid fragments available for decode!");
+            ret = -EINSUFFFRAGS;
+            goto out;
+        }
+    }
+
+    for (i = 0; i <= k + m; i++) {
+        missing_idxs[i] = -1;
+    }
+    ret = get_fragment_partition(k, m, available_fragments, num_fragments,
+                                 data, parity, missing_idxs);
+    if (ret < 0) {
+        log_error("Could not properly partition the fragments!");
+        goto out;
+    }
+    for (i = 0; i < k; i++) {
+        src[i] = data[i];
+        if (NULL == data[i]) {
+            num_missing_data++;
+        }
+    }
+
+    if (num_missing_data > 0) {
+        /*
+         * Only the missing data fragments are rebuilt, one at a time; the
+         * present ones are referenced in place below.
+         */
+        ret = prepare_fragments_for_decode(instance, k, m,
+                                           data, parity, missing_idxs,
+                                           &orig_data_size, &blocksize,
+                                           fragment_len, &realloc_bm);
+        if (ret < 0) {
+            log_error("Could not prepare fragments for decode!");
+            goto out;
+        }
+        get_data_ptr_array_from_fragments(data_segments, data, k);
+        get_data_ptr_array_from_fragments(parity_segments, parity, m);
+
+        for (j = 0; missing_idxs[j] >= 0 && missing_idxs[j] < k; j++) {
+            ret = instance_backend_reconstruct(instance, data_segments,
+                                               parity_segments,
+                                               missing_idxs,
+                                               missing_idxs[j],
+                                               blocksize);
+            if (ret < 0) {
+                log_error("Could not reconstruct fragment!");
+                goto out;
+            }
+        }
+
+        *decoded_fragments = alloc_zeroed_buffer(sizeof(char *) * k);
+        if (NULL == *decoded_fragments) {
+            ret = -ENOMEM;
+            goto out;
+        }
+        for (i = 0; i < k; i++) {
+            if (NULL == src[i]) {
+                /* keep the rebuilt buffer alive for the caller */
+                (*decoded_fragments)[i] = data[i];
+                realloc_bm &= ~(1ULL << i);
+            }
+        }
+    } else {
+        orig_data_size = get_orig_data_size(data[0]);
+        if (orig_data_size < 0) {
+            log_error("Invalid orig_data_size in fragment header!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+    }
+
+    /* Point into the payloads, trimmed to the original data size */
+    remaining = orig_data_size;
+    for (i = 0, j = 0; i < k && remaining > 0; i++) {
+        char *fragment = src[i] ? src[i] : data[i];
+        uint64_t len = src[i] ? get_fragment_payload_size(src[i]) : blocksize;
+        if (len > remaining) {
+            len = remaining;
+        }
+        iov[j].iov_base = get_data_ptr_from_fragment(fragment);
+        iov[j].iov_len = len;
+        remaining -= len;
+        j++;
+    }
+    *iovcnt = j;
+
+out:
+    /* Free the copies and parity buffers from prepare_fragments_for_decode */
+    for (i = 0; i < k + m; i++) {
+        if (realloc_bm & (1ULL << i)) {
+            instance_free_buffer(instance, i < k ? data[i] : parity[i - k]);
+        }
+    }
+    if (ret < 0 && NULL != decoded_fragments && *decoded_fragments) {
+        liberasurecode_decode_iov_cleanup(desc, *decoded_fragments);
+        *decoded_fragments = NULL;
+    }
+    liberasurecode_backend_instance_put(instance);
+
+    return ret;
+}
+
+/**
+ * Release the buffers handed back by liberasurecode_decode_iov()
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param decoded_fragments - buffers returned by liberasurecode_decode_iov()
+ * @return 0 in success; -error otherwise
+ */
+int liberasurecode_decode_iov_cleanup(int desc, char **decoded_fragments)
+{
+    int i, k;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    if (NULL != decoded_fragments) {
+        k = instance->args.uargs.k;
+        for (i = 0; i < k; i++) {
+            instance_free_buffer(instance, decoded_fragments[i]);
+        }
+        free(decoded_fragments);
+    }
+    liberasurecode_backend_instance_put(instance);
+
+    return 0;
+}
+
+/* Window granularity of range decodes, keeps the backends' SIMD aligned */
+#define EC_RANGE_ALIGN  16
+
+/*
+ * Run the backend decode on payload bytes [start, end) of every fragment,
+ * rebuilding the missing fragments of that window into scratch buffers.
+ */
+static int decode_range_window(ec_backend_t instance, int k, int m,
+        char **data, char **parity, int *missing_idxs, int blocksize,
+        char **scratch, uint64_t start, uint64_t end)
+{
+    int i;
+    uint64_t len = end - start;
+    char *segments[EC_MAX_FRAGMENTS];
+
+    for (i = 0; i < k + m; i++) {
+        char *fragment = (i < k) ? data[i] : parity[i - k];
+        char *payload = NULL;
+
+        if (NULL != fragment) {
+            payload = get_data_ptr_from_fragment(fragment) + start;
+        }
+        if (NULL == payload ||
+                !is_addr_aligned((unsigned long) payload, EC_RANGE_ALIGN)) {
+            if (NULL == scratch[i]) {
+                scratch[i] = instance_alloc_buffer_uninit(instance, blocksize);
+                if (NULL == scratch[i]) {
+                    return -ENOMEM;
+                }
+            }
+            if (NULL == payload) {
+                /* some backends accumulate into the missing payloads */
+                memset(scratch[i], 0, len);
+            } else {
+                memcpy(scratch[i], payload, len);
+            }
+            payload = scratch[i];
+        }
+        segments[i] = payload;
+    }
+
+    return instance_backend_decode(instance, segments, segments + k,
+                                   missing_idxs, len);
+}
+
+/**
+ * Reconstruct a byte range of the original data
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param offset - offset of the range in the original data
+ * @param length - length of the range
+ * @param out - caller buffer of at least length bytes
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_range(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        uint64_t offset, uint64_t length,               /* input */
+        char *out)                                      /* output */
+{
+    int i, k = -1, m = -1;
+    int ret = 0;
+    int orig_data_size = -1, blocksize = -1;
+    int first, last;
+    bool need_decode = false;
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    char *scratch[EC_MAX_FRAGMENTS] = { NULL };
+    int missing_idxs[EC_MAX_FRAGMENTS + 1];
+    uint64_t win_start = 0, win_end = 0;    /* window decoded last */
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    if (NULL == available_fragments || (NULL == out && length > 0)) {
+        log_error("Pointer to fragments or output buffer is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+
+    if (num_fragments < k) {
+        log_error("Not enough fragments to decode, got %d, need %d!",
+                  num_fragments, k);
+        ret = -EINSUFFFRAGS;
+        goto out;
+    }
+
+    if (fragment_len < sizeof(fragment_header_t)) {
+        log_error("Fragments not long enough to include headers! "
+                  "Need %zu, but got %lu.", sizeof(fragment_header_t),
+                  (unsigned long)fragment_len);
+        ret = -EBADHEADER;
+        goto out;
+    }
+
+    for (i = 0; i < num_fragments; ++i) {
+        if (is_invalid_fragment_header(
+                (fragment_header_t *) available_fragments[i])) {
+            log_error("Invalid fragment header information!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+    }
+
+    for (i = 0; i <= k + m; i++) {
+        missing_idxs[i] = -1;
+    }
+    ret = get_fragment_partition(k, m, available_fragments, num_fragments,
+                                 data, parity, missing_idxs);
+    if (ret < 0) {
+        log_error("Could not properly partition the fragments!");
+        goto out;
+    }
+
+    orig_data_size = get_orig_data_size(available_fragments[0]);
+    blocksize = get_fragment_payload_size(available_fragments[0]);
+    if (orig_data_size < 0 || blocksize <= 0) {
+        log_error("Invalid data size in fragment header!");
+        ret = -EBADHEADER;
+        goto out;
+    }
+
+    if (offset > (uint64_t) orig_data_size ||
+            length > (uint64_t) orig_data_size - offset) {
+        log_error("Range %lu+%lu is past the end of the data (%d bytes)!",
+                  (unsigned long) offset, (unsigned long) length,
+                  orig_data_size);
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+    if (0 == length) {
+        goto out;
+    }
+
+    first = offset / blocksize;
+    last = (offset + length - 1) / blocksize;
+    for (i = first; i <= last; i++) {
+        if (NULL == data[i]) {
+            need_decode = true;
+        }
+    }
+
+    if (instance->common.id == EC_BACKEND_SHSS ||
+            instance->common.id == EC_BACKEND_LIBPHAZR ||
+            (need_decode && !is_backend_column_independent(instance))) {
+        /* No way around a full decode, then copy the slice out */
+        char *full = NULL;
+        uint64_t full_len = 0;
+
+        ret = liberasurecode_decode_impl(instance, desc, NULL,
+                                         available_fragments,
+                                         num_fragments, fragment_len, 0,
+                                         &full, NULL, 0, &full_len);
+        if (ret == 0) {
+            memcpy(out, full + offset, length);
+        }
+        instance_free_buffer(instance, full);
+        goto out;
+    }
+
+    for (i = first; i <= last; i++) {
+        uint64_t start = (i == first) ? offset - (uint64_t) i * blocksize : 0;
+        uint64_t end = (i == last) ?
+                offset + length - (uint64_t) i * blocksize : blocksize;
+        char *dst = out + ((uint64_t) i * blocksize + start - offset);
+
+        if (NULL != data[i]) {
+            /* Present: copy just the slice */
+            memcpy(dst, get_data_ptr_from_fragment(data[i]) + start,
+                   end - start);
+            continue;
+        }
+
+        /* Missing: decode the aligned window around the slice */
+        if (win_end == 0 || win_start > start || win_end < end) {
+            win_start = start & ~((uint64_t) EC_RANGE_ALIGN - 1);
+            win_end = (end + EC_RANGE_ALIGN - 1) &
+                      ~((uint64_t) EC_RANGE_ALIGN - 1);
+            if (win_end > (uint64_t) blocksize) {
+                win_end = blocksize;
+            }
+            ret = decode_range_window(instance, k, m, data, parity,
+                                      missing_idxs, blocksize, scratch,
+                                      win_start, win_end);
+            if (ret < 0) {
+                log_error("Encountered error in backend decode function!");
+                goto out;
+            }
+        }
+        memcpy(dst, scratch[i] + (start - win_start), end - start);
+    }
+
+out:
+    for (i = 0; i < k + m; i++) {
+        instance_free_buffer(instance, scratch[i]);
+    }
+    if (ret < 0) {
+        log_error("Error in liberasurecode_decode_range %d", ret);
+    }
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+/**
+ * Work out which parts of which fragments liberasurecode_decode_range()
+ * reads for a byte range of the original data
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data_size - size of the original data (segment)
+ * @param offset - offset of the range in the original data
+ * @param length - length of the range
+ * @param ranges - _output_ data fragment ranges holding the bytes
+ * @param num_ranges - capacity of ranges on input, entries used on output
+ * @param decode_window - _output_ range needed from k fragments when any
+ *        of the data fragments in ranges is unavailable
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_get_fragment_ranges(int desc,
+        uint64_t orig_data_size, uint64_t offset, uint64_t length,
+        struct ec_fragment_range *ranges, int *num_ranges,
+        struct ec_fragment_range *decode_window)
+{
+    int i, k, first, last;
+    int ret = 0;
+    uint64_t blocksize;
+    uint64_t win_start, win_end;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    if (NULL == ranges || NULL == num_ranges || NULL == decode_window ||
+            orig_data_size > INT_MAX || offset > orig_data_size ||
+            length > orig_data_size - offset) {
+        log_error("Invalid fragment range query!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (instance->common.id == EC_BACKEND_SHSS ||
+            instance->common.id == EC_BACKEND_LIBPHAZR) {
+        /* data fragments do not hold the plaintext */
+        ret = -EECMETHODNOTIMPL;
+        goto out;
+    }
+
+    k = instance->args.uargs.k;
+    blocksize = get_aligned_data_size(instance, orig_data_size) / k;
+
+    decode_window->index = -1;
+    decode_window->offset = sizeof(fragment_header_t);
+    decode_window->length = 0;
+    if (0 == length) {
+        *num_ranges = 0;
+        goto out;
+    }
+
+    first = offset / blocksize;
+    last = (offset + length - 1) / blocksize;
+    if (last - first + 1 > *num_ranges) {
+        log_error("Need room for %d fragment ranges, but got %d!",
+                  last - first + 1, *num_ranges);
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    for (i = first; i <= last; i++) {
+        uint64_t start = (i == first) ? offset - i * blocksize : 0;
+        uint64_t end = (i == last) ? offset + length - i * blocksize
+                                   : blocksize;
+
+        ranges[i - first].index = i;
+        ranges[i - first].offset = sizeof(fragment_header_t) + start;
+        ranges[i - first].length = end - start;
+    }
+    *num_ranges = last - first + 1;
+
+    if (is_backend_column_independent(instance)) {
+        /* Hull of the windows decode_range_window() may be run on */
+        win_start = (first == last) ?
+                (offset - first * blocksize) &
+                ~((uint64_t) EC_RANGE_ALIGN - 1) : 0;
+        win_end = (first == last) ?
+                (offset + length - first * blocksize + EC_RANGE_ALIGN - 1) &
+                ~((uint64_t) EC_RANGE_ALIGN - 1) : blocksize;
+        if (win_end > blocksize) {
+            win_end = blocksize;
+        }
+    } else {
+        win_start = 0;
+        win_end = blocksize;
+    }
+    decode_window->offset = sizeof(fragment_header_t) + win_start;
+    decode_window->length = win_end - win_start;
+
+out:
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+/*
+ * Common reconstruct path, for one or more destinations.  The fragments
+ * are checked, partitioned and aligned once, and the backend rebuilds
+ * all the destinations from that.  With a plan, the fragments passed in
+ * must be the ones the plan was made for and every destination one it
+ * wants.
+ */
+static int liberasurecode_reconstruct_impl(ec_backend_t instance,
+        const struct ec_decode_plan *plan,              /* input */
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int *destination_idxs,                          /* input */
+        char **out_fragments)                           /* output */
+{
+    int ret = 0;
+    int blocksize = 0;
+    int orig_data_size = 0;
+    char **data = NULL;
+    char **parity = NULL;
+    int *missing_idxs = NULL;
+    char *fragment_ptr = NULL;
+    int rebuild_idxs[EC_MAX_FRAGMENTS + 1];
+    int num_rebuild = 0;
+    uint64_t missing_bm = 0;
+    uint64_t destination_bm = 0;
+    int k = -1;
+    int m = -1;
+    int i;
+    uint64_t realloc_bm = 0;
+    char **data_segments = NULL;
+    char **parity_segments = NULL;
+    int set_chksum = 1;
+
+    if (NULL == available_fragments) {
+        log_error("Can not reconstruct fragment, available fragments pointer is NULL");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (NULL == destination_idxs || NULL == out_fragments) {
+        log_error("Can not reconstruct fragment, output fragment pointer is NULL");
+        ret = -EINVALIDPARAMS;
+        goto out;
     }
 
     k = instance->args.uargs.k;
     m = instance->args.uargs.m;
 
+    for (i = 0; destination_idxs[i] >= 0; i++) {
+        if (destination_idxs[i] >= k + m ||
+                (destination_bm & (1ULL << destination_idxs[i]))) {
+            log_error("Invalid destination index %d!", destination_idxs[i]);
+            ret = -EINVALIDPARAMS;
+            goto out;
+        }
+        if (NULL == out_fragments[i]) {
+            log_error("Can not reconstruct fragment, output fragment pointer is NULL");
+            ret = -EINVALIDPARAMS;
+            goto out;
+        }
+        destination_bm |= 1ULL << destination_idxs[i];
+    }
+
     for (i = 0; i < num_fragments; i++) {
         /* Verify metadata checksum */
         if (is_invalid_fragment_header(
@@ -856,6 +2318,15 @@ int liberasurecode_reconstruct_fragment(int desc,
         goto out;
     }
 
+    missing_bm = convert_list_to_bitmap(missing_idxs);
+    if (NULL != plan &&
+            (missing_bm != plan->missing_bm ||
+             (destination_bm & ~plan->wanted_bm))) {
+        log_error("Fragments do not match the decode plan!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
     /*
      * Odd corner-case: If the caller passes in a destination_idx that
      * is also included in the available fragments list, we should *not*
@@ -865,22 +2336,45 @@ int liberasurecode_reconstruct_fragment(int desc,
      * should probably log and return an error.
      *
      */
-    i = 0;
-    while (missing_idxs[i] > -1) {
-        if (missing_idxs[i] == destination_idx) {
-            is_destination_missing = 1;
+    for (i = 0; destination_idxs[i] >= 0; i++) {
+        if (missing_bm & (1ULL << destination_idxs[i])) {
+            rebuild_idxs[num_rebuild++] = destination_idxs[i];
         }
-        i++;
     }
+    rebuild_idxs[num_rebuild] = -1;
+
+    if (num_rebuild < i) {
+        log_warn("Dest idx for reconstruction was supplied as available buffer!");
+    }
+
+    if (0 == num_rebuild) {
+        goto destination_available;
+    }
+
+    /*
+     * Rebuild straight into the output buffers whose payload is aligned
+     * the way prepare_fragments_for_decode() wants, rather than into scratch
+     * fragments copied out afterwards.  Missing payloads start zeroed, as
+     * some backends accumulate into them.
+     */
+    for (i = 0; i < num_rebuild; i++) {
+        int idx = rebuild_idxs[i];
+        int j = 0;
 
-    if (!is_destination_missing) {
-        if (destination_idx < k) {
-            fragment_ptr = data[destination_idx];
+        while (destination_idxs[j] != idx) {
+            j++;
+        }
+        if (!is_addr_aligned((unsigned long) out_fragments[j] +
+                             sizeof(fragment_header_t),
+                             instance_payload_align(instance))) {
+            continue;
+        }
+        memset(out_fragments[j], 0, fragment_len);
+        if (idx < k) {
+            data[idx] = out_fragments[j];
         } else {
-            fragment_ptr = parity[destination_idx - k];
+            parity[idx - k] = out_fragments[j];
         }
-        log_warn("Dest idx for reconstruction was supplied as available buffer!");
-        goto destination_available;
     }
 
     /*
@@ -889,7 +2383,7 @@ int liberasurecode_reconstruct_fragment(int desc,
      * It passes back a bitmap telling us which buffers need to be freed by
      * us (realloc_bm).
      */
-    ret = prepare_fragments_for_decode(k, m, data, parity, missing_idxs,
+    ret = prepare_fragments_for_decode(instance, k, m, data, parity, missing_idxs,
                                        &orig_data_size, &blocksize,
                                        fragment_len, &realloc_bm);
     if (ret < 0) {
@@ -903,9 +2397,10 @@ int liberasurecode_reconstruct_fragment(int desc,
 
 
     /* call the backend reconstruct function passing it desc instance */
-    ret = instance->common.ops->reconstruct(instance->desc.backend_desc,
+    ret = instance_backend_reconstruct_many(instance,
+                                            plan ? plan->backend_plan : NULL,
                                             data_segments, parity_segments,
-                                            missing_idxs, destination_idx,
+                                            missing_idxs, rebuild_idxs,
                                             blocksize);
     if (ret < 0) {
         log_error("Could not reconstruct fragment!");
@@ -913,38 +2408,47 @@ int liberasurecode_reconstruct_fragment(int desc,
     }
 
     /*
-     * Update the header to reflect the newly constructed fragment
+     * Update the headers to reflect the newly constructed fragments
      */
-    if (destination_idx < k) {
-        fragment_ptr = data[destination_idx];
-    } else {
-        fragment_ptr = parity[destination_idx - k];
+    for (i = 0; i < num_rebuild; i++) {
+        int idx = rebuild_idxs[i];
+
+        fragment_ptr = idx < k ? data[idx] : parity[idx - k];
+        init_fragment_header(fragment_ptr);
+        add_fragment_metadata(instance, fragment_ptr, idx,
+                              orig_data_size, blocksize,
+                              instance->args.uargs.ct, set_chksum);
     }
-    init_fragment_header(fragment_ptr);
-    add_fragment_metadata(instance, fragment_ptr, destination_idx,
-                          orig_data_size, blocksize, instance->args.uargs.ct,
-                          set_chksum);
 
 destination_available:
     /*
-     * Copy the reconstructed fragment to the output buffer
+     * Copy the fragments that were not rebuilt in place (or supplied as
+     * the output buffer itself) to the output buffers
      *
-     * Note: the address stored in fragment_ptr will be freed below
+     * Note: the scratch addresses stored in data and parity will be freed
+     * below
      */
-    memcpy(out_fragment, fragment_ptr, fragment_len);
+    for (i = 0; destination_idxs[i] >= 0; i++) {
+        int idx = destination_idxs[i];
+
+        fragment_ptr = idx < k ? data[idx] : parity[idx - k];
+        if (fragment_ptr != out_fragments[i]) {
+            memcpy(out_fragments[i], fragment_ptr, fragment_len);
+        }
+    }
 
 out:
     /* Free the buffers allocated in prepare_fragments_for_decode */
     if (realloc_bm != 0) {
         for (i = 0; i < k; i++) {
             if (realloc_bm & (1 << i)) {
-                free(data[i]);
+                instance_free_buffer(instance, data[i]);
             }
         }
 
         for (i = 0; i < m; i++) {
             if (realloc_bm & (1 << (i + k))) {
-                free(parity[i]);
+                instance_free_buffer(instance, parity[i]);
             }
         }
     }
@@ -958,6 +2462,90 @@ out:
     return ret;
 }
 
+/**
+ * Reconstruct a missing fragment from a subset of available fragments
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragment_len - size in bytes of the fragments
+ * @param available_fragments - erasure encoded fragments
+ * @param num_fragments - number of fragments being passed in
+ * @param destination_idx - missing idx to reconstruct
+ * @param out_fragment - output of reconstruct
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_reconstruct_fragment(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int destination_idx,                            /* input */
+        char* out_fragment)                             /* output */
+{
+    int destination_idxs[2] = { destination_idx, -1 };
+    int ret;
+
+    if (destination_idx < 0) {
+        log_error("Invalid destination index %d!", destination_idx);
+        return -EINVALIDPARAMS;
+    }
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    ret = liberasurecode_reconstruct_impl(instance, NULL,
+                                          available_fragments,
+                                          num_fragments, fragment_len,
+                                          destination_idxs, &out_fragment);
+
+    liberasurecode_backend_instance_put(instance);
+
+    return ret;
+}
+
+/**
+ * Reconstruct several missing fragments from a subset of available
+ * fragments
+ *
+ * Equivalent to one liberasurecode_reconstruct_fragment() call per
+ * destination, but the available fragments are validated and prepared
+ * once and, where the backend supports it, every destination is rebuilt
+ * in the same pass over them.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - size in bytes of the fragments
+ * @param destination_idxs - -1 terminated list of missing idxs to
+ *        reconstruct
+ * @param out_fragments - fragment_len sized output buffers, one per
+ *        destination, in destination_idxs order
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_reconstruct_fragments(int desc,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int *destination_idxs,                          /* input */
+        char **out_fragments)                           /* output */
+{
+    int ret;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    ret = liberasurecode_reconstruct_impl(instance, NULL,
+                                          available_fragments,
+                                          num_fragments, fragment_len,
+                                          destination_idxs, out_fragments);
+
+    liberasurecode_backend_instance_put(instance);
+
+    return ret;
+}
+
 /**
  * Return a list of lists with valid rebuild indexes given
  * a list of missing indexes.
@@ -980,7 +2568,7 @@ int liberasurecode_fragments_needed(int desc,
 {
     int ret = 0;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         ret = -EBACKENDNOTAVAIL;
         goto out_error;
@@ -1011,9 +2599,177 @@ int liberasurecode_fragments_needed(int desc,
             fragments_to_reconstruct, fragments_to_exclude, fragments_needed);
 
 out_error:
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+/* =~=*=~==~=*=~==~=*=~==~=*=~== Decode plans ==~=*=~==~=*=~==~=*=~==~=*=~= */
+
+/**
+ * Create a decode plan for one available/wanted fragment pattern
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_idx_bitmap - bit i set if fragment i will be passed in
+ * @param wanted_idx_bitmap - missing fragments to reconstruct
+ *
+ * @return plan on success, NULL on error
+ */
+struct ec_decode_plan *liberasurecode_plan_create(int desc,
+        uint64_t available_idx_bitmap, uint64_t wanted_idx_bitmap)
+{
+    struct ec_decode_plan *plan = NULL;
+    uint64_t all_bm;
+    int k, m, i, j;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return NULL;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+    all_bm = (1ULL << (k + m)) - 1;
+
+    if ((available_idx_bitmap & ~all_bm) || (wanted_idx_bitmap & ~all_bm) ||
+            (available_idx_bitmap & wanted_idx_bitmap) ||
+            __builtin_popcountll(available_idx_bitmap) < k) {
+        log_error("Invalid decode plan fragment bitmaps!");
+        goto out;
+    }
+
+    plan = calloc(1, sizeof(*plan));
+    if (NULL == plan) {
+        goto out;
+    }
+    plan->desc = desc;
+    plan->missing_bm = all_bm & ~available_idx_bitmap;
+    plan->wanted_bm = wanted_idx_bitmap;
+    for (i = 0, j = 0; i < k + m; i++) {
+        if (plan->missing_bm & (1ULL << i)) {
+            plan->missing_idxs[j++] = i;
+        }
+    }
+    plan->missing_idxs[j] = -1;
+
+    /* Backends without plans, or that could not make one, fall back */
+    if (NULL != instance->common.ops->plan_create) {
+        plan->backend_plan = instance->common.ops->plan_create(
+                instance->desc.backend_desc, plan->missing_idxs);
+    }
+
+out:
+    liberasurecode_backend_instance_put(instance);
+    return plan;
+}
+
+/**
+ * Decode the original data with a plan, see liberasurecode_decode()
+ *
+ * The fragments passed in must be exactly the available ones of the plan.
+ * The decoded data is freed with liberasurecode_decode_cleanup().
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_with_plan(struct ec_decode_plan *plan,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        int force_metadata_checks,                      /* input */
+        char **out_data, uint64_t *out_data_len)        /* output */
+{
+    ec_backend_t instance = NULL;
+    int ret;
+
+    if (NULL == plan) {
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(plan->desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    ret = liberasurecode_decode_impl(instance, plan->desc, plan,
+                                     available_fragments,
+                                     num_fragments, fragment_len,
+                                     force_metadata_checks,
+                                     out_data, NULL, 0, out_data_len);
+
+    liberasurecode_backend_instance_put(instance);
+
+    return ret;
+}
+
+/**
+ * Reconstruct every wanted fragment of a plan
+ *
+ * The fragments passed in must be exactly the available ones of the plan.
+ *
+ * @param out_fragments - fragment_len sized output buffers, one per
+ *        wanted fragment, lowest index first
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_reconstruct_with_plan(struct ec_decode_plan *plan,
+        char **available_fragments,                     /* input */
+        int num_fragments, uint64_t fragment_len,       /* input */
+        char **out_fragments)                           /* output */
+{
+    ec_backend_t instance = NULL;
+    int destination_idxs[EC_MAX_FRAGMENTS + 1];
+    int ret = 0;
+    int i, j;
+
+    if (NULL == plan || NULL == out_fragments) {
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(plan->desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    for (i = 0, j = 0; i < EC_MAX_FRAGMENTS; i++) {
+        if (plan->wanted_bm & (1ULL << i)) {
+            destination_idxs[j++] = i;
+        }
+    }
+    destination_idxs[j] = -1;
+
+    ret = liberasurecode_reconstruct_impl(instance, plan,
+                                          available_fragments,
+                                          num_fragments, fragment_len,
+                                          destination_idxs, out_fragments);
+
+    liberasurecode_backend_instance_put(instance);
+
     return ret;
 }
 
+/**
+ * Destroy a decode plan, before destroying its instance
+ */
+void liberasurecode_plan_destroy(struct ec_decode_plan *plan)
+{
+    ec_backend_t instance = NULL;
+
+    if (NULL == plan) {
+        return;
+    }
+
+    if (NULL != plan->backend_plan) {
+        instance = liberasurecode_backend_instance_get(plan->desc);
+        if (NULL == instance) {
+            log_error("Decode plan outlived its instance!");
+        } else {
+            instance->common.ops->plan_destroy(instance->desc.backend_desc,
+                                               plan->backend_plan);
+            liberasurecode_backend_instance_put(instance);
+        }
+    }
+    free(plan);
+}
+
 /* =~=*=~==~=*=~==~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~= */
 
 /**
@@ -1028,6 +2784,32 @@ out_error:
  */
 int liberasurecode_get_fragment_metadata(char *fragment,
         fragment_metadata_t *fragment_metadata)
+{
+    return get_fragment_metadata_impl(fragment, fragment_metadata, NULL);
+}
+
+/*
+ * Whether the fragment carries an MD5 of its payload: releases before
+ * 1.7.0 accepted CHKSUM_MD5 but left the digest zeroed.
+ */
+static bool is_md5_chksum_set(fragment_header_t *header)
+{
+    uint32_t libec_version = header->libec_version;
+
+    if (LIBERASURECODE_FRAG_HEADER_MAGIC != header->magic) {
+        libec_version = bswap_32(libec_version);
+    }
+
+    return libec_version >= _VERSION(1,7,0);
+}
+
+/*
+ * As liberasurecode_get_fragment_metadata(); digest, if set, is the
+ * already computed checksum of the payload (of the fragment's checksum
+ * type) and spares reading it again.
+ */
+static int get_fragment_metadata_impl(char *fragment,
+        fragment_metadata_t *fragment_metadata, const uint32_t *digest)
 {
     int ret = 0;
     fragment_header_t *fragment_hdr = NULL;
@@ -1085,7 +2867,12 @@ int liberasurecode_get_fragment_metadata(char *fragment,
             uint32_t stored_chksum = fragment_metadata->chksum[0];
             char *fragment_data = get_data_ptr_from_fragment(fragment);
             uint64_t fragment_size = fragment_metadata->size;
-            computed_chksum = crc32(0, (unsigned char *) fragment_data, fragment_size);
+            if (NULL != digest) {
+                computed_chksum = digest[0];
+            } else {
+                computed_chksum = liberasurecode_crc32(0, fragment_data,
+                                                       fragment_size);
+            }
             if (stored_chksum != computed_chksum) {
                 // Try again with our "alternative" crc32; see
                 // https://bugs.launchpad.net/liberasurecode/+bug/1666320
@@ -1101,8 +2888,32 @@ int liberasurecode_get_fragment_metadata(char *fragment,
             }
             break;
         }
-        case CHKSUM_MD5:
+        case CHKSUM_CRC32C: {
+            char *fragment_data = get_data_ptr_from_fragment(fragment);
+            uint32_t computed_chksum = (NULL != digest) ? digest[0] :
+                    liberasurecode_crc32c(0, fragment_data,
+                                          fragment_metadata->size);
+            fragment_metadata->chksum_mismatch =
+                (fragment_metadata->chksum[0] != computed_chksum);
+            break;
+        }
+        case CHKSUM_MD5: {
+            uint32_t computed_chksum[4];
+            if (!is_md5_chksum_set(fragment_hdr)) {
+                /* no MD5 stored, like CRC32 before 1.2.0 */
+                fragment_metadata->chksum_mismatch = 0;
+                break;
+            }
+            if (NULL == digest) {
+                liberasurecode_md5(get_data_ptr_from_fragment(fragment),
+                        fragment_metadata->size, computed_chksum);
+                digest = computed_chksum;
+            }
+            fragment_metadata->chksum_mismatch =
+                (memcmp(fragment_metadata->chksum, digest,
+                        sizeof(computed_chksum)) != 0);
             break;
+        }
         case CHKSUM_NONE:
         default:
             break;
@@ -1139,7 +2950,7 @@ int is_invalid_fragment_header(fragment_header_t *header)
         /* no metadata checksum support */
         return 0;
 
-    csum = crc32(0, (unsigned char *) &header->meta, sizeof(fragment_metadata_t));
+    csum = liberasurecode_crc32(0, &header->meta, sizeof(fragment_metadata_t));
     if (metadata_chksum == csum) {
         return 0;
     }
@@ -1168,7 +2979,8 @@ int liberasurecode_verify_fragment_metadata(ec_backend_t be,
 
 int is_invalid_fragment_metadata(int desc, fragment_metadata_t *fragment_metadata)
 {
-    ec_backend_t be = liberasurecode_backend_instance_get_by_desc(desc);
+    int ret = 0;
+    ec_backend_t be = liberasurecode_backend_instance_get(desc);
     if (!be) {
         log_error("Unable to verify fragment metadata: invalid backend id %d.",
                 desc);
@@ -1176,18 +2988,24 @@ int is_invalid_fragment_metadata(int desc, fragment_metadata_t *fragment_metadat
     }
     if (liberasurecode_verify_fragment_metadata(be,
             fragment_metadata) != 0) {
-        return -EBADHEADER;
-    }
-    if (!be->common.ops->is_compatible_with(fragment_metadata->backend_version))  {
-        return -EBADHEADER;
-    }
-    if (fragment_metadata->chksum_mismatch == 1) {
-        return -EBADCHKSUM;
+        ret = -EBADHEADER;
+    } else if (!be->common.ops->is_compatible_with(
+            fragment_metadata->backend_version)) {
+        ret = -EBADHEADER;
+    } else if (fragment_metadata->chksum_mismatch == 1) {
+        ret = -EBADCHKSUM;
     }
-    return 0;
+    liberasurecode_backend_instance_put(be);
+    return ret;
 }
 
 int is_invalid_fragment(int desc, char *fragment)
+{
+    return is_invalid_fragment_impl(desc, fragment, NULL);
+}
+
+static int is_invalid_fragment_impl(int desc, char *fragment,
+        const uint32_t *digest)
 {
     uint32_t ver = 0;
     fragment_metadata_t fragment_metadata;
@@ -1197,6 +3015,7 @@ int is_invalid_fragment(int desc, char *fragment)
                 desc);
         return 1;
     }
+    /* be is not dereferenced; is_invalid_fragment_metadata() holds it */
     if (!fragment) {
         log_error("Unable to verify fragment validity: fragments missing.");
         return 1;
@@ -1205,7 +3024,8 @@ int is_invalid_fragment(int desc, char *fragment)
             ver > LIBERASURECODE_VERSION) {
         return 1;
     }
-    if (liberasurecode_get_fragment_metadata(fragment, &fragment_metadata) != 0) {
+    if (get_fragment_metadata_impl(fragment, &fragment_metadata,
+            digest) != 0) {
         return 1;
     }
     if (is_invalid_fragment_metadata(desc, &fragment_metadata) != 0) {
@@ -1214,6 +3034,87 @@ int is_invalid_fragment(int desc, char *fragment)
     return 0;
 }
 
+/*
+ * Number of fragments failing is_invalid_fragment(), flagged in bitmap
+ * (by position in fragments, for the first 64) unless it is NULL.  The
+ * payload checksums are computed up front, all fragments of a checksum
+ * type together, over the instance thread pool when it has one.
+ */
+static int find_invalid_fragments(ec_backend_t instance, int desc,
+        char **fragments, int num_fragments, uint64_t *bitmap)
+{
+    static const ec_checksum_type_t types[] = {
+        CHKSUM_CRC32, CHKSUM_CRC32C, CHKSUM_MD5,
+    };
+    const void **payloads = NULL;
+    uint32_t *sizes = NULL;
+    int *batch = NULL;
+    uint32_t (*batch_digests)[4] = NULL;
+    uint32_t (*digests)[4] = NULL;
+    char *hashed = NULL;
+    int i, j, t, n, num_invalid = 0;
+
+    payloads = malloc(num_fragments * sizeof(*payloads));
+    sizes = malloc(num_fragments * sizeof(*sizes));
+    batch = malloc(num_fragments * sizeof(*batch));
+    batch_digests = malloc(num_fragments * sizeof(*batch_digests));
+    digests = malloc(num_fragments * sizeof(*digests));
+    hashed = calloc(num_fragments, 1);
+    if (NULL == payloads || NULL == sizes || NULL == batch ||
+            NULL == batch_digests || NULL == digests || NULL == hashed) {
+        /* checksum them one by one then */
+        free(hashed);
+        hashed = NULL;
+        goto count;
+    }
+
+    for (t = 0; t < (int) (sizeof(types) / sizeof(types[0])); t++) {
+        n = 0;
+        for (i = 0; i < num_fragments; i++) {
+            fragment_header_t *header = (fragment_header_t *) fragments[i];
+
+            /* only native-endian fragments with a sound header */
+            if (NULL == fragments[i] ||
+                    header->magic != LIBERASURECODE_FRAG_HEADER_MAGIC ||
+                    header->meta.chksum_type != types[t] ||
+                    is_invalid_fragment_header(header) ||
+                    (types[t] == CHKSUM_MD5 && !is_md5_chksum_set(header))) {
+                continue;
+            }
+            payloads[n] = get_data_ptr_from_fragment(fragments[i]);
+            sizes[n] = header->meta.size;
+            batch[n++] = i;
+        }
+        if (n == 0 || instance_payload_checksums(instance, types[t],
+                payloads, sizes, n, batch_digests) < 0) {
+            continue;
+        }
+        for (j = 0; j < n; j++) {
+            memcpy(digests[batch[j]], batch_digests[j], sizeof(digests[0]));
+            hashed[batch[j]] = 1;
+        }
+    }
+
+count:
+    for (i = 0; i < num_fragments; i++) {
+        if (is_invalid_fragment_impl(desc, fragments[i],
+                (hashed && hashed[i]) ? digests[i] : NULL)) {
+            ++num_invalid;
+            if (NULL != bitmap && i < 64) {
+                *bitmap |= 1ULL << i;
+            }
+        }
+    }
+
+    free(payloads);
+    free(sizes);
+    free(batch);
+    free(batch_digests);
+    free(digests);
+    free(hashed);
+    return num_invalid;
+}
+
 int liberasurecode_verify_stripe_metadata(int desc,
         char **fragments, int num_fragments)
 {
@@ -1239,6 +3140,45 @@ int liberasurecode_verify_stripe_metadata(int desc,
     return 0;
 }
 
+/**
+ * Check the payloads of a set of fragments against their checksums,
+ * spread over the instance thread pool when it has one.  Bit i of
+ * bad_fragments is set when fragments[i] fails is_invalid_fragment().
+ */
+int liberasurecode_verify_stripe_payloads(int desc,
+        char **fragments, int num_fragments, uint64_t *bad_fragments)
+{
+    ec_backend_t instance = NULL;
+
+    if (!fragments) {
+        log_error("Unable to verify stripe payloads: fragments missing.");
+        return -EINVALIDPARAMS;
+    }
+    if (!bad_fragments) {
+        log_error("Unable to verify stripe payloads: bitmap missing.");
+        return -EINVALIDPARAMS;
+    }
+    if (num_fragments <= 0 || num_fragments > 64) {
+        log_error("Unable to verify stripe payloads: "
+                "number of fragments must be between 1 and 64.");
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        log_error("Unable to verify stripe payloads: "
+                "invalid backend id %d.", desc);
+        return -EINVALIDPARAMS;
+    }
+
+    *bad_fragments = 0;
+    find_invalid_fragments(instance, desc, fragments, num_fragments,
+                           bad_fragments);
+
+    liberasurecode_backend_instance_put(instance);
+    return 0;
+}
+
 /* =~=*=~==~=*=~==~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~= */
 
 /**
@@ -1255,7 +3195,7 @@ int liberasurecode_get_aligned_data_size(int desc, uint64_t data_len)
     int word_size;
     int alignment_multiple;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         ret = -EBACKENDNOTAVAIL;
         goto out;
@@ -1272,6 +3212,7 @@ int liberasurecode_get_aligned_data_size(int desc, uint64_t data_len)
             * alignment_multiple;
 
 out:
+    liberasurecode_backend_instance_put(instance);
     return ret;
 }
 
@@ -1286,7 +3227,7 @@ int liberasurecode_get_minimum_encode_size(int desc)
 
 int liberasurecode_get_fragment_size(int desc, int data_len)
 {
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     // TODO: Create a common function to calculate fragment size also for preprocessing
     if (NULL == instance)
         return -EBACKENDNOTAVAIL;
@@ -1297,9 +3238,57 @@ int liberasurecode_get_fragment_size(int desc, int data_len)
                                                 blocksize);
     int size = blocksize + metadata_size;
 
+    liberasurecode_backend_instance_put(instance);
     return size;
 }
 
+int liberasurecode_get_fragment_buffer_size(int desc, int data_len)
+{
+    int size = liberasurecode_get_fragment_size(desc, data_len);
+    if (size < 0)
+        return size;
+
+    return size + sizeof(fragment_header_t);
+}
+
+int liberasurecode_get_pool_stats(int desc, struct ec_pool_stats *stats)
+{
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance)
+        return -EBACKENDNOTAVAIL;
+
+    if (NULL == stats || NULL == instance->pool) {
+        liberasurecode_backend_instance_put(instance);
+        return -EINVALIDPARAMS;
+    }
+
+    ec_pool_get_stats(instance->pool, stats);
+    liberasurecode_backend_instance_put(instance);
+
+    return 0;
+}
+
+int liberasurecode_get_decode_stats(int desc, struct ec_decode_stats *stats)
+{
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance)
+        return -EBACKENDNOTAVAIL;
+
+    if (NULL == stats) {
+        liberasurecode_backend_instance_put(instance);
+        return -EINVALIDPARAMS;
+    }
+
+    stats->unaligned_in_place = __atomic_load_n(
+            &instance->unaligned_in_place, __ATOMIC_RELAXED);
+    stats->unaligned_copies = __atomic_load_n(
+            &instance->unaligned_copies, __ATOMIC_RELAXED);
+    stats->unaligned_copy_bytes = __atomic_load_n(
+            &instance->unaligned_copy_bytes, __ATOMIC_RELAXED);
+    liberasurecode_backend_instance_put(instance);
+
+    return 0;
+}
 
 /**
  * This will return the liberasurecode version for the descriptor
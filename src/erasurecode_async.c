@@ -0,0 +1,658 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode asynchronous submission implementation
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#include <fcntl.h>
+
+#include "erasurecode.h"
+#include "erasurecode_async.h"
+#include "erasurecode_backend.h"
+#include "erasurecode_log.h"
+#include "erasurecode_stdinc.h"
+
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
+enum ec_async_op {
+    EC_ASYNC_ENCODE,
+    EC_ASYNC_DECODE,
+    EC_ASYNC_RECONSTRUCT,
+};
+
+struct ec_async_job {
+    enum ec_async_op op;
+    ec_backend_t instance;          /* referenced until completion */
+    union {
+        struct {
+            const char *orig_data;
+            uint64_t orig_data_size;
+            char ***encoded_data;
+            char ***encoded_parity;
+            uint64_t *fragment_len;
+        } encode;
+        struct {
+            char **fragments;
+            int num_fragments;
+            uint64_t fragment_len;
+            int force_metadata_checks;
+            char **out_data;
+            uint64_t *out_data_len;
+        } decode;
+        struct {
+            char **fragments;
+            int num_fragments;
+            uint64_t fragment_len;
+            int destination_idx;
+            char *out_fragment;
+        } reconstruct;
+    } u;
+    struct ec_async_done done;
+    int ret;
+    struct ec_async_job *next;      /* worker queue / completion queue */
+};
+
+/* A worker's job queue, on its own cache line */
+struct ec_async_queue {
+    mutex_t lock;
+    struct ec_async_job *head;
+    struct ec_async_job *tail;
+} __attribute__ ((aligned (64)));
+
+struct ec_async_pool {
+    mutex_t lock;
+    cond_t work;                    /* signalled when jobs are queued */
+    int queued;                     /* jobs sitting in the queues */
+    int shutdown;
+
+    int num_threads;
+    pthread_t *threads;
+    struct ec_async_queue *queues;  /* one per worker */
+    unsigned int next_queue;        /* round robin submission cursor */
+};
+
+struct ec_completion_queue {
+    mutex_t lock;
+    struct ec_async_job *head;
+    struct ec_async_job *tail;
+    int fds[2];                     /* eventfd twice, or a pipe */
+};
+
+static struct ec_async_pool *async_pool = NULL;
+static mutex_t async_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ec_async_config async_config = { 0, 0, 0 };
+static int async_pending_jobs = 0;  /* submitted, not yet completed */
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Completion queues =*=~==~=*=~==~=*=~==~=*=~== */
+
+struct ec_completion_queue *ec_completion_queue_create(void)
+{
+    struct ec_completion_queue *cq = calloc(1, sizeof(*cq));
+
+    if (NULL == cq) {
+        return NULL;
+    }
+
+#ifdef HAVE_SYS_EVENTFD_H
+    cq->fds[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (cq->fds[0] < 0) {
+        free(cq);
+        return NULL;
+    }
+    cq->fds[1] = cq->fds[0];
+#else
+    if (pipe(cq->fds) != 0) {
+        free(cq);
+        return NULL;
+    }
+    fcntl(cq->fds[0], F_SETFL, fcntl(cq->fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(cq->fds[1], F_SETFL, fcntl(cq->fds[1], F_GETFL) | O_NONBLOCK);
+    fcntl(cq->fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(cq->fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+    mutex_init(&cq->lock);
+
+    return cq;
+}
+
+void ec_completion_queue_destroy(struct ec_completion_queue *cq)
+{
+    struct ec_async_job *job;
+
+    if (NULL == cq) {
+        return;
+    }
+
+    while (NULL != (job = cq->head)) {
+        cq->head = job->next;
+        free(job);
+    }
+    close(cq->fds[0]);
+    if (cq->fds[1] != cq->fds[0]) {
+        close(cq->fds[1]);
+    }
+    mutex_destroy(&cq->lock);
+    free(cq);
+}
+
+int ec_completion_queue_fd(struct ec_completion_queue *cq)
+{
+    return cq ? cq->fds[0] : -EINVALIDPARAMS;
+}
+
+/* Make the fd readable, lock held */
+static void completion_queue_notify(struct ec_completion_queue *cq)
+{
+    uint64_t one = 1;
+
+    /* A full pipe is still readable, nothing is lost */
+    if (write(cq->fds[1], &one, sizeof(one)) < 0) {
+        return;
+    }
+}
+
+/* Drain the fd once the queue is empty, lock held */
+static void completion_queue_clear(struct ec_completion_queue *cq)
+{
+    uint64_t buf[64];
+
+    while (read(cq->fds[0], buf, sizeof(buf)) > 0) {
+        ;
+    }
+}
+
+int ec_completion_queue_poll(struct ec_completion_queue *cq,
+        struct ec_async_completion *completions, int max_completions)
+{
+    struct ec_async_job *job;
+    int n = 0;
+
+    if (NULL == cq || NULL == completions || max_completions <= 0) {
+        return -EINVALIDPARAMS;
+    }
+
+    mutex_lock(&cq->lock);
+    while (n < max_completions && NULL != (job = cq->head)) {
+        cq->head = job->next;
+        completions[n].user_data = job->done.user_data;
+        completions[n].ret = job->ret;
+        free(job);
+        n++;
+    }
+    if (NULL == cq->head) {
+        cq->tail = NULL;
+        if (n > 0) {
+            completion_queue_clear(cq);
+        }
+    }
+    mutex_unlock(&cq->lock);
+
+    return n;
+}
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Worker pool =*=~==~=*=~==~=*=~==~=*=~==~=*=~= */
+
+static void async_run_job(struct ec_async_job *job)
+{
+    ec_backend_t instance = job->instance;
+    struct ec_completion_queue *cq = job->done.cq;
+
+    /*
+     * Go through the public entry points: once the instance is being
+     * destroyed they fail the job instead of running it
+     */
+    switch (job->op) {
+        case EC_ASYNC_ENCODE:
+            job->ret = liberasurecode_encode(instance->idesc,
+                    job->u.encode.orig_data, job->u.encode.orig_data_size,
+                    job->u.encode.encoded_data, job->u.encode.encoded_parity,
+                    job->u.encode.fragment_len);
+            break;
+        case EC_ASYNC_DECODE:
+            job->ret = liberasurecode_decode(instance->idesc,
+                    job->u.decode.fragments, job->u.decode.num_fragments,
+                    job->u.decode.fragment_len,
+                    job->u.decode.force_metadata_checks,
+                    job->u.decode.out_data, job->u.decode.out_data_len);
+            break;
+        case EC_ASYNC_RECONSTRUCT:
+            job->ret = liberasurecode_reconstruct_fragment(instance->idesc,
+                    job->u.reconstruct.fragments,
+                    job->u.reconstruct.num_fragments,
+                    job->u.reconstruct.fragment_len,
+                    job->u.reconstruct.destination_idx,
+                    job->u.reconstruct.out_fragment);
+            break;
+    }
+
+    /* The job counts against the limits until its completion is out */
+    if (NULL != cq) {
+        mutex_lock(&cq->lock);
+        job->next = NULL;
+        if (NULL == cq->tail) {
+            cq->head = job;
+        } else {
+            cq->tail->next = job;
+        }
+        cq->tail = job;
+        completion_queue_notify(cq);
+        mutex_unlock(&cq->lock);
+        job = NULL;             /* freed by the poller */
+    } else {
+        job->done.cb(job->done.user_data, job->ret);
+    }
+
+    __atomic_fetch_sub(&instance->async_jobs, 1, __ATOMIC_RELEASE);
+    __atomic_fetch_sub(&async_pending_jobs, 1, __ATOMIC_RELEASE);
+    liberasurecode_backend_instance_put(instance);
+    free(job);
+}
+
+static struct ec_async_job *async_queue_pop(struct ec_async_queue *queue)
+{
+    struct ec_async_job *job;
+
+    mutex_lock(&queue->lock);
+    job = queue->head;
+    if (NULL != job) {
+        queue->head = job->next;
+        if (NULL == queue->head) {
+            queue->tail = NULL;
+        }
+    }
+    mutex_unlock(&queue->lock);
+
+    return job;
+}
+
+/* Take a job from our own queue, else steal the oldest from another */
+static struct ec_async_job *async_take_job(struct ec_async_pool *pool,
+        int self)
+{
+    struct ec_async_job *job = NULL;
+    int i;
+
+    for (i = 0; i < pool->num_threads && NULL == job; i++) {
+        struct ec_async_queue *queue =
+            &pool->queues[(self + i) % pool->num_threads];
+
+        /* Peek without the lock so idle thieves leave empty queues be */
+        if (NULL == __atomic_load_n(&queue->head, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        job = async_queue_pop(queue);
+    }
+    if (NULL != job) {
+        __atomic_fetch_sub(&pool->queued, 1, __ATOMIC_RELAXED);
+    }
+
+    return job;
+}
+
+static void *async_worker(void *arg)
+{
+    struct ec_async_pool *pool = async_pool;
+    int self = (int) (intptr_t) arg;
+    struct ec_async_job *job;
+
+    for (;;) {
+        job = async_take_job(pool, self);
+        if (NULL != job) {
+            async_run_job(job);
+            continue;
+        }
+
+        mutex_lock(&pool->lock);
+        while (__atomic_load_n(&pool->queued, __ATOMIC_RELAXED) <= 0 &&
+                !pool->shutdown) {
+            cond_wait(&pool->work, &pool->lock);
+        }
+        if (__atomic_load_n(&pool->queued, __ATOMIC_RELAXED) <= 0) {
+            mutex_unlock(&pool->lock);
+            break;
+        }
+        mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+static void async_pool_free(struct ec_async_pool *pool)
+{
+    int i;
+
+    for (i = 0; i < pool->num_threads; i++) {
+        mutex_destroy(&pool->queues[i].lock);
+    }
+    cond_destroy(&pool->work);
+    mutex_destroy(&pool->lock);
+    free(pool->queues);
+    free(pool->threads);
+    free(pool);
+}
+
+/* Stop the workers once the queues are empty, async_pool_lock held */
+static void async_pool_stop(struct ec_async_pool *pool, int started)
+{
+    int i;
+
+    mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    cond_broadcast(&pool->work);
+    mutex_unlock(&pool->lock);
+
+    for (i = 0; i < started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    async_pool_free(pool);
+}
+
+/* Return the running pool, starting it if need be */
+static struct ec_async_pool *async_pool_get(void)
+{
+    struct ec_async_pool *pool;
+    int num_threads;
+    int i;
+
+    pool = __atomic_load_n(&async_pool, __ATOMIC_ACQUIRE);
+    if (NULL != pool) {
+        return pool;
+    }
+
+    mutex_lock(&async_pool_lock);
+    pool = async_pool;
+    if (NULL != pool) {
+        goto out;
+    }
+
+    num_threads = async_config.num_threads;
+    if (num_threads <= 0) {
+        num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (num_threads <= 0) {
+            num_threads = 1;
+        }
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    if (NULL == pool) {
+        goto out;
+    }
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    if (posix_memalign((void **) &pool->queues, 64,
+                       num_threads * sizeof(*pool->queues)) != 0) {
+        pool->queues = NULL;
+    }
+    if (NULL == pool->threads || NULL == pool->queues) {
+        free(pool->threads);
+        free(pool->queues);
+        free(pool);
+        pool = NULL;
+        goto out;
+    }
+    memset(pool->queues, 0, num_threads * sizeof(*pool->queues));
+    pool->num_threads = num_threads;
+    for (i = 0; i < num_threads; i++) {
+        mutex_init(&pool->queues[i].lock);
+    }
+    mutex_init(&pool->lock);
+    cond_init(&pool->work);
+
+    /* Workers pick the pool up from async_pool */
+    __atomic_store_n(&async_pool, pool, __ATOMIC_RELEASE);
+    for (i = 0; i < num_threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, async_worker,
+                           (void *) (intptr_t) i) != 0) {
+            log_error("Could not start async worker thread %d!", i);
+            async_pool_stop(pool, i);
+            __atomic_store_n(&async_pool, NULL, __ATOMIC_RELEASE);
+            pool = NULL;
+            goto out;
+        }
+    }
+
+out:
+    mutex_unlock(&async_pool_lock);
+    return pool;
+}
+
+int liberasurecode_async_configure(const struct ec_async_config *config)
+{
+    if (NULL == config || config->num_threads < 0 ||
+            config->max_jobs < 0 || config->max_jobs_per_instance < 0) {
+        return -EINVALIDPARAMS;
+    }
+
+    mutex_lock(&async_pool_lock);
+    __atomic_store_n(&async_config.num_threads, config->num_threads,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&async_config.max_jobs, config->max_jobs,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&async_config.max_jobs_per_instance,
+                     config->max_jobs_per_instance, __ATOMIC_RELAXED);
+    mutex_unlock(&async_pool_lock);
+
+    return 0;
+}
+
+void liberasurecode_async_shutdown(void)
+{
+    struct ec_async_pool *pool;
+
+    mutex_lock(&async_pool_lock);
+    pool = async_pool;
+    if (NULL != pool) {
+        async_pool_stop(pool, pool->num_threads);
+        __atomic_store_n(&async_pool, NULL, __ATOMIC_RELEASE);
+    }
+    mutex_unlock(&async_pool_lock);
+}
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Job submission =*=~==~=*=~==~=*=~==~=*=~==~=*= */
+
+/* Take a job slot under limit, undoing the increment when over it */
+static bool async_reserve(int *count, int limit)
+{
+    if (__atomic_add_fetch(count, 1, __ATOMIC_ACQUIRE) > limit &&
+            limit > 0) {
+        __atomic_fetch_sub(count, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Check the job's target, charge it against the limits and allocate it,
+ * holding a reference on the instance
+ */
+static int async_job_create(int desc, enum ec_async_op op,
+        const struct ec_async_done *done, struct ec_async_job **out)
+{
+    ec_backend_t instance = NULL;
+    struct ec_async_job *job = NULL;
+
+    if (NULL == done || (NULL == done->cb) == (NULL == done->cq)) {
+        log_error("Exactly one of a callback and a completion queue "
+                  "must be given!");
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    if (!async_reserve(&async_pending_jobs,
+                __atomic_load_n(&async_config.max_jobs, __ATOMIC_RELAXED))) {
+        liberasurecode_backend_instance_put(instance);
+        return -EAGAIN;
+    }
+    if (!async_reserve(&instance->async_jobs,
+                __atomic_load_n(&async_config.max_jobs_per_instance,
+                                __ATOMIC_RELAXED))) {
+        __atomic_fetch_sub(&async_pending_jobs, 1, __ATOMIC_RELEASE);
+        liberasurecode_backend_instance_put(instance);
+        return -EAGAIN;
+    }
+
+    job = calloc(1, sizeof(*job));
+    if (NULL == job) {
+        __atomic_fetch_sub(&instance->async_jobs, 1, __ATOMIC_RELEASE);
+        __atomic_fetch_sub(&async_pending_jobs, 1, __ATOMIC_RELEASE);
+        liberasurecode_backend_instance_put(instance);
+        return -ENOMEM;
+    }
+    job->op = op;
+    job->instance = instance;
+    job->done = *done;
+
+    *out = job;
+    return 0;
+}
+
+/* Undo async_job_create() for a job that never got queued */
+static void async_job_abort(struct ec_async_job *job)
+{
+    ec_backend_t instance = job->instance;
+
+    __atomic_fetch_sub(&instance->async_jobs, 1, __ATOMIC_RELEASE);
+    __atomic_fetch_sub(&async_pending_jobs, 1, __ATOMIC_RELEASE);
+    liberasurecode_backend_instance_put(instance);
+    free(job);
+}
+
+static int async_job_submit(struct ec_async_job *job)
+{
+    struct ec_async_pool *pool = async_pool_get();
+    struct ec_async_queue *queue;
+
+    if (NULL == pool) {
+        async_job_abort(job);
+        return -ENOMEM;
+    }
+
+    queue = &pool->queues[__atomic_fetch_add(&pool->next_queue, 1,
+                                             __ATOMIC_RELAXED) %
+                          pool->num_threads];
+    job->next = NULL;
+    mutex_lock(&queue->lock);
+    if (NULL == queue->tail) {
+        queue->head = job;
+    } else {
+        queue->tail->next = job;
+    }
+    queue->tail = job;
+    mutex_unlock(&queue->lock);
+
+    mutex_lock(&pool->lock);
+    __atomic_fetch_add(&pool->queued, 1, __ATOMIC_RELAXED);
+    cond_signal(&pool->work);
+    mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+int liberasurecode_submit_encode(int desc,
+        const char *orig_data, uint64_t orig_data_size,
+        char ***encoded_data, char ***encoded_parity,
+        uint64_t *fragment_len, const struct ec_async_done *done)
+{
+    struct ec_async_job *job = NULL;
+    int ret;
+
+    if (NULL == orig_data || NULL == encoded_data ||
+            NULL == encoded_parity || NULL == fragment_len) {
+        log_error("Invalid arguments passed to submit_encode!");
+        return -EINVALIDPARAMS;
+    }
+
+    ret = async_job_create(desc, EC_ASYNC_ENCODE, done, &job);
+    if (ret < 0) {
+        return ret;
+    }
+    job->u.encode.orig_data = orig_data;
+    job->u.encode.orig_data_size = orig_data_size;
+    job->u.encode.encoded_data = encoded_data;
+    job->u.encode.encoded_parity = encoded_parity;
+    job->u.encode.fragment_len = fragment_len;
+
+    return async_job_submit(job);
+}
+
+int liberasurecode_submit_decode(int desc,
+        char **available_fragments, int num_fragments,
+        uint64_t fragment_len, int force_metadata_checks,
+        char **out_data, uint64_t *out_data_len,
+        const struct ec_async_done *done)
+{
+    struct ec_async_job *job = NULL;
+    int ret;
+
+    if (NULL == available_fragments || NULL == out_data ||
+            NULL == out_data_len) {
+        log_error("Invalid arguments passed to submit_decode!");
+        return -EINVALIDPARAMS;
+    }
+
+    ret = async_job_create(desc, EC_ASYNC_DECODE, done, &job);
+    if (ret < 0) {
+        return ret;
+    }
+    job->u.decode.fragments = available_fragments;
+    job->u.decode.num_fragments = num_fragments;
+    job->u.decode.fragment_len = fragment_len;
+    job->u.decode.force_metadata_checks = force_metadata_checks;
+    job->u.decode.out_data = out_data;
+    job->u.decode.out_data_len = out_data_len;
+
+    return async_job_submit(job);
+}
+
+int liberasurecode_submit_reconstruct(int desc,
+        char **available_fragments, int num_fragments,
+        uint64_t fragment_len, int destination_idx, char *out_fragment,
+        const struct ec_async_done *done)
+{
+    struct ec_async_job *job = NULL;
+    int ret;
+
+    if (NULL == available_fragments || NULL == out_fragment) {
+        log_error("Invalid arguments passed to submit_reconstruct!");
+        return -EINVALIDPARAMS;
+    }
+
+    ret = async_job_create(desc, EC_ASYNC_RECONSTRUCT, done, &job);
+    if (ret < 0) {
+        return ret;
+    }
+    job->u.reconstruct.fragments = available_fragments;
+    job->u.reconstruct.num_fragments = num_fragments;
+    job->u.reconstruct.fragment_len = fragment_len;
+    job->u.reconstruct.destination_idx = destination_idx;
+    job->u.reconstruct.out_fragment = out_fragment;
+
+    return async_job_submit(job);
+}
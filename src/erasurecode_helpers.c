@@ -28,11 +28,13 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdarg.h>
-#include <zlib.h>
 #include "erasurecode_backend.h"
+#include "erasurecode_crc.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
+#include "erasurecode_pool.h"
 #include "erasurecode_stdinc.h"
+#include "erasurecode_threadpool.h"
 #include "erasurecode_version.h"
 
 #include "alg_sig.h"
@@ -60,17 +62,43 @@ static bool is_fragment(char *buf)
  */
 void *get_aligned_buffer16(int size)
 {
-    void *buf;
-
     /**
      * Ensure all memory is aligned to 16-byte boundaries
      * to support 128-bit operations
      */
-    if (posix_memalign(&buf, 16, size) != 0) {
-        return NULL;
+    return get_aligned_buffer(size, 16);
+}
+
+/**
+ * Allocate a zero-ed buffer aligned to 'alignment' bytes (a power of two,
+ * multiple of sizeof(void *)).
+ *
+ * @param size integer size in bytes of buffer to allocate
+ * @param alignment required alignment of the buffer
+ * @return pointer to start of allocated buffer or NULL on error
+ */
+void *get_aligned_buffer(int size, int alignment)
+{
+    void *buf = get_aligned_buffer_uninit(size, alignment);
+
+    if (buf) {
+        memset(buf, 0, size);
     }
 
-    memset(buf, 0, size);
+    return buf;
+}
+
+/**
+ * Same as get_aligned_buffer(), but the contents are left uninitialized.
+ * For buffers the caller is about to overwrite in full.
+ */
+void *get_aligned_buffer_uninit(int size, int alignment)
+{
+    void *buf;
+
+    if (posix_memalign(&buf, alignment, size) != 0) {
+        return NULL;
+    }
 
     return buf;
 }
@@ -156,6 +184,863 @@ int free_fragment_buffer(char *buf)
     return 0;
 }
 
+/**
+ * Instance-aware allocation: the buffer comes from the instance's buffer
+ * pool when it has one, otherwise from get_aligned_buffer().  Either way
+ * it is zeroed, cache-line (64-byte) aligned and must be released with
+ * instance_free_buffer().
+ *
+ * @param instance - ec_backend_t instance the buffer is used with
+ * @param size - integer size in bytes of buffer to allocate
+ * @return pointer to start of allocated buffer or NULL on error
+ */
+void *instance_alloc_buffer(ec_backend_t instance, int size)
+{
+    if (NULL != instance->pool) {
+        return ec_pool_alloc(instance->pool, size, 1);
+    }
+    return get_aligned_buffer(size, 64);
+}
+
+/**
+ * Same as instance_alloc_buffer(), but the contents are left uninitialized.
+ */
+void *instance_alloc_buffer_uninit(ec_backend_t instance, int size)
+{
+    if (NULL != instance->pool) {
+        return ec_pool_alloc(instance->pool, size, 0);
+    }
+    return get_aligned_buffer_uninit(size, 64);
+}
+
+/**
+ * Alignment of the fragment payloads allocated for the instance
+ * (ec_args.payload_align)
+ */
+int instance_payload_align(ec_backend_t instance)
+{
+    int align = instance->args.uargs.payload_align;
+
+    return align > 16 ? align : 16;
+}
+
+/*
+ * Instance buffers are 64-byte aligned, which puts the payload of a
+ * fragment at their start 16-byte aligned, right after the 80 byte
+ * header.  For a wider payload alignment the fragment is placed further
+ * into a larger buffer, with the start of that buffer stored just before
+ * the fragment.  Such a fragment is never 64-byte aligned itself, which is
+ * how instance_free_buffer() tells it apart.
+ */
+static int fragment_slack(ec_backend_t instance)
+{
+    int align = instance_payload_align(instance);
+
+    return align > 16 ? align + (int) sizeof(void *) : 0;
+}
+
+static char *place_fragment(ec_backend_t instance, char *base)
+{
+    uintptr_t align = instance_payload_align(instance);
+    uintptr_t payload;
+    char *buf;
+
+    if (align <= 16) {
+        return base;
+    }
+
+    payload = ((uintptr_t) base + sizeof(void *) +
+               sizeof(fragment_header_t) + align - 1) & ~(align - 1);
+    buf = (char *) payload - sizeof(fragment_header_t);
+    memcpy(buf - sizeof(void *), &base, sizeof(void *));
+
+    return buf;
+}
+
+/**
+ * Same as alloc_fragment_buffer(), but drawing from the instance's buffer
+ * pool (see instance_alloc_buffer()), with the payload aligned as
+ * instance_payload_align() says.
+ */
+char *instance_alloc_fragment_buffer(ec_backend_t instance, int size)
+{
+    char *buf;
+
+    buf = instance_alloc_buffer(instance, size + sizeof(fragment_header_t) +
+                                          fragment_slack(instance));
+    if (buf) {
+        buf = place_fragment(instance, buf);
+        init_fragment_header(buf);
+    }
+
+    return buf;
+}
+
+/**
+ * Same as instance_alloc_fragment_buffer(), but only the header is
+ * cleared; the payload is left uninitialized.
+ */
+char *instance_alloc_fragment_buffer_uninit(ec_backend_t instance, int size)
+{
+    char *buf;
+
+    buf = instance_alloc_buffer_uninit(instance,
+                                       size + sizeof(fragment_header_t) +
+                                       fragment_slack(instance));
+    if (buf) {
+        buf = place_fragment(instance, buf);
+        memset(buf, 0, sizeof(fragment_header_t));
+        init_fragment_header(buf);
+    }
+
+    return buf;
+}
+
+/**
+ * Release a buffer (or fragment) from instance_alloc_buffer() or
+ * instance_alloc_fragment_buffer().
+ */
+void instance_free_buffer(ec_backend_t instance, void *buf)
+{
+    if (NULL == buf) {
+        return;
+    }
+    if (((uintptr_t) buf & 63) != 0) {
+        /* a fragment moved in by place_fragment() */
+        memcpy(&buf, (char *) buf - sizeof(void *), sizeof(void *));
+    }
+    if (NULL != instance->pool) {
+        ec_pool_free(instance->pool, buf);
+    } else {
+        free(buf);
+    }
+}
+
+/* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
+
+/**
+ * Whether the backend's codes work on each byte column independently, so
+ * that encode/decode/reconstruct may be run on any 16-byte aligned slice
+ * of the payloads.  Jerasure Cauchy works on packets and shss/libphazr
+ * mix the whole payload.
+ */
+bool is_backend_column_independent(ec_backend_t instance)
+{
+    switch (instance->common.id) {
+        case EC_BACKEND_FLAT_XOR_HD:
+        case EC_BACKEND_JERASURE_RS_VAND:
+        case EC_BACKEND_ISA_L_RS_VAND:
+        case EC_BACKEND_ISA_L_RS_CAUCHY:
+        case EC_BACKEND_LIBERASURECODE_RS_VAND:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Whether the backend works on payloads at any address, so that decode
+ * and reconstruct may hand it unaligned fragments in place
+ */
+bool is_backend_unaligned_capable(ec_backend_t instance)
+{
+    if (NULL != instance->common.ops->is_unaligned_safe) {
+        return instance->common.ops->is_unaligned_safe(
+                instance->desc.backend_desc);
+    }
+
+    switch (instance->common.id) {
+        case EC_BACKEND_NULL:
+        case EC_BACKEND_ISA_L_RS_VAND:
+        case EC_BACKEND_ISA_L_RS_CAUCHY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Whether the backend's encode() writes every byte of the parity payloads.
+ * Backends that accumulate into the parity buffers, or that we cannot
+ * vouch for, are handed zeroed buffers.
+ */
+bool is_backend_parity_overwriting(ec_backend_t instance)
+{
+    switch (instance->common.id) {
+        case EC_BACKEND_JERASURE_RS_VAND:
+        case EC_BACKEND_JERASURE_RS_CAUCHY:
+        case EC_BACKEND_ISA_L_RS_VAND:
+        case EC_BACKEND_ISA_L_RS_CAUCHY:
+        case EC_BACKEND_LIBERASURECODE_RS_VAND:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Whether the backend's decode() rebuilds missing parity as well as missing
+ * data, so a single decode can stand in for reconstructing every missing
+ * fragment.
+ */
+static bool is_backend_decode_rebuilding_parity(ec_backend_t instance)
+{
+    switch (instance->common.id) {
+        case EC_BACKEND_JERASURE_RS_VAND:
+        case EC_BACKEND_JERASURE_RS_CAUCHY:
+        case EC_BACKEND_FLAT_XOR_HD:
+        case EC_BACKEND_ISA_L_RS_VAND:
+        case EC_BACKEND_ISA_L_RS_CAUCHY:
+        case EC_BACKEND_LIBERASURECODE_RS_VAND:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Smallest column range worth handing to another thread */
+#define EC_COLUMNS_MIN_CHUNK    (64 * 1024)
+/* Column ranges start on a cache line */
+#define EC_COLUMNS_ALIGN        64
+/* Working set of one tiled encode step over all k + m fragments */
+#define EC_ENCODE_TILE_BYTES    (256 * 1024)
+#define EC_ENCODE_TILE_MIN      4096
+
+typedef uint32_t (*ec_chksum_func)(uint32_t crc, const void *buf,
+                                   size_t size);
+typedef uint32_t (*ec_chksum_combine_func)(uint32_t crc1, uint32_t crc2,
+                                           size_t size2);
+
+enum ec_column_op {
+    EC_COLUMN_ENCODE,
+    EC_COLUMN_DECODE,
+    EC_COLUMN_RECONSTRUCT,
+    EC_COLUMN_RECONSTRUCT_MANY,
+    EC_COLUMN_ENCODE_TILED,
+};
+
+struct ec_column_job {
+    ec_backend_t instance;
+    enum ec_column_op op;
+    char **data;
+    char **parity;
+    int *missing_idxs;
+    void *plan;                 /* backend decode plan, or NULL */
+    int destination_idx;
+    int *destination_idxs;      /* RECONSTRUCT_MANY, -1 terminated */
+    const struct iovec *iov;    /* ENCODE_TILED source */
+    int iovcnt;
+    uint64_t orig_data_size;
+    ec_chksum_func chksum;      /* ENCODE_TILED running checksum, or NULL */
+    uint32_t *chksums;          /* k + m per task */
+    int blocksize;
+    int chunk;                  /* columns per task */
+    int ret;                    /* first error seen */
+};
+
+/* Copy len bytes at offset into the data described by an iovec list */
+static void iov_copy_at(char *dst, const struct iovec *iov, int iovcnt,
+        uint64_t offset, size_t len)
+{
+    while (iovcnt > 0 && offset >= iov->iov_len) {
+        offset -= iov->iov_len;
+        iov++;
+        iovcnt--;
+    }
+
+    while (len > 0 && iovcnt > 0) {
+        size_t n = iov->iov_len - offset;
+
+        if (n > len) {
+            n = len;
+        }
+        memcpy(dst, (char *) iov->iov_base + offset, n);
+        dst += n;
+        len -= n;
+        offset = 0;
+        iov++;
+        iovcnt--;
+    }
+}
+
+/*
+ * Encode columns [start, start + len) a tile at a time: copy the tile's
+ * data in, encode it and run the checksums over it while all k + m tiles
+ * are still in cache, instead of streaming the whole stripe through
+ * memory once per step.
+ */
+static int ec_column_encode_tiled(struct ec_column_job *job, int task,
+                                  int start, int len)
+{
+    ec_backend_t instance = job->instance;
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    uint32_t *chksums = NULL;
+    bool zero_parity = !is_backend_parity_overwriting(instance);
+    int tile, off, n, i, ret;
+
+    tile = (EC_ENCODE_TILE_BYTES / (k + m)) & ~(EC_COLUMNS_ALIGN - 1);
+    if (tile < EC_ENCODE_TILE_MIN) {
+        tile = EC_ENCODE_TILE_MIN;
+    }
+    if (NULL != job->chksum) {
+        chksums = job->chksums + task * (k + m);
+    }
+
+    for (off = start; off < start + len; off += tile) {
+        n = start + len - off < tile ? start + len - off : tile;
+
+        for (i = 0; i < k; i++) {
+            uint64_t src = (uint64_t) i * job->blocksize + off;
+            uint64_t avail = 0;
+
+            if (src < job->orig_data_size) {
+                avail = job->orig_data_size - src;
+                avail = avail > (uint64_t) n ? (uint64_t) n : avail;
+            }
+            data[i] = job->data[i] + off;
+            iov_copy_at(data[i], job->iov, job->iovcnt, src, avail);
+            if (avail < (uint64_t) n) {
+                memset(data[i] + avail, 0, n - avail);
+            }
+        }
+        for (i = 0; i < m; i++) {
+            parity[i] = job->parity[i] + off;
+            if (zero_parity) {
+                memset(parity[i], 0, n);
+            }
+        }
+
+        ret = instance->common.ops->encode(instance->desc.backend_desc,
+                                           data, parity, n);
+        if (ret < 0) {
+            return ret;
+        }
+
+        if (NULL != chksums) {
+            for (i = 0; i < k; i++) {
+                chksums[i] = job->chksum(chksums[i], job->data[i] + off, n);
+            }
+            for (i = 0; i < m; i++) {
+                chksums[k + i] = job->chksum(chksums[k + i],
+                                             job->parity[i] + off, n);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void ec_column_task(void *arg, int task)
+{
+    struct ec_column_job *job = arg;
+    ec_backend_t instance = job->instance;
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    int start = task * job->chunk;
+    int len = job->blocksize - start;
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    int missing_idxs[EC_MAX_FRAGMENTS + 1];
+    int destination_idxs[EC_MAX_FRAGMENTS + 1];
+    int i, ret = 0;
+
+    if (len > job->chunk) {
+        len = job->chunk;
+    }
+    if (len <= 0) {
+        return;
+    }
+
+    if (job->op == EC_COLUMN_ENCODE_TILED) {
+        ret = ec_column_encode_tiled(job, task, start, len);
+        goto out;
+    }
+
+    /* Backends may scribble on the arrays, each task gets its own */
+    for (i = 0; i < k; i++) {
+        data[i] = job->data[i] ? job->data[i] + start : NULL;
+    }
+    for (i = 0; i < m; i++) {
+        parity[i] = job->parity[i] ? job->parity[i] + start : NULL;
+    }
+    if (job->missing_idxs) {
+        for (i = 0; i < k + m && job->missing_idxs[i] >= 0; i++) {
+            missing_idxs[i] = job->missing_idxs[i];
+        }
+        missing_idxs[i] = -1;
+    }
+
+    switch (job->op) {
+        case EC_COLUMN_ENCODE:
+            ret = instance->common.ops->encode(instance->desc.backend_desc,
+                                               data, parity, len);
+            break;
+        case EC_COLUMN_DECODE:
+            if (NULL != job->plan) {
+                ret = instance->common.ops->plan_decode(
+                        instance->desc.backend_desc, job->plan,
+                        data, parity, len);
+                break;
+            }
+            ret = instance->common.ops->decode(instance->desc.backend_desc,
+                                               data, parity, missing_idxs,
+                                               len);
+            break;
+        case EC_COLUMN_RECONSTRUCT:
+            if (NULL != job->plan) {
+                ret = instance->common.ops->plan_reconstruct(
+                        instance->desc.backend_desc, job->plan,
+                        data, parity, job->destination_idx, len);
+                break;
+            }
+            ret = instance->common.ops->reconstruct(
+                    instance->desc.backend_desc, data, parity, missing_idxs,
+                    job->destination_idx, len);
+            break;
+        case EC_COLUMN_RECONSTRUCT_MANY:
+            for (i = 0; job->destination_idxs[i] >= 0; i++) {
+                destination_idxs[i] = job->destination_idxs[i];
+            }
+            destination_idxs[i] = -1;
+            ret = instance->common.ops->reconstruct_many(
+                    instance->desc.backend_desc, data, parity, missing_idxs,
+                    destination_idxs, len);
+            break;
+        case EC_COLUMN_ENCODE_TILED:
+            break;
+    }
+
+out:
+    if (ret < 0) {
+        int expected = 0;
+        __atomic_compare_exchange_n(&job->ret, &expected, ret, 0,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Run a backend op, split into column ranges over the instance thread
+ * pool when it has one and the payloads are large enough.
+ */
+static int instance_run_columns(struct ec_column_job *job)
+{
+    ec_backend_t instance = job->instance;
+    int ntasks = 1;
+
+    if (NULL != instance->threads && is_backend_column_independent(instance)) {
+        ntasks = job->blocksize / EC_COLUMNS_MIN_CHUNK;
+        if (ntasks > ec_thread_pool_size(instance->threads) + 1) {
+            ntasks = ec_thread_pool_size(instance->threads) + 1;
+        }
+    }
+
+    if (ntasks < 2) {
+        job->chunk = job->blocksize;
+        ec_column_task(job, 0);
+        return job->ret;
+    }
+
+    job->chunk = (job->blocksize + ntasks - 1) / ntasks;
+    job->chunk = (job->chunk + EC_COLUMNS_ALIGN - 1) &
+                 ~(EC_COLUMNS_ALIGN - 1);
+    ntasks = (job->blocksize + job->chunk - 1) / job->chunk;
+    ec_thread_pool_run(instance->threads, ntasks, ec_column_task, job);
+
+    return job->ret;
+}
+
+/**
+ * Call the backend encode, in parallel over column ranges when the
+ * instance has a thread pool
+ */
+int instance_backend_encode(ec_backend_t instance,
+        char **data, char **parity, int blocksize)
+{
+    struct ec_column_job job = {
+        .instance = instance,
+        .op = EC_COLUMN_ENCODE,
+        .data = data,
+        .parity = parity,
+        .blocksize = blocksize,
+    };
+
+    return instance_run_columns(&job);
+}
+
+/**
+ * Fused encode: lay the data in from iov, encode and checksum it one
+ * cache-sized tile at a time, in parallel over column ranges when the
+ * instance has a thread pool.  Column independent backends only.
+ *
+ * @param instance - backend instance
+ * @param iov, iovcnt - the data to encode
+ * @param orig_data_size - total length of the data in iov
+ * @param data, parity - payloads laid out by
+ *        prepare_fragments_for_encode_tiled()
+ * @param blocksize - payload size
+ * @param chksums - _output_ CRC32 or CRC32C (per the instance checksum
+ *        type) of each of the k + m payloads, or NULL for none
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int instance_backend_encode_tiled(ec_backend_t instance,
+        const struct iovec *iov, int iovcnt, uint64_t orig_data_size,
+        char **data, char **parity, int blocksize, uint32_t *chksums)
+{
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    ec_chksum_combine_func combine = NULL;
+    struct ec_column_job job = {
+        .instance = instance,
+        .op = EC_COLUMN_ENCODE_TILED,
+        .data = data,
+        .parity = parity,
+        .iov = iov,
+        .iovcnt = iovcnt,
+        .orig_data_size = orig_data_size,
+        .blocksize = blocksize,
+    };
+    int max_tasks = 1, ntasks, i, t, ret;
+
+    if (NULL != chksums) {
+        switch (instance->args.uargs.ct) {
+            case CHKSUM_CRC32:
+                job.chksum = liberasurecode_crc32;
+                combine = liberasurecode_crc32_combine;
+                break;
+            case CHKSUM_CRC32C:
+                job.chksum = liberasurecode_crc32c;
+                combine = liberasurecode_crc32c_combine;
+                break;
+            default:
+                return -EINVALIDPARAMS;
+        }
+        if (NULL != instance->threads) {
+            max_tasks = ec_thread_pool_size(instance->threads) + 1;
+        }
+        job.chksums = calloc(max_tasks * (k + m), sizeof(uint32_t));
+        if (NULL == job.chksums) {
+            return -ENOMEM;
+        }
+    }
+
+    ret = instance_run_columns(&job);
+    if (ret < 0 || NULL == chksums) {
+        goto out;
+    }
+
+    /* stitch the per column range checksums together */
+    ntasks = job.chunk > 0 ? (blocksize + job.chunk - 1) / job.chunk : 1;
+    for (i = 0; i < k + m; i++) {
+        chksums[i] = job.chksums[i];
+        for (t = 1; t < ntasks; t++) {
+            int len = blocksize - t * job.chunk;
+
+            len = len > job.chunk ? job.chunk : len;
+            chksums[i] = combine(chksums[i], job.chksums[t * (k + m) + i],
+                                 len);
+        }
+    }
+
+out:
+    free(job.chksums);
+    return ret;
+}
+
+/**
+ * Call the backend decode, in parallel over column ranges when the
+ * instance has a thread pool
+ */
+int instance_backend_decode(ec_backend_t instance,
+        char **data, char **parity, int *missing_idxs, int blocksize)
+{
+    return instance_backend_decode_plan(instance, NULL, data, parity,
+                                        missing_idxs, blocksize);
+}
+
+/**
+ * Same as instance_backend_decode(), using a backend decode plan built
+ * for missing_idxs when plan is not NULL
+ */
+int instance_backend_decode_plan(ec_backend_t instance, void *plan,
+        char **data, char **parity, int *missing_idxs, int blocksize)
+{
+    struct ec_column_job job = {
+        .instance = instance,
+        .op = EC_COLUMN_DECODE,
+        .data = data,
+        .parity = parity,
+        .missing_idxs = missing_idxs,
+        .plan = plan,
+        .blocksize = blocksize,
+    };
+
+    return instance_run_columns(&job);
+}
+
+/**
+ * Call the backend reconstruct, in parallel over column ranges when the
+ * instance has a thread pool
+ */
+int instance_backend_reconstruct(ec_backend_t instance,
+        char **data, char **parity, int *missing_idxs, int destination_idx,
+        int blocksize)
+{
+    return instance_backend_reconstruct_plan(instance, NULL, data, parity,
+                                             missing_idxs, destination_idx,
+                                             blocksize);
+}
+
+/**
+ * Same as instance_backend_reconstruct(), using a backend decode plan
+ * built for missing_idxs when plan is not NULL
+ */
+int instance_backend_reconstruct_plan(ec_backend_t instance, void *plan,
+        char **data, char **parity, int *missing_idxs, int destination_idx,
+        int blocksize)
+{
+    struct ec_column_job job = {
+        .instance = instance,
+        .op = EC_COLUMN_RECONSTRUCT,
+        .data = data,
+        .parity = parity,
+        .missing_idxs = missing_idxs,
+        .plan = plan,
+        .destination_idx = destination_idx,
+        .blocksize = blocksize,
+    };
+
+    return instance_run_columns(&job);
+}
+
+/**
+ * Rebuild every fragment of the -1 terminated destination_idxs list,
+ * each of which must be in missing_idxs.
+ *
+ * A plan covering all the missing fragments decodes them all at once;
+ * otherwise backends implementing reconstruct_many rebuild the
+ * destinations together, and the others are called once per destination.
+ */
+int instance_backend_reconstruct_many(ec_backend_t instance, void *plan,
+        char **data, char **parity, int *missing_idxs, int *destination_idxs,
+        int blocksize)
+{
+    struct ec_column_job job = {
+        .instance = instance,
+        .op = EC_COLUMN_RECONSTRUCT_MANY,
+        .data = data,
+        .parity = parity,
+        .missing_idxs = missing_idxs,
+        .destination_idxs = destination_idxs,
+        .blocksize = blocksize,
+    };
+    int ret = 0;
+    int i;
+
+    if (destination_idxs[0] >= 0 && destination_idxs[1] < 0) {
+        return instance_backend_reconstruct_plan(instance, plan, data,
+                                                 parity, missing_idxs,
+                                                 destination_idxs[0],
+                                                 blocksize);
+    }
+
+    if (NULL != plan) {
+        if (convert_list_to_bitmap(destination_idxs) ==
+                convert_list_to_bitmap(missing_idxs)) {
+            return instance_backend_decode_plan(instance, plan, data,
+                                                parity, missing_idxs,
+                                                blocksize);
+        }
+    } else if (NULL != instance->common.ops->reconstruct_many) {
+        return instance_run_columns(&job);
+    } else if (is_backend_decode_rebuilding_parity(instance) &&
+               convert_list_to_bitmap(destination_idxs) ==
+               convert_list_to_bitmap(missing_idxs)) {
+        /* one decode pass instead of one reconstruct per destination */
+        return instance_backend_decode(instance, data, parity, missing_idxs,
+                                       blocksize);
+    }
+
+    for (i = 0; destination_idxs[i] >= 0 && ret == 0; i++) {
+        ret = instance_backend_reconstruct_plan(instance, plan, data, parity,
+                                                missing_idxs,
+                                                destination_idxs[i],
+                                                blocksize);
+    }
+
+    return ret;
+}
+
+struct ec_chksum_job {
+    ec_checksum_type_t ct;
+    ec_chksum_func chksum;      /* CRC32 / CRC32C */
+    const void **payloads;
+    const uint32_t *sizes;
+    int pieces;                 /* CRC pieces per payload */
+    int units;                  /* payloads, or payload pieces for CRCs */
+    int per_task;               /* units per task */
+    uint32_t *parts;            /* CRC of each piece */
+    uint32_t (*digests)[4];
+};
+
+/* Bytes of each of the pieces a payload of size bytes is split into */
+static uint32_t chksum_piece_len(uint32_t size, int pieces)
+{
+    uint32_t len = (size + pieces - 1) / pieces;
+
+    return (len + EC_COLUMNS_ALIGN - 1) & ~(EC_COLUMNS_ALIGN - 1);
+}
+
+static void ec_chksum_task(void *arg, int task)
+{
+    struct ec_chksum_job *job = arg;
+    int first = task * job->per_task;
+    int last = first + job->per_task;
+    int u, n;
+
+    if (last > job->units) {
+        last = job->units;
+    }
+
+    if (job->ct == CHKSUM_MD5) {
+        /* runs of equal sized payloads share the multi-buffer engine */
+        while (first < last) {
+            for (n = 1; first + n < last &&
+                    job->sizes[first + n] == job->sizes[first]; n++);
+            liberasurecode_md5_mb(job->payloads + first, n,
+                                  job->sizes[first], job->digests + first);
+            first += n;
+        }
+        return;
+    }
+
+    for (u = first; u < last; u++) {
+        int i = u / job->pieces;
+        uint32_t len = chksum_piece_len(job->sizes[i], job->pieces);
+        uint64_t start = (uint64_t) (u % job->pieces) * len;
+
+        if (start >= job->sizes[i]) {
+            job->parts[u] = 0;
+            continue;
+        }
+        if (start + len > job->sizes[i]) {
+            len = job->sizes[i] - start;
+        }
+        job->parts[u] = job->chksum(0, (const char *) job->payloads[i] + start,
+                                    len);
+    }
+}
+
+/**
+ * Checksum a set of payloads, spread over the instance thread pool when
+ * it has one and there is enough data.  Payloads are shared out between
+ * the tasks; when there are more tasks than payloads, CRCs are also taken
+ * over column ranges and combined.
+ *
+ * @param instance - backend instance, or NULL to run on the calling thread
+ * @param ct - CHKSUM_CRC32, CHKSUM_CRC32C or CHKSUM_MD5
+ * @param payloads - the payloads to checksum
+ * @param sizes - size of each payload
+ * @param num_payloads - number of payloads
+ * @param digests - _output_ MD5 digest, or CRC in digests[i][0], of each
+ *        payload
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int instance_payload_checksums(ec_backend_t instance, ec_checksum_type_t ct,
+        const void **payloads, const uint32_t *sizes, int num_payloads,
+        uint32_t (*digests)[4])
+{
+    ec_chksum_combine_func combine = NULL;
+    struct ec_chksum_job job = {
+        .ct = ct,
+        .payloads = payloads,
+        .sizes = sizes,
+        .pieces = 1,
+        .units = num_payloads,
+        .digests = digests,
+    };
+    uint64_t total = 0;
+    int ntasks = 1, i, p;
+
+    switch (ct) {
+        case CHKSUM_CRC32:
+            job.chksum = liberasurecode_crc32;
+            combine = liberasurecode_crc32_combine;
+            break;
+        case CHKSUM_CRC32C:
+            job.chksum = liberasurecode_crc32c;
+            combine = liberasurecode_crc32c_combine;
+            break;
+        case CHKSUM_MD5:
+            break;
+        default:
+            return -EINVALIDPARAMS;
+    }
+    if (num_payloads <= 0) {
+        return 0;
+    }
+
+    if (NULL != instance && NULL != instance->threads) {
+        for (i = 0; i < num_payloads; i++) {
+            total += sizes[i];
+        }
+        ntasks = ec_thread_pool_size(instance->threads) + 1;
+        if ((uint64_t) ntasks > total / EC_COLUMNS_MIN_CHUNK) {
+            ntasks = total / EC_COLUMNS_MIN_CHUNK;
+        }
+        if (ntasks < 1) {
+            ntasks = 1;
+        }
+    }
+
+    if (NULL != combine) {
+        if (ntasks > num_payloads) {
+            job.pieces = (ntasks + num_payloads - 1) / num_payloads;
+            job.units = num_payloads * job.pieces;
+        }
+        job.parts = malloc(job.units * sizeof(uint32_t));
+        if (NULL == job.parts) {
+            return -ENOMEM;
+        }
+    }
+
+    if (ntasks > job.units) {
+        ntasks = job.units;
+    }
+    job.per_task = (job.units + ntasks - 1) / ntasks;
+    ntasks = (job.units + job.per_task - 1) / job.per_task;
+    if (ntasks < 2) {
+        ec_chksum_task(&job, 0);
+    } else {
+        ec_thread_pool_run(instance->threads, ntasks, ec_chksum_task, &job);
+    }
+
+    if (NULL != combine) {
+        for (i = 0; i < num_payloads; i++) {
+            uint32_t len = chksum_piece_len(sizes[i], job.pieces);
+            uint32_t crc = job.parts[i * job.pieces];
+
+            for (p = 1; p < job.pieces; p++) {
+                uint64_t start = (uint64_t) p * len;
+
+                if (start >= sizes[i]) {
+                    break;
+                }
+                crc = combine(crc, job.parts[i * job.pieces + p],
+                              start + len > sizes[i] ? sizes[i] - start : len);
+            }
+            digests[i][0] = crc;
+        }
+        free(job.parts);
+    }
+
+    return 0;
+}
+
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
 /**
@@ -475,10 +1360,18 @@ inline int set_checksum(ec_checksum_type_t ct, char *buf, int blocksize)
 
     switch(header->meta.chksum_type) {
         case CHKSUM_CRC32:
-            header->meta.chksum[0] = crc32(0, (unsigned char *) data, blocksize);
+            header->meta.chksum[0] = liberasurecode_crc32(0, data, blocksize);
             break;
-        case CHKSUM_MD5:
+        case CHKSUM_CRC32C:
+            header->meta.chksum[0] = liberasurecode_crc32c(0, data, blocksize);
+            break;
+        case CHKSUM_MD5: {
+            uint32_t digest[4];
+
+            liberasurecode_md5(data, blocksize, digest);
+            memcpy(header->meta.chksum, digest, sizeof(digest));
             break;
+        }
         case CHKSUM_NONE:
         default:
             break;
@@ -487,6 +1380,70 @@ inline int set_checksum(ec_checksum_type_t ct, char *buf, int blocksize)
     return 0;
 }
 
+/**
+ * Checksum all fragments of a stripe.  They share a payload size, which
+ * lets MD5 hash them side by side instead of one after the other, and
+ * the work is spread over the instance thread pool when it has one.
+ *
+ * @param instance - backend instance, or NULL to run on the calling thread
+ * @param ct - checksum type
+ * @param fragments - fragments (with headers) of one stripe
+ * @param num_fragments - number of fragments, at most EC_MAX_FRAGMENTS
+ * @param blocksize - payload size of every fragment
+ *
+ * @return 0 on success, -EBADHEADER if a fragment header is invalid,
+ *         -ENOMEM if the checksums could not be set up
+ */
+int set_stripe_checksums(ec_backend_t instance, ec_checksum_type_t ct,
+        char **fragments, int num_fragments, int blocksize)
+{
+    const void *payloads[EC_MAX_FRAGMENTS];
+    uint32_t sizes[EC_MAX_FRAGMENTS];
+    uint32_t digests[EC_MAX_FRAGMENTS][4];
+    int i, ret;
+
+    if ((ct != CHKSUM_CRC32 && ct != CHKSUM_CRC32C && ct != CHKSUM_MD5) ||
+            num_fragments <= 0 || num_fragments > EC_MAX_FRAGMENTS) {
+        for (i = 0; i < num_fragments; i++) {
+            if (set_checksum(ct, fragments[i], blocksize) < 0) {
+                return -EBADHEADER;
+            }
+        }
+        return 0;
+    }
+
+    for (i = 0; i < num_fragments; i++) {
+        fragment_header_t *header = (fragment_header_t *) fragments[i];
+
+        if (header->magic != LIBERASURECODE_FRAG_HEADER_MAGIC) {
+            log_error("Invalid fragment header (set chksum)!\n");
+            return -EBADHEADER;
+        }
+        payloads[i] = get_data_ptr_from_fragment(fragments[i]);
+        sizes[i] = blocksize;
+    }
+
+    ret = instance_payload_checksums(instance, ct, payloads, sizes,
+                                     num_fragments, digests);
+    if (ret < 0) {
+        return ret;
+    }
+
+    for (i = 0; i < num_fragments; i++) {
+        fragment_header_t *header = (fragment_header_t *) fragments[i];
+
+        header->meta.chksum_type = ct;
+        header->meta.chksum_mismatch = 0;
+        if (ct == CHKSUM_MD5) {
+            memcpy(header->meta.chksum, digests[i], sizeof(digests[i]));
+        } else {
+            header->meta.chksum[0] = digests[i][0];
+        }
+    }
+
+    return 0;
+}
+
 inline uint32_t* get_chksum(char *buf)
 {
     fragment_header_t* header = (fragment_header_t*) buf;
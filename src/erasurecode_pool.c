@@ -0,0 +1,360 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode fragment buffer pool implementation
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#include "erasurecode_log.h"
+#include "erasurecode_pool.h"
+#include "erasurecode_stdinc.h"
+
+#define EC_POOL_ALIGN           64      /* alignment of returned buffers */
+#define EC_POOL_MIN_SHIFT       12      /* smallest class is 4 KiB */
+#define EC_POOL_MAX_SHIFT       28      /* largest class is 256 MiB */
+#define EC_POOL_STEPS_SHIFT     2       /* 4 classes per power of two */
+#define EC_POOL_NUM_CLASSES \
+    (1 + ((EC_POOL_MAX_SHIFT - EC_POOL_MIN_SHIFT) << EC_POOL_STEPS_SHIFT))
+#define EC_POOL_NUM_SHARDS      8
+#define EC_POOL_MAGIC           0xec9001u
+
+/* Bookkeeping kept in front of every buffer handed out by the pool */
+struct ec_pool_chunk {
+    struct ec_pool_chunk *next;     /* free list link, while cached */
+    uint64_t size;                  /* usable bytes after the header */
+    int size_class;                 /* -1 if too large to be cached */
+    uint32_t magic;
+};
+
+#define EC_POOL_HDR_SIZE \
+    (((sizeof(struct ec_pool_chunk) + EC_POOL_ALIGN - 1) / EC_POOL_ALIGN) \
+     * EC_POOL_ALIGN)
+
+struct ec_pool_shard {
+    mutex_t lock;
+    struct ec_pool_chunk *free[EC_POOL_NUM_CLASSES];
+} __attribute__((aligned(EC_POOL_ALIGN)));
+
+struct ec_pool {
+    struct ec_pool_shard shards[EC_POOL_NUM_SHARDS];
+
+    uint64_t max_bytes;             /* cap on cached_bytes */
+    int prefault;                   /* touch fresh buffers up front */
+    long page_size;
+
+    /* Occupancy counters, updated with atomic builtins */
+    uint64_t cached_bytes;
+    uint64_t cached_buffers;
+    uint64_t in_use_bytes;
+    uint64_t in_use_buffers;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t drops;
+};
+
+/* Shard affinity of the calling thread, assigned round-robin on first use */
+static __thread int ec_pool_thread_shard = -1;
+static unsigned int ec_pool_next_shard = 0;
+
+static int ec_pool_shard_id(void)
+{
+    if (ec_pool_thread_shard < 0) {
+        ec_pool_thread_shard = __atomic_fetch_add(&ec_pool_next_shard, 1,
+                __ATOMIC_RELAXED) % EC_POOL_NUM_SHARDS;
+    }
+    return ec_pool_thread_shard;
+}
+
+#define ec_pool_add(counter, val) \
+    __atomic_fetch_add(&(counter), (val), __ATOMIC_RELAXED)
+#define ec_pool_sub(counter, val) \
+    __atomic_fetch_sub(&(counter), (val), __ATOMIC_RELAXED)
+#define ec_pool_load(counter) \
+    __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/*
+ * Map a request size onto its size class.  Classes split every power of
+ * two into four equal steps, so a buffer is never more than 25% larger
+ * than the fragment it holds.
+ *
+ * Returns the class index and its buffer size, or -1 if the request is
+ * too large to be cached.
+ */
+static int ec_pool_size_class(uint64_t size, uint64_t *class_size)
+{
+    int shift;
+    uint64_t step, q;
+
+    if (size <= (1ULL << EC_POOL_MIN_SHIFT)) {
+        *class_size = 1ULL << EC_POOL_MIN_SHIFT;
+        return 0;
+    }
+    if (size > (1ULL << EC_POOL_MAX_SHIFT)) {
+        *class_size = size;
+        return -1;
+    }
+
+    /* size - 1 lies in [2^shift, 2^(shift + 1)) */
+    shift = 63 - __builtin_clzll(size - 1);
+    step = 1ULL << (shift - EC_POOL_STEPS_SHIFT);
+    q = ((size - 1) >> (shift - EC_POOL_STEPS_SHIFT)) &
+        ((1 << EC_POOL_STEPS_SHIFT) - 1);
+
+    *class_size = (1ULL << shift) + (q + 1) * step;
+    return 1 + ((shift - EC_POOL_MIN_SHIFT) << EC_POOL_STEPS_SHIFT) + q;
+}
+
+/**
+ * Create a fragment buffer pool
+ *
+ * @param max_bytes - upper bound on the bytes the pool keeps cached for
+ *        reuse; buffers returned beyond that are released to the system
+ * @param prefault - when non-zero, fault in the pages of every newly
+ *        allocated buffer before handing it out
+ *
+ * @return pool handle, NULL on error
+ */
+struct ec_pool *ec_pool_create(uint64_t max_bytes, int prefault)
+{
+    struct ec_pool *pool = NULL;
+    int i;
+
+    if (posix_memalign((void **) &pool, EC_POOL_ALIGN, sizeof(*pool)) != 0) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(*pool));
+
+    for (i = 0; i < EC_POOL_NUM_SHARDS; i++) {
+        if (mutex_init(&pool->shards[i].lock) != 0) {
+            while (--i >= 0) {
+                mutex_destroy(&pool->shards[i].lock);
+            }
+            free(pool);
+            return NULL;
+        }
+    }
+
+    pool->max_bytes = max_bytes;
+    pool->prefault = prefault;
+    pool->page_size = sysconf(_SC_PAGESIZE);
+    if (pool->page_size <= 0) {
+        pool->page_size = 4096;
+    }
+
+    return pool;
+}
+
+/**
+ * Destroy a fragment buffer pool, releasing every cached buffer.
+ *
+ * All buffers handed out by the pool must have been returned first.
+ */
+void ec_pool_destroy(struct ec_pool *pool)
+{
+    int i, c;
+
+    if (NULL == pool) {
+        return;
+    }
+
+    if (ec_pool_load(pool->in_use_buffers) != 0) {
+        log_error("Destroying buffer pool with %lu buffers still in use!",
+                  (unsigned long) ec_pool_load(pool->in_use_buffers));
+    }
+
+    for (i = 0; i < EC_POOL_NUM_SHARDS; i++) {
+        struct ec_pool_shard *shard = &pool->shards[i];
+
+        for (c = 0; c < EC_POOL_NUM_CLASSES; c++) {
+            struct ec_pool_chunk *chunk = shard->free[c];
+
+            while (chunk) {
+                struct ec_pool_chunk *next = chunk->next;
+                free(chunk);
+                chunk = next;
+            }
+        }
+        mutex_destroy(&shard->lock);
+    }
+
+    free(pool);
+}
+
+/*
+ * Pop a cached buffer of the given class, preferring the calling thread's
+ * shard and only stealing from shards nobody else is holding.
+ */
+static struct ec_pool_chunk *ec_pool_take(struct ec_pool *pool, int size_class)
+{
+    int home = ec_pool_shard_id();
+    int i;
+
+    for (i = 0; i < EC_POOL_NUM_SHARDS; i++) {
+        struct ec_pool_shard *shard =
+            &pool->shards[(home + i) % EC_POOL_NUM_SHARDS];
+        struct ec_pool_chunk *chunk;
+
+        if (i == 0) {
+            mutex_lock(&shard->lock);
+        } else if (ec_pool_load(pool->cached_buffers) == 0) {
+            break;
+        } else if (mutex_trylock(&shard->lock) != 0) {
+            continue;
+        }
+
+        chunk = shard->free[size_class];
+        if (chunk) {
+            shard->free[size_class] = chunk->next;
+            ec_pool_sub(pool->cached_buffers, 1);
+        }
+        mutex_unlock(&shard->lock);
+
+        if (chunk) {
+            return chunk;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Get a buffer of at least 'size' bytes from the pool
+ *
+ * @param pool - pool handle
+ * @param size - number of bytes needed
+ * @param zero - when non-zero, the first 'size' bytes are cleared
+ *
+ * @return 64-byte aligned buffer, NULL on error
+ */
+void *ec_pool_alloc(struct ec_pool *pool, uint64_t size, int zero)
+{
+    struct ec_pool_chunk *chunk = NULL;
+    uint64_t class_size = 0;
+    int size_class;
+    char *buf;
+
+    size_class = ec_pool_size_class(size, &class_size);
+    if (size_class >= 0) {
+        chunk = ec_pool_take(pool, size_class);
+    }
+
+    if (chunk) {
+        ec_pool_sub(pool->cached_bytes, chunk->size);
+        ec_pool_add(pool->hits, 1);
+        buf = (char *) chunk + EC_POOL_HDR_SIZE;
+        if (zero) {
+            memset(buf, 0, size);
+        }
+    } else {
+        if (posix_memalign((void **) &chunk, EC_POOL_ALIGN,
+                           EC_POOL_HDR_SIZE + class_size) != 0) {
+            return NULL;
+        }
+        chunk->size = class_size;
+        chunk->size_class = size_class;
+        chunk->magic = EC_POOL_MAGIC;
+        ec_pool_add(pool->misses, 1);
+        buf = (char *) chunk + EC_POOL_HDR_SIZE;
+
+        if (zero) {
+            memset(buf, 0, size);
+        } else if (pool->prefault) {
+            uint64_t off;
+            for (off = 0; off < size; off += pool->page_size) {
+                ((volatile char *) buf)[off] = 0;
+            }
+        }
+    }
+
+    chunk->next = NULL;
+    ec_pool_add(pool->in_use_bytes, chunk->size);
+    ec_pool_add(pool->in_use_buffers, 1);
+
+    return buf;
+}
+
+/**
+ * Return a buffer obtained from ec_pool_alloc() to the pool.  The buffer is
+ * cached for reuse unless that would take the pool over its cap.
+ */
+void ec_pool_free(struct ec_pool *pool, void *buf)
+{
+    struct ec_pool_chunk *chunk;
+    struct ec_pool_shard *shard;
+    uint64_t cached;
+
+    if (NULL == buf) {
+        return;
+    }
+
+    chunk = (struct ec_pool_chunk *) ((char *) buf - EC_POOL_HDR_SIZE);
+    if (chunk->magic != EC_POOL_MAGIC) {
+        log_error("Invalid buffer returned to the pool!");
+        return;
+    }
+
+    ec_pool_sub(pool->in_use_bytes, chunk->size);
+    ec_pool_sub(pool->in_use_buffers, 1);
+
+    if (chunk->size_class < 0) {
+        goto release;
+    }
+
+    /* Reserve room under the cap before caching the buffer */
+    cached = ec_pool_load(pool->cached_bytes);
+    do {
+        if (cached + chunk->size > pool->max_bytes) {
+            goto release;
+        }
+    } while (!__atomic_compare_exchange_n(&pool->cached_bytes, &cached,
+                cached + chunk->size, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    shard = &pool->shards[ec_pool_shard_id()];
+    mutex_lock(&shard->lock);
+    chunk->next = shard->free[chunk->size_class];
+    shard->free[chunk->size_class] = chunk;
+    ec_pool_add(pool->cached_buffers, 1);
+    mutex_unlock(&shard->lock);
+    return;
+
+release:
+    ec_pool_add(pool->drops, 1);
+    free(chunk);
+}
+
+/**
+ * Snapshot the pool occupancy counters.  Counters are sampled one at a
+ * time, so a snapshot taken under concurrent use is only approximate.
+ */
+void ec_pool_get_stats(struct ec_pool *pool, struct ec_pool_stats *stats)
+{
+    stats->max_bytes = pool->max_bytes;
+    stats->cached_bytes = ec_pool_load(pool->cached_bytes);
+    stats->cached_buffers = ec_pool_load(pool->cached_buffers);
+    stats->in_use_bytes = ec_pool_load(pool->in_use_bytes);
+    stats->in_use_buffers = ec_pool_load(pool->in_use_buffers);
+    stats->hits = ec_pool_load(pool->hits);
+    stats->misses = ec_pool_load(pool->misses);
+    stats->drops = ec_pool_load(pool->drops);
+}
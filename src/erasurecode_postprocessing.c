@@ -26,11 +26,12 @@
  * vi: set noai tw=79 ts=4 sw=4:
  */
 
-#include <zlib.h>
 #include "erasurecode_backend.h"
+#include "erasurecode_crc.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
 #include "erasurecode_log.h"
+#include "erasurecode_postprocessing.h"
 #include "erasurecode_stdinc.h"
 
 void add_fragment_metadata(ec_backend_t be, char *fragment,
@@ -59,7 +60,7 @@ void add_fragment_metadata(ec_backend_t be, char *fragment,
         return;
     }
 
-    header->metadata_chksum = crc32(0, (unsigned char *) &header->meta,
+    header->metadata_chksum = liberasurecode_crc32(0, &header->meta,
                                     sizeof(fragment_metadata_t));
 }
 
@@ -67,23 +68,72 @@ int finalize_fragments_after_encode(ec_backend_t instance,
         int k, int m, int blocksize, uint64_t orig_data_size,
         char **encoded_data, char **encoded_parity)
 {
-    int i, set_chksum = 1;
+    return finalize_fragments_after_encode_chksums(instance, k, m,
+            blocksize, orig_data_size, encoded_data, encoded_parity, NULL);
+}
+
+/*
+ * Same as finalize_fragments_after_encode(), taking the k + m payload
+ * checksums (CRC32/CRC32C, computed along with the encode) from chksums
+ * instead of reading the payloads again, unless chksums is NULL.
+ */
+int finalize_fragments_after_encode_chksums(ec_backend_t instance,
+        int k, int m, int blocksize, uint64_t orig_data_size,
+        char **encoded_data, char **encoded_parity, const uint32_t *chksums)
+{
+    int i, ret;
     ec_checksum_type_t ct = instance->args.uargs.ct;
+    char *fragments[EC_MAX_FRAGMENTS];
+
+    for (i = 0; i < k; i++) {
+        fragments[i] = get_fragment_ptr_from_data(encoded_data[i]);
+    }
+    for (i = 0; i < m; i++) {
+        fragments[i + k] = get_fragment_ptr_from_data(encoded_parity[i]);
+    }
+
+    if (NULL != chksums) {
+        for (i = 0; i < k + m; i++) {
+            fragment_header_t *header = (fragment_header_t *) fragments[i];
+
+            header->meta.chksum_type = ct;
+            header->meta.chksum_mismatch = 0;
+            header->meta.chksum[0] = chksums[i];
+        }
+    } else {
+        /* checksum the whole stripe in one go, ahead of the metadata */
+        ret = set_stripe_checksums(instance, ct, fragments, k + m,
+                                   blocksize);
+        if (ret < 0) {
+            // ensure encoded_data/parity point the head of fragment_ptr
+            for (i = 0; i < k; i++) {
+                encoded_data[i] = fragments[i];
+            }
+            for (i = 0; i < m; i++) {
+                encoded_parity[i] = fragments[i + k];
+            }
+            return ret;
+        }
+    }
+
+    /*
+     * The payload checksums are already in place, taken from chksums or
+     * set by set_stripe_checksums(), so add_fragment_metadata() must not
+     * compute them again.
+     */
 
     /* finalize data fragments */
     for (i = 0; i < k; i++) {
-        char *fragment = get_fragment_ptr_from_data(encoded_data[i]);
-        add_fragment_metadata(instance, fragment, i, orig_data_size,
-                blocksize, ct, set_chksum);
-        encoded_data[i] = fragment;
+        add_fragment_metadata(instance, fragments[i], i, orig_data_size,
+                blocksize, ct, 0);
+        encoded_data[i] = fragments[i];
     }
 
     /* finalize parity fragments */
     for (i = 0; i < m; i++) {
-        char *fragment = get_fragment_ptr_from_data(encoded_parity[i]);
-        add_fragment_metadata(instance, fragment, i + k, orig_data_size,
-                blocksize, ct, set_chksum);
-        encoded_parity[i] = fragment;
+        add_fragment_metadata(instance, fragments[i + k], i + k,
+                orig_data_size, blocksize, ct, 0);
+        encoded_parity[i] = fragments[i + k];
     }
 
     return 0;
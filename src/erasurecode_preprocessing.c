@@ -33,17 +33,209 @@
 #include "erasurecode_preprocessing.h"
 #include "erasurecode_stdinc.h"
 
+/*
+ * Copy up to 'len' bytes from the iovec list into 'dst', advancing the
+ * (iov, iovcnt, iov_off) cursor past the bytes consumed.
+ */
+static void copy_from_iov(char *dst, const struct iovec **iov, int *iovcnt,
+        size_t *iov_off, int len)
+{
+    while (len > 0 && *iovcnt > 0) {
+        size_t avail = (*iov)->iov_len - *iov_off;
+        size_t n;
+
+        if (0 == avail) {
+            (*iov)++;
+            (*iovcnt)--;
+            *iov_off = 0;
+            continue;
+        }
+
+        n = avail > (size_t) len ? (size_t) len : avail;
+        memcpy(dst, (char *) (*iov)->iov_base + *iov_off, n);
+        dst += n;
+        len -= n;
+        *iov_off += n;
+    }
+}
+
 int prepare_fragments_for_encode(ec_backend_t instance,
         int k, int m,
         const char *orig_data, uint64_t orig_data_size, /* input */
         char **encoded_data, char **encoded_parity,     /* output */
         int *blocksize)
 {
-    int i, ret = 0;
+    struct iovec iov = {
+        .iov_base = (void *) orig_data,
+        .iov_len = orig_data_size,
+    };
+
+    return prepare_fragments_for_encode_iov(instance, k, m, &iov, 1,
+                                            orig_data_size, encoded_data,
+                                            encoded_parity, blocksize);
+}
+
+int prepare_fragments_for_encode_iov(ec_backend_t instance,
+        int k, int m,
+        const struct iovec *iov, int iovcnt,            /* input */
+        uint64_t orig_data_size,                        /* input */
+        char **encoded_data, char **encoded_parity,     /* output */
+        int *blocksize)
+{
+    int i;
+    int aligned_data_len;   /* EC algorithm compatible data length */
+    int buffer_size, payload_size = 0;
+    int metadata_size;
+
+    /* Calculate data sizes, aligned_data_len guaranteed to be divisible by k*/
+    aligned_data_len = get_aligned_data_size(instance, orig_data_size);
+    payload_size = (aligned_data_len / k);
+    metadata_size = instance->common.ops->get_backend_metadata_size(
+                                    instance->desc.backend_desc,
+                                    payload_size);
+    buffer_size = payload_size + metadata_size;
+
+    /*
+     * Every byte of these is either copied over or cleared when the
+     * fragments are laid out below, so skip zeroing them here
+     */
+    for (i = 0; i < k + m; i++) {
+        char *fragment = instance_alloc_fragment_buffer_uninit(instance,
+                                                               buffer_size);
+        if (NULL == fragment) {
+            goto out_error;
+        }
+        if (i < k) {
+            encoded_data[i] = fragment;
+        } else {
+            encoded_parity[i - k] = fragment;
+        }
+    }
+
+    return prepare_fragments_for_encode_into_iov(instance, k, m, iov, iovcnt,
+                                                 orig_data_size, encoded_data,
+                                                 encoded_parity, blocksize);
+
+out_error:
+    printf ("ERROR in encode\n");
+    /* The caller owns (and frees) the arrays, release the fragments only */
+    for (i = 0; i < k; i++) {
+        instance_free_buffer(instance, encoded_data[i]);
+        encoded_data[i] = NULL;
+    }
+
+    for (i = 0; i < m; i++) {
+        instance_free_buffer(instance, encoded_parity[i]);
+        encoded_parity[i] = NULL;
+    }
+
+    return -ENOMEM;
+}
+
+/*
+ * Allocate and lay out the k + m fragments of a tiled encode, without
+ * filling in any payload: the tiled encode copies the data in itself,
+ * one cache-sized tile at a time, right before encoding it.  Only for
+ * column independent backends, which keep no metadata in the payload.
+ */
+int prepare_fragments_for_encode_tiled(ec_backend_t instance,
+        int k, int m,
+        uint64_t orig_data_size,                        /* input */
+        char **encoded_data, char **encoded_parity,     /* output */
+        int *blocksize)
+{
+    int i;
+    int aligned_data_len;   /* EC algorithm compatible data length */
+    int buffer_size, payload_size = 0;
+    int metadata_size;
+
+    aligned_data_len = get_aligned_data_size(instance, orig_data_size);
+    *blocksize = payload_size = (aligned_data_len / k);
+    metadata_size = instance->common.ops->get_backend_metadata_size(
+                                    instance->desc.backend_desc,
+                                    payload_size);
+    buffer_size = payload_size + metadata_size;
+
+    for (i = 0; i < k + m; i++) {
+        char *fragment = instance_alloc_fragment_buffer_uninit(instance,
+                                                               buffer_size);
+        if (NULL == fragment) {
+            goto out_error;
+        }
+
+        memset(fragment, 0, sizeof(fragment_header_t));
+        if (metadata_size > 0) {
+            memset(fragment + sizeof(fragment_header_t) + payload_size, 0,
+                   metadata_size);
+        }
+        init_fragment_header(fragment);
+
+        if (i < k) {
+            encoded_data[i] = fragment + sizeof(fragment_header_t);
+        } else {
+            encoded_parity[i - k] = fragment + sizeof(fragment_header_t);
+        }
+    }
+
+    return 0;
+
+out_error:
+    /* The caller owns (and frees) the arrays, release the fragments only */
+    for (i = 0; i < k; i++) {
+        if (encoded_data[i]) {
+            instance_free_buffer(instance,
+                    get_fragment_ptr_from_data(encoded_data[i]));
+            encoded_data[i] = NULL;
+        }
+    }
+
+    for (i = 0; i < m; i++) {
+        if (encoded_parity[i]) {
+            instance_free_buffer(instance,
+                    get_fragment_ptr_from_data(encoded_parity[i]));
+            encoded_parity[i] = NULL;
+        }
+    }
+
+    return -ENOMEM;
+}
+
+/*
+ * Same as prepare_fragments_for_encode(), but lays the fragments out in
+ * k + m caller-owned buffers (passed in encoded_data/encoded_parity) rather
+ * than allocating them.  Each buffer must hold at least a full fragment.
+ * On return the arrays hold the payload pointers, as after
+ * prepare_fragments_for_encode().
+ */
+int prepare_fragments_for_encode_into(ec_backend_t instance,
+        int k, int m,
+        const char *orig_data, uint64_t orig_data_size, /* input */
+        char **encoded_data, char **encoded_parity,     /* input/output */
+        int *blocksize)
+{
+    struct iovec iov = {
+        .iov_base = (void *) orig_data,
+        .iov_len = orig_data_size,
+    };
+
+    return prepare_fragments_for_encode_into_iov(instance, k, m, &iov, 1,
+                                                 orig_data_size, encoded_data,
+                                                 encoded_parity, blocksize);
+}
+
+int prepare_fragments_for_encode_into_iov(ec_backend_t instance,
+        int k, int m,
+        const struct iovec *iov, int iovcnt,            /* input */
+        uint64_t orig_data_size,                        /* input */
+        char **encoded_data, char **encoded_parity,     /* input/output */
+        int *blocksize)
+{
+    int i;
     int data_len;           /* data len to write to fragment headers */
     int aligned_data_len;   /* EC algorithm compatible data length */
     int buffer_size, payload_size = 0;
     int metadata_size, data_offset = 0;
+    size_t iov_off = 0;     /* offset into the current iovec */
 
     /* Calculate data sizes, aligned_data_len guaranteed to be divisible by k*/
     data_len = orig_data_size;
@@ -59,55 +251,251 @@ int prepare_fragments_for_encode(ec_backend_t instance,
 
     for (i = 0; i < k; i++) {
         int copy_size = data_len > payload_size ? payload_size : data_len;
-        char *fragment = (char *) alloc_fragment_buffer(buffer_size);
-        if (NULL == fragment) {
-            ret = -ENOMEM;
-            goto out_error;
+        char *fragment = encoded_data[i];
+        char *payload = fragment + sizeof(fragment_header_t);
+
+        /*
+         * The caller's buffer holds stale bytes: clear everything the
+         * copy below does not overwrite (header, encode offset, tail)
+         */
+        memset(fragment, 0, sizeof(fragment_header_t) + data_offset);
+        init_fragment_header(fragment);
+
+        if (copy_size > 0) {
+            copy_from_iov(payload + data_offset, &iov, &iovcnt, &iov_off,
+                          copy_size);
         }
-      
-        /* Copy existing data into clean, zero'd out buffer */
-        encoded_data[i] = get_data_ptr_from_fragment(fragment);
-      
-        if (data_len > 0) {
-            memcpy(encoded_data[i] + data_offset, orig_data, copy_size);
+        if (data_offset + copy_size < buffer_size) {
+            memset(payload + data_offset + copy_size, 0,
+                   buffer_size - data_offset - copy_size);
         }
+        encoded_data[i] = payload;
 
-        orig_data += copy_size;
         data_len -= copy_size;
     }
 
     for (i = 0; i < m; i++) {
-        char *fragment = (char *) alloc_fragment_buffer(buffer_size);
-        if (NULL == fragment) {
-            ret = -ENOMEM;
-            goto out_error;
+        char *fragment = encoded_parity[i];
+
+        if (is_backend_parity_overwriting(instance)) {
+            /* the backend fills [0, blocksize), clear the rest */
+            memset(fragment, 0, sizeof(fragment_header_t));
+            if (buffer_size > payload_size) {
+                memset(fragment + sizeof(fragment_header_t) + payload_size,
+                       0, buffer_size - payload_size);
+            }
+        } else {
+            memset(fragment, 0, sizeof(fragment_header_t) + buffer_size);
         }
+        init_fragment_header(fragment);
+        encoded_parity[i] = fragment + sizeof(fragment_header_t);
+    }
 
-        encoded_parity[i] = get_data_ptr_from_fragment(fragment);
+    return 0;
+}
+
+/*
+ * Slab fragments start on a cache line, or further in when the instance
+ * wants its payloads aligned beyond 16 bytes: the first payload is then
+ * aligned and the stride keeps the others so.  EC_SLAB_ALIGN bytes of
+ * slack cover the shift, or the alignment itself when it is larger.
+ */
+static size_t slab_stride(ec_backend_t instance, size_t fragment_size)
+{
+    size_t align = instance_payload_align(instance);
+
+    if (align < EC_SLAB_ALIGN) {
+        align = EC_SLAB_ALIGN;
     }
 
-out:
-    return ret;
+    return (fragment_size + align - 1) & ~(align - 1);
+}
 
-out_error:
-    printf ("ERROR in encode\n");
-    if (encoded_data) {
-        for (i = 0; i < k; i++) {
-            if (encoded_data[i])
-                free_fragment_buffer(encoded_data[i]);
-        }
-        check_and_free_buffer(encoded_data);
+static size_t slab_slack(ec_backend_t instance)
+{
+    size_t align = instance_payload_align(instance);
+
+    if (align <= 16) {
+        return 0;
+    }
+
+    return align < EC_SLAB_ALIGN ? EC_SLAB_ALIGN : align;
+}
+
+static char *slab_first_fragment(ec_backend_t instance, char *start)
+{
+    uintptr_t align = instance_payload_align(instance);
+    uintptr_t payload;
+
+    if (align <= 16) {
+        return start;
+    }
+
+    payload = ((uintptr_t) start + sizeof(fragment_header_t) + align - 1) &
+              ~(align - 1);
+
+    return (char *) payload - sizeof(fragment_header_t);
+}
+
+/*
+ * Same as prepare_fragments_for_encode_iov(), but the whole stripe is a
+ * single allocation: the k + m pointer arrays come first, followed by the
+ * fragments (header and payload), each starting on a cache line (see
+ * slab_stride()).  The
+ * arrays are returned in encoded_data and encoded_parity; the slab is
+ * released by freeing *encoded_data (see free_encode_slab()).
+ */
+int prepare_fragments_for_encode_slab(ec_backend_t instance,
+        int k, int m,
+        const struct iovec *iov, int iovcnt,            /* input */
+        uint64_t orig_data_size,                        /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        int *blocksize)
+{
+    int i;
+    int payload_size, metadata_size;
+    size_t array_size, stride;
+    char **ptrs;
+    char *fragment;
+
+    payload_size = get_aligned_data_size(instance, orig_data_size) / k;
+    metadata_size = instance->common.ops->get_backend_metadata_size(
+                                    instance->desc.backend_desc,
+                                    payload_size);
+
+    array_size = sizeof(char *) * (k + m);
+    array_size = (array_size + EC_SLAB_ALIGN - 1) & ~(EC_SLAB_ALIGN - 1);
+    stride = slab_stride(instance, sizeof(fragment_header_t) +
+                                   payload_size + metadata_size);
+
+    ptrs = instance_alloc_buffer_uninit(instance,
+                                        array_size + stride * (k + m) +
+                                        slab_slack(instance));
+    if (NULL == ptrs) {
+        log_error("Could not allocate stripe slab!");
+        return -ENOMEM;
+    }
+
+    fragment = slab_first_fragment(instance, (char *) ptrs + array_size);
+    for (i = 0; i < k + m; i++) {
+        ptrs[i] = fragment;
+        fragment += stride;
+    }
+
+    *encoded_data = ptrs;
+    *encoded_parity = ptrs + k;
+
+    return prepare_fragments_for_encode_into_iov(instance, k, m, iov, iovcnt,
+                                                 orig_data_size, ptrs,
+                                                 ptrs + k, blocksize);
+}
+
+/*
+ * Release a stripe from prepare_fragments_for_encode_slab(), given either
+ * of its pointer arrays.
+ */
+void free_encode_slab(ec_backend_t instance, int k,
+        char **encoded_data, char **encoded_parity)
+{
+    if (NULL != encoded_data) {
+        instance_free_buffer(instance, encoded_data);
+    } else if (NULL != encoded_parity) {
+        instance_free_buffer(instance, encoded_parity - k);
     }
+}
+
+/*
+ * Lay out the stripes of num_objects independent objects in a single slab:
+ * all the per-object pointer arrays come first, followed by each object's
+ * k + m fragments, every fragment starting on a cache line.  The arrays of
+ * object i are returned in encoded_data[i] and encoded_parity[i], and its
+ * payload size in blocksizes[i].  The slab starts at encoded_data[0] and is
+ * released with free_encode_slab(instance, k, encoded_data[0], NULL).
+ */
+int prepare_fragments_for_encode_batch(ec_backend_t instance,
+        int k, int m, int num_objects,
+        const char **orig_data, const uint64_t *orig_data_size, /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        int *blocksizes)
+{
+    int i, j;
+    int ret = 0;
+    int payload_size, metadata_size;
+    size_t array_size, slab_size;
+    char **ptrs;
+    char *fragment;
+
+    array_size = sizeof(char *) * (k + m) * num_objects;
+    array_size = (array_size + EC_SLAB_ALIGN - 1) & ~(EC_SLAB_ALIGN - 1);
+
+    /* First pass: size each stripe, stashing its stride in blocksizes */
+    slab_size = array_size;
+    for (i = 0; i < num_objects; i++) {
+        size_t stride;
+
+        payload_size = get_aligned_data_size(instance, orig_data_size[i]) / k;
+        metadata_size = instance->common.ops->get_backend_metadata_size(
+                                        instance->desc.backend_desc,
+                                        payload_size);
+        stride = slab_stride(instance, sizeof(fragment_header_t) +
+                                       payload_size + metadata_size);
+        blocksizes[i] = stride;
+        slab_size += stride * (k + m);
+    }
+
+    ptrs = instance_alloc_buffer_uninit(instance,
+                                        slab_size + slab_slack(instance));
+    if (NULL == ptrs) {
+        log_error("Could not allocate batch slab!");
+        return -ENOMEM;
+    }
+
+    fragment = slab_first_fragment(instance, (char *) ptrs + array_size);
+    for (i = 0; i < num_objects; i++) {
+        char **stripe = ptrs + (size_t) i * (k + m);
+        size_t stride = blocksizes[i];
 
-    if (encoded_parity) {
-        for (i = 0; i < m; i++) {
-            if (encoded_parity[i])
-                free_fragment_buffer(encoded_parity[i]);
+        for (j = 0; j < k + m; j++) {
+            stripe[j] = fragment;
+            fragment += stride;
         }
-        check_and_free_buffer(encoded_parity);
+        encoded_data[i] = stripe;
+        encoded_parity[i] = stripe + k;
+
+        ret = prepare_fragments_for_encode_into(instance, k, m,
+                                                orig_data[i],
+                                                orig_data_size[i],
+                                                stripe, stripe + k,
+                                                &blocksizes[i]);
+        if (ret < 0) {
+            instance_free_buffer(instance, ptrs);
+            for (j = 0; j < num_objects; j++) {
+                encoded_data[j] = NULL;
+                encoded_parity[j] = NULL;
+            }
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Decide whether an unaligned fragment can be used in place, counting
+ * the outcome in the instance decode stats
+ */
+bool keep_unaligned_fragment(ec_backend_t instance, int fragment_size)
+{
+    if (is_backend_unaligned_capable(instance)) {
+        __atomic_fetch_add(&instance->unaligned_in_place, 1,
+                           __ATOMIC_RELAXED);
+        return true;
     }
 
-    goto out;
+    __atomic_fetch_add(&instance->unaligned_copies, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&instance->unaligned_copy_bytes, fragment_size,
+                       __ATOMIC_RELAXED);
+    return false;
 }
 
 /* 
@@ -117,7 +505,7 @@ out_error:
  * case, the caller has to free up in the success case, so it may as well do
  * so in the failure case.
  */
-int prepare_fragments_for_decode(
+int prepare_fragments_for_decode(ec_backend_t instance,
         int k, int m,
         char **data, char **parity,
         int  *missing_idxs,
@@ -128,14 +516,17 @@ int prepare_fragments_for_decode(
     unsigned long long missing_bm;  /* bitmap form of missing indexes list */
     int orig_data_size = -1;
     int payload_size = -1;
+    int align = instance_payload_align(instance);
 
     missing_bm = convert_list_to_bitmap(missing_idxs);
 
     /*
      * Determine if each data fragment is:
      * 1.) Alloc'd: if not, alloc new buffer (for missing fragments)
-     * 2.) Aligned to 16-byte boundaries: if not, alloc a new buffer
-     *     memcpy the contents and free the old buffer
+     *     zeroed, as some backends accumulate into the missing payloads
+     * 2.) Payload aligned to the instance payload alignment: if not, and
+     *     the backend cannot work on it in place, alloc a new buffer and
+     *     memcpy the contents
      */
     for (i = 0; i < k; i++) {
         /*
@@ -145,14 +536,18 @@ int prepare_fragments_for_decode(
          * 'data_list'
          */
         if (NULL == data[i]) {
-            data[i] = alloc_fragment_buffer(fragment_size - sizeof(fragment_header_t));
+            data[i] = instance_alloc_fragment_buffer(instance,
+                    fragment_size - sizeof(fragment_header_t));
             if (NULL == data[i]) {
                 log_error("Could not allocate data buffer!");
                 return -ENOMEM;
             }
             *realloc_bm = *realloc_bm | (1 << i);
-        } else if (!is_addr_aligned((unsigned long)data[i], 16)) {
-            char *tmp_buf = alloc_fragment_buffer(fragment_size - sizeof(fragment_header_t));
+        } else if (!is_addr_aligned((unsigned long)
+                        get_data_ptr_from_fragment(data[i]), align) &&
+                   !keep_unaligned_fragment(instance, fragment_size)) {
+            char *tmp_buf = instance_alloc_fragment_buffer_uninit(instance,
+                    fragment_size - sizeof(fragment_header_t));
             if (NULL == tmp_buf) {
                 log_error("Could not allocate temp buffer!");
                 return -ENOMEM;
@@ -184,14 +579,18 @@ int prepare_fragments_for_decode(
          * DO NOT FREE: the python GC should free the original when cleaning up 'data_list'
          */
         if (NULL == parity[i]) {
-            parity[i] = alloc_fragment_buffer(fragment_size-sizeof(fragment_header_t));
+            parity[i] = instance_alloc_fragment_buffer(instance,
+                    fragment_size - sizeof(fragment_header_t));
             if (NULL == parity[i]) {
                 log_error("Could not allocate parity buffer!");
                 return -ENOMEM;
             }
             *realloc_bm = *realloc_bm | (1 << (k + i));
-        } else if (!is_addr_aligned((unsigned long)parity[i], 16)) {
-            char *tmp_buf = alloc_fragment_buffer(fragment_size-sizeof(fragment_header_t));
+        } else if (!is_addr_aligned((unsigned long)
+                        get_data_ptr_from_fragment(parity[i]), align) &&
+                   !keep_unaligned_fragment(instance, fragment_size)) {
+            char *tmp_buf = instance_alloc_fragment_buffer_uninit(instance,
+                    fragment_size - sizeof(fragment_header_t));
             if (NULL == tmp_buf) {
                 log_error("Could not allocate temp buffer!");
                 return -ENOMEM;
@@ -277,43 +676,29 @@ int get_fragment_partition(
     return (num_missing > m) ? -EINSUFFFRAGS : 0;
 }
 
-int fragments_to_string(int k, int m,
+/*
+ * Put the data fragments found in 'fragments' in index order into 'data'
+ * (k entries, NULL-initialized by the caller) and validate that they all
+ * agree on the original data size.
+ *
+ * Returns the number of distinct data fragments found, or -error.
+ */
+static int collect_data_fragments(int k,
         char **fragments, int num_fragments,
-        char **orig_payload, uint64_t *payload_len)
+        char **data, int *orig_size)
 {
-    char *internal_payload = NULL;
-    char **data = NULL;
     int orig_data_size = -1;
     int i;
     int index;
     int data_size;
     int num_data = 0;
-    int string_off = 0;
-    int ret = -1;
-
-    if (num_fragments < k) {
-        /*
-         * This is not necessarily an error condition, so *do not log here*
-         * We can maybe debug log, if necessary.
-         */
-        goto out; 
-    }
-
-    data = (char **) get_aligned_buffer16(sizeof(char *) * k);
 
-    if (NULL == data) {
-        log_error("Could not allocate buffer for data!!");
-        ret = -ENOMEM;
-        goto out; 
-    }
-    
     for (i = 0; i < num_fragments; i++) {
         index = get_fragment_idx(fragments[i]);
         data_size = get_fragment_payload_size(fragments[i]);
         if ((index < 0) || (data_size < 0)) {
             log_error("Invalid fragment header information!");
-            ret = -EBADHEADER;
-            goto out;
+            return -EBADHEADER;
         }
 
         /* Validate the original data size */
@@ -322,8 +707,7 @@ int fragments_to_string(int k, int m,
         } else {
             if (get_orig_data_size(fragments[i]) != orig_data_size) {
                 log_error("Inconsistent orig_data_size in fragment header!");
-                ret = -EBADHEADER;
-                goto out;
+                return -EBADHEADER;
             }
         }
    
@@ -339,6 +723,64 @@ int fragments_to_string(int k, int m,
         }
     }
 
+    *orig_size = orig_data_size;
+    return num_data;
+}
+
+/*
+ * Concatenate the payloads of the k data fragments (in index order) into
+ * 'out', which must hold at least orig_data_size bytes.
+ */
+static void copy_data_fragments(int k, char **data,
+        int orig_data_size, char *out)
+{
+    int i;
+    int string_off = 0;
+
+    /* Copy fragment data into cstring (fragments should be in index order) */
+    for (i = 0; i < k && orig_data_size > 0; i++) {
+        char* fragment_data = get_data_ptr_from_fragment(data[i]);
+        int fragment_size = get_fragment_payload_size(data[i]);
+        int payload_size = orig_data_size > fragment_size ? fragment_size : orig_data_size;
+        memcpy(out + string_off, fragment_data, payload_size);
+        orig_data_size -= payload_size;
+        string_off += payload_size;
+    }
+}
+
+int fragments_to_string(ec_backend_t instance, int k, int m,
+        char **fragments, int num_fragments,
+        char **orig_payload, uint64_t *payload_len)
+{
+    char *internal_payload = NULL;
+    char **data = NULL;
+    int orig_data_size = -1;
+    int num_data = 0;
+    int ret = -1;
+
+    if (num_fragments < k) {
+        /*
+         * This is not necessarily an error condition, so *do not log here*
+         * We can maybe debug log, if necessary.
+         */
+        goto out; 
+    }
+
+    data = (char **) get_aligned_buffer16(sizeof(char *) * k);
+
+    if (NULL == data) {
+        log_error("Could not allocate buffer for data!!");
+        ret = -ENOMEM;
+        goto out; 
+    }
+
+    num_data = collect_data_fragments(k, fragments, num_fragments,
+                                      data, &orig_data_size);
+    if (num_data < 0) {
+        ret = num_data;
+        goto out;
+    }
+
     /* We do not have enough data fragments to do this! */
     if (num_data != k) {
         /*
@@ -349,7 +791,8 @@ int fragments_to_string(int k, int m,
     }
 
     /* Create the string to return */
-    internal_payload = (char *) get_aligned_buffer16(orig_data_size);
+    /* copy_data_fragments() fills all of it */
+    internal_payload = instance_alloc_buffer_uninit(instance, orig_data_size);
     if (NULL == internal_payload) {
         log_error("Could not allocate buffer for decoded string!");
         ret = -ENOMEM;
@@ -359,15 +802,7 @@ int fragments_to_string(int k, int m,
     /* Pass the original data length back */
     *payload_len = orig_data_size;
 
-    /* Copy fragment data into cstring (fragments should be in index order) */
-    for (i = 0; i < num_data && orig_data_size > 0; i++) {
-        char* fragment_data = get_data_ptr_from_fragment(data[i]);
-        int fragment_size = get_fragment_payload_size(data[i]);
-        int payload_size = orig_data_size > fragment_size ? fragment_size : orig_data_size;
-        memcpy(internal_payload + string_off, fragment_data, payload_size);
-        orig_data_size -= payload_size;
-        string_off += payload_size;
-    }
+    copy_data_fragments(k, data, orig_data_size, internal_payload);
 
     /* Everything worked just fine */
     ret = 0;
@@ -381,4 +816,43 @@ out:
     return ret;
 }
 
+/*
+ * Same as fragments_to_string(), but writes the original data into the
+ * caller's buffer 'out' of 'out_len' bytes instead of allocating one.
+ * Returns -EINVALIDPARAMS when 'out' cannot hold the original data and
+ * -1 (not an error) when the data fragments are not all available.
+ */
+int fragments_to_buffer(int k, int m,
+        char **fragments, int num_fragments,
+        char *out, uint64_t out_len, uint64_t *payload_len)
+{
+    char *data[EC_MAX_FRAGMENTS] = { NULL };
+    int orig_data_size = -1;
+    int num_data = 0;
+
+    if (num_fragments < k || k > EC_MAX_FRAGMENTS) {
+        return -1;
+    }
+
+    num_data = collect_data_fragments(k, fragments, num_fragments,
+                                      data, &orig_data_size);
+    if (num_data < 0) {
+        return num_data;
+    }
+
+    /* We do not have enough data fragments to do this! */
+    if (num_data != k) {
+        return -1;
+    }
+
+    if (out_len < (uint64_t) orig_data_size) {
+        log_error("Output buffer too small, need %d, but got %lu.",
+                  orig_data_size, (unsigned long)out_len);
+        return -EINVALIDPARAMS;
+    }
 
+    *payload_len = orig_data_size;
+    copy_data_fragments(k, data, orig_data_size, out);
+
+    return 0;
+}
@@ -0,0 +1,626 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode streaming segment encoder/decoder implementation
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#include "erasurecode.h"
+#include "erasurecode_backend.h"
+#include "erasurecode_helpers.h"
+#include "erasurecode_helpers_ext.h"
+#include "erasurecode_log.h"
+#include "erasurecode_postprocessing.h"
+#include "erasurecode_preprocessing.h"
+#include "erasurecode_stream.h"
+
+#define EC_STREAM_ALIGN         64      /* alignment of each fragment */
+#define EC_STREAM_STRIPES       2       /* encoder stripe buffers */
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Streaming encoder =*=~==~=*=~==~=*=~==~=*=~== */
+
+struct ec_stream_encoder {
+    int desc;
+    int k, m;
+    uint64_t segment_size;
+    ec_stream_encoder_cb cb;
+    void *cb_arg;
+
+    /* k + m fragments per stripe, fragment_stride bytes apart */
+    char *stripes[EC_STREAM_STRIPES];
+    uint64_t fragment_stride;
+    int next_stripe;            /* stripe the next segment goes to */
+    uint64_t segment_idx;       /* index of the next segment */
+
+    /* Partial segment carried over between feeds */
+    char *staging;
+    uint64_t staged;
+};
+
+struct ec_stream_encoder *ec_stream_encoder_create(int desc,
+        uint64_t segment_size, ec_stream_encoder_cb cb, void *cb_arg)
+{
+    struct ec_stream_encoder *encoder = NULL;
+    ec_backend_t instance = NULL;
+    int buffer_size;
+    int i;
+
+    if (0 == segment_size || segment_size > INT_MAX || NULL == cb) {
+        log_error("Invalid streaming encoder parameters!");
+        return NULL;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return NULL;
+    }
+
+    buffer_size = liberasurecode_get_fragment_buffer_size(desc, segment_size);
+    if (buffer_size < 0) {
+        goto error;
+    }
+
+    encoder = alloc_zeroed_buffer(sizeof(*encoder));
+    if (NULL == encoder) {
+        goto error;
+    }
+    encoder->desc = desc;
+    encoder->k = instance->args.uargs.k;
+    encoder->m = instance->args.uargs.m;
+    encoder->segment_size = segment_size;
+    encoder->cb = cb;
+    encoder->cb_arg = cb_arg;
+    encoder->fragment_stride = (buffer_size + EC_STREAM_ALIGN - 1) &
+                               ~(EC_STREAM_ALIGN - 1);
+
+    for (i = 0; i < EC_STREAM_STRIPES; i++) {
+        encoder->stripes[i] = get_aligned_buffer_uninit(
+                encoder->fragment_stride * (encoder->k + encoder->m),
+                EC_STREAM_ALIGN);
+        if (NULL == encoder->stripes[i]) {
+            goto error;
+        }
+    }
+
+    encoder->staging = get_aligned_buffer_uninit(segment_size,
+                                                 EC_STREAM_ALIGN);
+    if (NULL == encoder->staging) {
+        goto error;
+    }
+
+    liberasurecode_backend_instance_put(instance);
+    return encoder;
+
+error:
+    log_error("Could not create streaming encoder!");
+    ec_stream_encoder_destroy(encoder);
+    liberasurecode_backend_instance_put(instance);
+    return NULL;
+}
+
+void ec_stream_encoder_destroy(struct ec_stream_encoder *encoder)
+{
+    int i;
+
+    if (NULL == encoder) {
+        return;
+    }
+    for (i = 0; i < EC_STREAM_STRIPES; i++) {
+        free(encoder->stripes[i]);
+    }
+    free(encoder->staging);
+    free(encoder);
+}
+
+/*
+ * Encode one segment into the next stripe buffer and hand it to the
+ * callback.  The other stripe is left alone, the caller may still be
+ * using it.
+ */
+static int ec_stream_encode_segment(struct ec_stream_encoder *encoder,
+        const char *data, uint64_t size)
+{
+    int i, k = encoder->k, m = encoder->m;
+    int ret = 0;
+    int blocksize = 0;
+    char *encoded_data[EC_MAX_FRAGMENTS];
+    char *encoded_parity[EC_MAX_FRAGMENTS];
+    char *fragment = encoder->stripes[encoder->next_stripe];
+    uint64_t fragment_len;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(encoder->desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    for (i = 0; i < k + m; i++) {
+        if (i < k) {
+            encoded_data[i] = fragment;
+        } else {
+            encoded_parity[i - k] = fragment;
+        }
+        fragment += encoder->fragment_stride;
+    }
+
+    ret = prepare_fragments_for_encode_into(instance, k, m, data, size,
+                                            encoded_data, encoded_parity,
+                                            &blocksize);
+    if (ret < 0) {
+        goto out;
+    }
+
+    ret = instance_backend_encode(instance, encoded_data, encoded_parity,
+                                  blocksize);
+    if (ret < 0) {
+        goto out;
+    }
+
+    ret = finalize_fragments_after_encode(instance, k, m, blocksize, size,
+                                          encoded_data, encoded_parity);
+    if (ret < 0) {
+        goto out;
+    }
+    fragment_len = get_fragment_size(encoded_data[0]);
+
+    /* Done with the backend, do not hold the instance over the callback */
+    liberasurecode_backend_instance_put(instance);
+    instance = NULL;
+
+    ret = encoder->cb(encoder->cb_arg, encoder->segment_idx,
+                      encoded_data, encoded_parity, fragment_len);
+    encoder->next_stripe = (encoder->next_stripe + 1) % EC_STREAM_STRIPES;
+    encoder->segment_idx++;
+
+out:
+    if (ret < 0) {
+        log_error("Error in streaming encode of segment %lu: %d",
+                  (unsigned long) encoder->segment_idx, ret);
+    }
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+int ec_stream_encoder_feed(struct ec_stream_encoder *encoder,
+        const char *data, uint64_t len)
+{
+    int ret = 0;
+
+    if (NULL == encoder || (NULL == data && len > 0)) {
+        log_error("Invalid streaming encoder feed parameters!");
+        return -EINVALIDPARAMS;
+    }
+
+    while (len > 0) {
+        uint64_t n;
+
+        /* Whole segments go straight from the caller's buffer */
+        if (0 == encoder->staged && len >= encoder->segment_size) {
+            ret = ec_stream_encode_segment(encoder, data,
+                                           encoder->segment_size);
+            if (ret < 0) {
+                return ret;
+            }
+            data += encoder->segment_size;
+            len -= encoder->segment_size;
+            continue;
+        }
+
+        n = encoder->segment_size - encoder->staged;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(encoder->staging + encoder->staged, data, n);
+        encoder->staged += n;
+        data += n;
+        len -= n;
+
+        if (encoder->staged == encoder->segment_size) {
+            encoder->staged = 0;
+            ret = ec_stream_encode_segment(encoder, encoder->staging,
+                                           encoder->segment_size);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int ec_stream_encoder_flush(struct ec_stream_encoder *encoder)
+{
+    uint64_t staged;
+
+    if (NULL == encoder) {
+        return -EINVALIDPARAMS;
+    }
+    if (0 == encoder->staged) {
+        return 0;
+    }
+
+    staged = encoder->staged;
+    encoder->staged = 0;
+    return ec_stream_encode_segment(encoder, encoder->staging, staged);
+}
+
+/* =~=*=~==~=*=~==~=*=~==~=*= Streaming decoder =*=~==~=*=~==~=*=~==~=*=~== */
+
+struct ec_stream_decoder {
+    int desc;
+    int k, m;
+    uint64_t segment_size;
+
+    /* Output ring, ring_size buffers of segment_size bytes */
+    char **ring;
+    int ring_size;
+    int next_slot;
+
+    /* Rebuilt or realigned fragments by index, allocated on first use */
+    char *scratch[EC_MAX_FRAGMENTS];
+    uint64_t fragment_stride;
+    int scratch_align;
+    int scratch_offset;                     /* of the fragment in scratch */
+
+    /*
+     * Decode pattern of the previous segment: which fragment indexes came
+     * in, in which order, and what that leaves missing
+     */
+    int num_cached;
+    int cached_idx[EC_MAX_FRAGMENTS];
+    int pos[EC_MAX_FRAGMENTS];              /* index -> position, or -1 */
+    int missing_idxs[EC_MAX_FRAGMENTS + 1];
+    int num_missing;
+    int num_missing_data;
+
+    /* Backend decode plan for missing_idxs, NULL if there is none */
+    void *backend_plan;
+};
+
+struct ec_stream_decoder *ec_stream_decoder_create(int desc,
+        uint64_t segment_size, int ring_size)
+{
+    struct ec_stream_decoder *decoder = NULL;
+    ec_backend_t instance = NULL;
+    int buffer_size, align;
+    int i;
+
+    if (0 == segment_size || segment_size > INT_MAX || ring_size < 1) {
+        log_error("Invalid streaming decoder parameters!");
+        return NULL;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return NULL;
+    }
+
+    buffer_size = liberasurecode_get_fragment_buffer_size(desc, segment_size);
+    if (buffer_size < 0) {
+        goto error;
+    }
+
+    decoder = alloc_zeroed_buffer(sizeof(*decoder));
+    if (NULL == decoder) {
+        goto error;
+    }
+    decoder->desc = desc;
+    decoder->k = instance->args.uargs.k;
+    decoder->m = instance->args.uargs.m;
+    decoder->segment_size = segment_size;
+    decoder->fragment_stride = (buffer_size + EC_STREAM_ALIGN - 1) &
+                               ~(EC_STREAM_ALIGN - 1);
+    decoder->num_cached = -1;
+    decoder->missing_idxs[0] = -1;
+
+    /* scratch fragment payloads go on the instance payload alignment */
+    align = instance_payload_align(instance);
+    decoder->scratch_align = align > EC_STREAM_ALIGN ? align : EC_STREAM_ALIGN;
+    decoder->scratch_offset = (align - sizeof(fragment_header_t) % align) %
+                              align;
+
+    decoder->ring = alloc_zeroed_buffer(sizeof(char *) * ring_size);
+    if (NULL == decoder->ring) {
+        goto error;
+    }
+    decoder->ring_size = ring_size;
+    for (i = 0; i < ring_size; i++) {
+        decoder->ring[i] = get_aligned_buffer_uninit(segment_size,
+                                                     EC_STREAM_ALIGN);
+        if (NULL == decoder->ring[i]) {
+            goto error;
+        }
+    }
+
+    liberasurecode_backend_instance_put(instance);
+    return decoder;
+
+error:
+    log_error("Could not create streaming decoder!");
+    ec_stream_decoder_destroy(decoder);
+    liberasurecode_backend_instance_put(instance);
+    return NULL;
+}
+
+/* Drop the backend decode plan of the previous missing pattern */
+static void ec_stream_decoder_drop_plan(struct ec_stream_decoder *decoder,
+        ec_backend_t instance)
+{
+    if (NULL != decoder->backend_plan) {
+        instance->common.ops->plan_destroy(instance->desc.backend_desc,
+                                           decoder->backend_plan);
+        decoder->backend_plan = NULL;
+    }
+}
+
+void ec_stream_decoder_destroy(struct ec_stream_decoder *decoder)
+{
+    ec_backend_t instance = NULL;
+    int i;
+
+    if (NULL == decoder) {
+        return;
+    }
+    if (NULL != decoder->backend_plan) {
+        instance = liberasurecode_backend_instance_get(decoder->desc);
+        if (NULL == instance) {
+            log_error("Streaming decoder outlived its instance!");
+        } else {
+            ec_stream_decoder_drop_plan(decoder, instance);
+            liberasurecode_backend_instance_put(instance);
+        }
+    }
+    if (NULL != decoder->ring) {
+        for (i = 0; i < decoder->ring_size; i++) {
+            free(decoder->ring[i]);
+        }
+        free(decoder->ring);
+    }
+    for (i = 0; i < EC_MAX_FRAGMENTS; i++) {
+        free(decoder->scratch[i]);
+    }
+    free(decoder);
+}
+
+/*
+ * Work out the missing fragment pattern for this set of fragments, unless
+ * it carries the same indexes, in the same order, as the previous one.
+ * The backend decode plan is made again only when the missing fragments
+ * change.
+ */
+static int ec_stream_decoder_pattern(struct ec_stream_decoder *decoder,
+        ec_backend_t instance, char **fragments, int num_fragments)
+{
+    int i, n = decoder->k + decoder->m;
+    int idx[EC_MAX_FRAGMENTS];
+    uint64_t missing_bm;
+
+    if (num_fragments > n) {
+        /* duplicates can only make for a different pattern */
+        decoder->num_cached = -1;
+        num_fragments = n;
+    }
+
+    for (i = 0; i < num_fragments; i++) {
+        idx[i] = get_fragment_idx(fragments[i]);
+        if (idx[i] < 0 || idx[i] >= n) {
+            decoder->num_cached = -1;
+            return -EBADHEADER;
+        }
+    }
+
+    if (num_fragments == decoder->num_cached &&
+            0 == memcmp(idx, decoder->cached_idx, sizeof(int) * num_fragments)) {
+        return 0;
+    }
+
+    missing_bm = convert_list_to_bitmap(decoder->missing_idxs);
+    for (i = 0; i < n; i++) {
+        decoder->pos[i] = -1;
+    }
+    for (i = 0; i < num_fragments; i++) {
+        decoder->pos[idx[i]] = i;
+    }
+    decoder->num_missing = 0;
+    decoder->num_missing_data = 0;
+    for (i = 0; i < n; i++) {
+        if (decoder->pos[i] < 0) {
+            decoder->missing_idxs[decoder->num_missing++] = i;
+            if (i < decoder->k) {
+                decoder->num_missing_data++;
+            }
+        }
+    }
+    decoder->missing_idxs[decoder->num_missing] = -1;
+
+    if (NULL == decoder->backend_plan ||
+            convert_list_to_bitmap(decoder->missing_idxs) != missing_bm) {
+        ec_stream_decoder_drop_plan(decoder, instance);
+        /* only a decode needs it, and it takes k fragments */
+        if (decoder->num_missing_data > 0 &&
+                decoder->num_missing <= decoder->m &&
+                NULL != instance->common.ops->plan_create) {
+            decoder->backend_plan = instance->common.ops->plan_create(
+                    instance->desc.backend_desc, decoder->missing_idxs);
+        }
+    }
+
+    memcpy(decoder->cached_idx, idx, sizeof(int) * num_fragments);
+    decoder->num_cached = num_fragments;
+
+    return 0;
+}
+
+int ec_stream_decoder_feed(struct ec_stream_decoder *decoder,
+        char **fragments, int num_fragments, uint64_t fragment_len,
+        char **out_data, uint64_t *out_data_len)
+{
+    int i, k, m;
+    int ret = 0;
+    int orig_data_size, blocksize, align;
+    uint64_t remaining;
+    char *segments[EC_MAX_FRAGMENTS];
+    char *ref = NULL;
+    char *out;
+    ec_backend_t instance = NULL;
+
+    if (NULL == decoder || NULL == fragments ||
+            NULL == out_data || NULL == out_data_len) {
+        log_error("Invalid streaming decoder feed parameters!");
+        return -EINVALIDPARAMS;
+    }
+    k = decoder->k;
+    m = decoder->m;
+
+    if (num_fragments < k) {
+        log_error("Not enough fragments to decode, got %d, need %d!",
+                  num_fragments, k);
+        return -EINSUFFFRAGS;
+    }
+    if (fragment_len < sizeof(fragment_header_t) ||
+            fragment_len > decoder->fragment_stride) {
+        log_error("Invalid fragment length %lu for the stream segment size!",
+                  (unsigned long) fragment_len);
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(decoder->desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    out = decoder->ring[decoder->next_slot];
+
+    if (instance->common.id == EC_BACKEND_SHSS ||
+            instance->common.id == EC_BACKEND_LIBPHAZR) {
+        /* data fragments do not hold the plaintext, always decode */
+        ret = liberasurecode_decode_into(decoder->desc, fragments,
+                                         num_fragments, fragment_len, 0,
+                                         out, decoder->segment_size,
+                                         out_data_len);
+        goto done;
+    }
+
+    for (i = 0; i < num_fragments; i++) {
+        if (is_invalid_fragment_header(
+                (fragment_header_t *) fragments[i])) {
+            log_error("Invalid fragment header information!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+    }
+
+    ret = ec_stream_decoder_pattern(decoder, instance, fragments,
+                                    num_fragments);
+    if (ret < 0) {
+        goto out;
+    }
+    if (k + m - decoder->num_missing < k) {
+        log_error("Not enough fragments to decode the stream segment!");
+        ret = -EINSUFFFRAGS;
+        goto out;
+    }
+
+    for (i = 0; i < k + m && NULL == ref; i++) {
+        if (decoder->pos[i] >= 0) {
+            ref = fragments[decoder->pos[i]];
+        }
+    }
+    orig_data_size = get_orig_data_size(ref);
+    blocksize = get_fragment_payload_size(ref);
+    if (orig_data_size < 0 || blocksize < 0 ||
+            (uint64_t) orig_data_size > decoder->segment_size) {
+        log_error("Invalid segment size in fragment header!");
+        ret = -EBADHEADER;
+        goto out;
+    }
+
+    align = instance_payload_align(instance);
+    for (i = 0; i < k + m; i++) {
+        char *fragment = NULL;
+
+        if (decoder->pos[i] >= 0) {
+            fragment = fragments[decoder->pos[i]];
+        }
+        if (decoder->num_missing_data > 0 &&
+                (NULL == fragment ||
+                 (!is_addr_aligned((unsigned long)
+                        get_data_ptr_from_fragment(fragment), align) &&
+                  !keep_unaligned_fragment(instance, fragment_len)))) {
+            /* rebuilt here, or copied to satisfy the backend alignment */
+            if (NULL == decoder->scratch[i]) {
+                decoder->scratch[i] = get_aligned_buffer_uninit(
+                        decoder->scratch_offset + decoder->fragment_stride,
+                        decoder->scratch_align);
+                if (NULL == decoder->scratch[i]) {
+                    ret = -ENOMEM;
+                    goto out;
+                }
+            }
+            if (NULL == fragment) {
+                /* some backends accumulate into the missing payloads */
+                memset(decoder->scratch[i] + decoder->scratch_offset, 0,
+                       fragment_len);
+            } else {
+                memcpy(decoder->scratch[i] + decoder->scratch_offset,
+                       fragment, fragment_len);
+            }
+            fragment = decoder->scratch[i] + decoder->scratch_offset;
+        }
+        segments[i] = fragment ? get_data_ptr_from_fragment(fragment) : NULL;
+    }
+
+    if (decoder->num_missing_data > 0) {
+        ret = instance_backend_decode_plan(instance, decoder->backend_plan,
+                                           segments, segments + k,
+                                           decoder->missing_idxs,
+                                           blocksize);
+        if (ret < 0) {
+            log_error("Encountered error in backend decode function!");
+            goto out;
+        }
+    }
+
+    /* Concatenate the data payloads, trimmed to the original size */
+    remaining = orig_data_size;
+    for (i = 0; i < k && remaining > 0; i++) {
+        uint64_t len = remaining < (uint64_t) blocksize ? remaining : blocksize;
+
+        memcpy(out + (orig_data_size - remaining), segments[i], len);
+        remaining -= len;
+    }
+    *out_data_len = orig_data_size;
+
+done:
+    if (0 == ret) {
+        *out_data = out;
+        decoder->next_slot = (decoder->next_slot + 1) % decoder->ring_size;
+    }
+
+out:
+    if (ret < 0) {
+        log_error("Error in streaming decode: %d", ret);
+    }
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
@@ -0,0 +1,217 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode worker thread pool implementation
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#include "erasurecode_log.h"
+#include "erasurecode_stdinc.h"
+#include "erasurecode_threadpool.h"
+
+/* A parallel for in progress, lives on the submitter's stack */
+struct ec_thread_job {
+    ec_thread_task_fn fn;
+    void *arg;
+    int ntasks;
+    int next;                       /* next task to hand out */
+    int done;                       /* tasks finished */
+    struct ec_thread_job *next_job; /* queue link, while tasks remain */
+};
+
+struct ec_thread_pool {
+    mutex_t lock;
+    cond_t work;                    /* signalled when jobs are queued */
+    cond_t done;                    /* signalled when a job completes */
+    struct ec_thread_job *jobs;     /* jobs with tasks left to hand out */
+    int shutdown;
+
+    int num_threads;
+    pthread_t *threads;
+};
+
+/* Unlink a job whose tasks have all been handed out, lock held */
+static void ec_thread_pool_dequeue(struct ec_thread_pool *pool,
+        struct ec_thread_job *job)
+{
+    struct ec_thread_job **link = &pool->jobs;
+
+    while (*link != NULL && *link != job) {
+        link = &(*link)->next_job;
+    }
+    if (*link == job) {
+        *link = job->next_job;
+    }
+}
+
+/*
+ * Run one task of the job, lock held on entry and on return.  Returns
+ * false if the job had no task left to hand out.
+ */
+static bool ec_thread_pool_run_one(struct ec_thread_pool *pool,
+        struct ec_thread_job *job)
+{
+    int task;
+
+    if (job->next >= job->ntasks) {
+        return false;
+    }
+    task = job->next++;
+    if (job->next == job->ntasks) {
+        ec_thread_pool_dequeue(pool, job);
+    }
+
+    mutex_unlock(&pool->lock);
+    job->fn(job->arg, task);
+    mutex_lock(&pool->lock);
+
+    if (++job->done == job->ntasks) {
+        cond_broadcast(&pool->done);
+    }
+    return true;
+}
+
+static void *ec_thread_pool_worker(void *arg)
+{
+    struct ec_thread_pool *pool = arg;
+
+    mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && NULL == pool->jobs) {
+            cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        ec_thread_pool_run_one(pool, pool->jobs);
+    }
+    mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+struct ec_thread_pool *ec_thread_pool_create(int num_threads)
+{
+    struct ec_thread_pool *pool;
+    int i;
+
+    if (num_threads <= 0) {
+        return NULL;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    if (NULL == pool) {
+        return NULL;
+    }
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    if (NULL == pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    mutex_init(&pool->lock);
+    cond_init(&pool->work);
+    cond_init(&pool->done);
+
+    for (i = 0; i < num_threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL,
+                           ec_thread_pool_worker, pool) != 0) {
+            log_error("Could not start worker thread %d!", i);
+            break;
+        }
+        pool->num_threads++;
+    }
+    if (pool->num_threads != num_threads) {
+        ec_thread_pool_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void ec_thread_pool_destroy(struct ec_thread_pool *pool)
+{
+    int i;
+
+    if (NULL == pool) {
+        return;
+    }
+
+    mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    cond_broadcast(&pool->work);
+    mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    cond_destroy(&pool->work);
+    cond_destroy(&pool->done);
+    mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+int ec_thread_pool_size(struct ec_thread_pool *pool)
+{
+    return pool ? pool->num_threads : 0;
+}
+
+void ec_thread_pool_run(struct ec_thread_pool *pool, int ntasks,
+        ec_thread_task_fn fn, void *arg)
+{
+    struct ec_thread_job job = {
+        .fn = fn,
+        .arg = arg,
+        .ntasks = ntasks,
+    };
+    struct ec_thread_job **link;
+    int i;
+
+    if (ntasks <= 0) {
+        return;
+    }
+    if (NULL == pool || ntasks == 1) {
+        for (i = 0; i < ntasks; i++) {
+            fn(arg, i);
+        }
+        return;
+    }
+
+    mutex_lock(&pool->lock);
+    for (link = &pool->jobs; *link != NULL; link = &(*link)->next_job) {
+        ;
+    }
+    *link = &job;
+    cond_broadcast(&pool->work);
+
+    /* Pitch in rather than sleep, then wait for the workers' share */
+    while (ec_thread_pool_run_one(pool, &job)) {
+        ;
+    }
+    while (job.done < job.ntasks) {
+        cond_wait(&pool->done, &pool->lock);
+    }
+    mutex_unlock(&pool->lock);
+}
@@ -40,7 +40,23 @@
  * CRC32 code derived from work by Gary S. Brown.
  */
 
+#include <dlfcn.h>
+#include <pthread.h>
 #include <sys/param.h>
+#include <zlib.h>
+
+#include "erasurecode_crc.h"
+#include "erasurecode_stdinc.h"
+#include "alg_sig.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#define CRC32_HW 1
+#endif
+
+/* Probed for crc32_gzip_refl() when an ISA-L backend is in use */
+#define CRC32_ISAL_SONAME "libisal.so.2"
 
 static int crc32_tab[] = {
   0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -88,16 +104,346 @@ static int crc32_tab[] = {
   0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-int
-liberasurecode_crc32_alt(int crc, const void *buf, size_t size)
+typedef uint32_t (*crc32_func)(uint32_t crc, const unsigned char *buf,
+                               size_t size);
+typedef uint32_t (*isal_crc32_func)(uint32_t crc, const unsigned char *buf,
+                                    uint64_t size);
+
+/*
+ * Slicing-by-8 tables, slice 0 being crc32_tab above.  The "alt" tables
+ * are built with the same arithmetic right shift the original byte loop
+ * used (see liberasurecode_crc32_alt() below).
+ */
+static uint32_t crc32_slice[8][256];
+static uint32_t crc32_alt_slice[8][256];
+static uint32_t crc32_alt_fixup;
+
+static crc32_func crc32_fn;
+static const char *crc32_name;
+static isal_crc32_func crc32_isal;
+static pthread_once_t crc32_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t crc32_isal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* One step of the original algorithm on an unsigned register */
+static inline uint32_t
+crc32_alt_step(uint32_t crc, unsigned char c)
+{
+  return (uint32_t) crc32_tab[(crc ^ c) & 0xFF] ^
+         (crc >> 8) ^ ((crc & 0x80000000u) ? 0xFF000000u : 0);
+}
+
+static inline uint32_t
+crc32_load32(const unsigned char *p)
+{
+  return (uint32_t) p[0] | (uint32_t) p[1] << 8 |
+         (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+/* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
+
+static uint32_t
+crc32_sw(uint32_t crc, const unsigned char *buf, size_t size)
+{
+  uint32_t lo, hi;
+
+  crc = ~crc;
+
+  while (size >= 8) {
+    lo = crc ^ crc32_load32(buf);
+    hi = crc32_load32(buf + 4);
+    crc = crc32_slice[7][lo & 0xFF] ^
+          crc32_slice[6][(lo >> 8) & 0xFF] ^
+          crc32_slice[5][(lo >> 16) & 0xFF] ^
+          crc32_slice[4][lo >> 24] ^
+          crc32_slice[3][hi & 0xFF] ^
+          crc32_slice[2][(hi >> 8) & 0xFF] ^
+          crc32_slice[1][(hi >> 16) & 0xFF] ^
+          crc32_slice[0][hi >> 24];
+    buf += 8;
+    size -= 8;
+  }
+
+  while (size--)
+    crc = crc32_slice[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+
+  return ~crc;
+}
+
+/*
+ * The sign extending shift is still linear, so the alt CRC slices the
+ * same way as the real one.  The only twist is the top register byte:
+ * bits it sheds while being shifted out no longer vanish when its top
+ * bit is set, and that leftover is a single constant folded in per word.
+ */
+static uint32_t
+crc32_alt_sw(uint32_t crc, const unsigned char *buf, size_t size)
 {
-  const char *p;
+  uint32_t lo, hi, fixup;
 
-  p = buf;
-  crc = crc ^ ~0U;
+  crc = ~crc;
+
+  while (size >= 8) {
+    fixup = (crc & 0x80000000u) ? crc32_alt_fixup : 0;
+    lo = crc ^ crc32_load32(buf);
+    hi = crc32_load32(buf + 4);
+    crc = crc32_alt_slice[7][lo & 0xFF] ^
+          crc32_alt_slice[6][(lo >> 8) & 0xFF] ^
+          crc32_alt_slice[5][(lo >> 16) & 0xFF] ^
+          crc32_alt_slice[4][lo >> 24] ^
+          crc32_alt_slice[3][hi & 0xFF] ^
+          crc32_alt_slice[2][(hi >> 8) & 0xFF] ^
+          crc32_alt_slice[1][(hi >> 16) & 0xFF] ^
+          crc32_alt_slice[0][hi >> 24] ^ fixup;
+    buf += 8;
+    size -= 8;
+  }
 
   while (size--)
-    crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    crc = crc32_alt_step(crc, *buf++);
+
+  return ~crc;
+}
+
+#ifdef CRC32_HW
+
+/*
+ * Folding with carry-less multiplies, after Gopal et al., "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+ * Takes and returns the raw (non-inverted) register; size must be a
+ * multiple of 16 and at least 64.
+ */
+__attribute__((target("sse4.1,pclmul")))
+static uint32_t
+crc32_fold(uint32_t crc, const unsigned char *buf, size_t size)
+{
+  static const uint64_t k1k2[2] __attribute__((aligned(16))) =
+      { 0x0154442bd4, 0x01c6e41596 };
+  static const uint64_t k3k4[2] __attribute__((aligned(16))) =
+      { 0x01751997d0, 0x00ccaa009e };
+  static const uint64_t k5k0[2] __attribute__((aligned(16))) =
+      { 0x0163cd6124, 0x0000000000 };
+  static const uint64_t poly[2] __attribute__((aligned(16))) =
+      { 0x01db710641, 0x01f7011641 };
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_loadu_si128((const __m128i *) (buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *) (buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *) (buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *) (buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+  x0 = _mm_load_si128((const __m128i *) k1k2);
+  buf += 64;
+  size -= 64;
+
+  /* four lanes of 128 bits, folded forward 512 bits at a time */
+  while (size >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128((const __m128i *) (buf + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                       _mm_loadu_si128((const __m128i *) (buf + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                       _mm_loadu_si128((const __m128i *) (buf + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                       _mm_loadu_si128((const __m128i *) (buf + 0x30)));
+    buf += 64;
+    size -= 64;
+  }
+
+  /* fold the lanes into one */
+  x0 = _mm_load_si128((const __m128i *) k3k4);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  while (size >= 16) {
+    x2 = _mm_loadu_si128((const __m128i *) buf);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    buf += 16;
+    size -= 16;
+  }
+
+  /* 128 bits down to 64 */
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+  x0 = _mm_loadl_epi64((const __m128i *) k5k0);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  /* Barrett reduction to 32 bits */
+  x0 = _mm_load_si128((const __m128i *) poly);
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return (uint32_t) _mm_extract_epi32(x1, 1);
+}
+
+static uint32_t
+crc32_hw(uint32_t crc, const unsigned char *buf, size_t size)
+{
+  size_t chunk;
+
+  if (size < 64)
+    return crc32_sw(crc, buf, size);
+
+  chunk = size & ~(size_t) 15;
+  crc = ~crc32_fold(~crc, buf, chunk);
+
+  return crc32_sw(crc, buf + chunk, size - chunk);
+}
+
+#endif  // CRC32_HW
+
+static uint32_t
+crc32_isal_call(uint32_t crc, const unsigned char *buf, size_t size)
+{
+  return crc32_isal(crc, buf, size);
+}
+
+/* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
+
+static void
+crc32_init_slices(uint32_t slice[8][256], int alt)
+{
+  uint32_t n, crc;
+  int k;
+
+  for (n = 0; n < 256; n++)
+    slice[0][n] = (uint32_t) crc32_tab[n];
+
+  for (n = 0; n < 256; n++) {
+    crc = slice[0][n];
+    for (k = 1; k < 8; k++) {
+      crc = alt ? crc32_alt_step(crc, 0) :
+                  slice[0][crc & 0xFF] ^ (crc >> 8);
+      slice[k][n] = crc;
+    }
+  }
+}
+
+static void
+crc32_init(void)
+{
+  uint32_t crc;
+  int k;
+
+  crc32_init_slices(crc32_slice, 0);
+  crc32_init_slices(crc32_alt_slice, 1);
+
+  /*
+   * The slices account for the top register byte as if it were data
+   * shifted in four bytes early; the difference, given its top bit is
+   * set, is what eight real steps do to it minus what those slices do.
+   */
+  crc = 0x80000000u;
+  for (k = 0; k < 8; k++)
+    crc = crc32_alt_step(crc, 0);
+  crc32_alt_fixup = crc ^ crc32_alt_slice[4][0x80];
+
+  crc32_fn = crc32_sw;
+  crc32_name = "slicing-by-8";
+
+#ifdef CRC32_HW
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+    crc32_fn = crc32_hw;
+    crc32_name = "pclmul";
+  }
+#endif
+
+  liberasurecode_crc32_probe_isal();
+}
+
+void
+liberasurecode_crc32_probe_isal(void)
+{
+  void *handle;
+  union {
+    isal_crc32_func crcp;
+    void *vptr;
+  } func_handle = {.vptr = NULL};
+
+  pthread_mutex_lock(&crc32_isal_lock);
+  if (NULL != crc32_isal)
+    goto out;
+
+  /*
+   * Only piggyback on a copy somebody else already loaded.  The reference
+   * taken here is never dropped, so the symbol stays valid after the
+   * backend that loaded it dlclose()s its own handle.
+   */
+  handle = dlopen(CRC32_ISAL_SONAME, RTLD_LAZY | RTLD_LOCAL | RTLD_NOLOAD);
+  if (NULL == handle)
+    goto out;
+
+  func_handle.vptr = dlsym(handle, "crc32_gzip_refl");
+  if (NULL == func_handle.vptr) {
+    dlclose(handle);
+    goto out;
+  }
+
+  crc32_isal = func_handle.crcp;
+  __atomic_store_n(&crc32_name, "isa-l", __ATOMIC_RELEASE);
+  __atomic_store_n(&crc32_fn, crc32_isal_call, __ATOMIC_RELEASE);
+
+out:
+  pthread_mutex_unlock(&crc32_isal_lock);
+}
+
+uint32_t
+liberasurecode_crc32(uint32_t crc, const void *buf, size_t size)
+{
+  pthread_once(&crc32_once, crc32_init);
+
+  return __atomic_load_n(&crc32_fn, __ATOMIC_ACQUIRE)(crc,
+      (const unsigned char *) buf, size);
+}
+
+uint32_t
+liberasurecode_crc32_combine(uint32_t crc1, uint32_t crc2, size_t size2)
+{
+  return crc32_combine(crc1, crc2, (z_off_t) size2);
+}
+
+const char *
+liberasurecode_crc32_impl(void)
+{
+  pthread_once(&crc32_once, crc32_init);
+
+  return __atomic_load_n(&crc32_name, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Kept bit for bit compatible with the original byte loop, which used a
+ * signed register and hence an arithmetic shift; see
+ * https://bugs.launchpad.net/liberasurecode/+bug/1666320
+ */
+int
+liberasurecode_crc32_alt(int crc, const void *buf, size_t size)
+{
+  pthread_once(&crc32_once, crc32_init);
 
-  return crc ^ ~0U;
+  return (int) crc32_alt_sw((uint32_t) crc, (const unsigned char *) buf, size);
 }
@@ -0,0 +1,346 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode CRC-32C
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#include <pthread.h>
+
+#include "erasurecode_crc.h"
+#include "erasurecode_stdinc.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define CRC32C_HW 1
+#endif
+
+#define CRC32C_POLY     0x82f63b78u     /* reflected */
+
+/* Block sizes of the 3-way interleaved hardware loop, powers of two */
+#define CRC32C_LONG     8192
+#define CRC32C_SHORT    256
+
+static uint32_t crc32c_table[8][256];
+static uint32_t (*crc32c_fn)(uint32_t crc, const unsigned char *buf,
+                             size_t size);
+static const char *crc32c_name;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+/* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
+
+/* Portable: eight table lookups per 64-bit word */
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *buf, size_t size)
+{
+    crc = ~crc;
+
+    while (size > 0 && ((uintptr_t) buf & 7) != 0) {
+        crc = crc32c_table[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+        size--;
+    }
+
+    while (size >= 8) {
+        uint32_t lo = crc ^ ((uint32_t) buf[0] | (uint32_t) buf[1] << 8 |
+                             (uint32_t) buf[2] << 16 | (uint32_t) buf[3] << 24);
+        uint32_t hi = (uint32_t) buf[4] | (uint32_t) buf[5] << 8 |
+                      (uint32_t) buf[6] << 16 | (uint32_t) buf[7] << 24;
+
+        crc = crc32c_table[7][lo & 0xff] ^
+              crc32c_table[6][(lo >> 8) & 0xff] ^
+              crc32c_table[5][(lo >> 16) & 0xff] ^
+              crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xff] ^
+              crc32c_table[2][(hi >> 8) & 0xff] ^
+              crc32c_table[1][(hi >> 16) & 0xff] ^
+              crc32c_table[0][hi >> 24];
+        buf += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc = crc32c_table[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+        size--;
+    }
+
+    return ~crc;
+}
+
+#ifdef CRC32C_HW
+
+/*
+ * The crc32 instruction has a latency of three cycles but a throughput of
+ * one, so three independent streams are run side by side and their CRCs
+ * combined afterwards: shifting a CRC over n zero bytes is linear, and is
+ * done with the tables below (four lookups per shift).
+ */
+static uint32_t crc32c_long[4][256];
+static uint32_t crc32c_short[4][256];
+
+static uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+
+    while (vec) {
+        if (vec & 1) {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat++;
+    }
+
+    return sum;
+}
+
+static void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+    int n;
+
+    for (n = 0; n < 32; n++) {
+        square[n] = gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+/* Operator that appends len (a power of two) zero bytes to a CRC */
+static void crc32c_zeros_op(uint32_t *even, size_t len)
+{
+    uint32_t odd[32];
+    uint32_t row = 1;
+    int n;
+
+    /* one zero bit */
+    odd[0] = CRC32C_POLY;
+    for (n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    gf2_matrix_square(even, odd);       /* two zero bits */
+    gf2_matrix_square(odd, even);       /* four zero bits */
+
+    /* square until the operator covers len bytes */
+    do {
+        gf2_matrix_square(even, odd);
+        len >>= 1;
+        if (len == 0) {
+            return;
+        }
+        gf2_matrix_square(odd, even);
+        len >>= 1;
+    } while (len);
+
+    for (n = 0; n < 32; n++) {
+        even[n] = odd[n];
+    }
+}
+
+static void crc32c_zeros(uint32_t zeros[][256], size_t len)
+{
+    uint32_t op[32];
+    uint32_t n;
+
+    crc32c_zeros_op(op, len);
+    for (n = 0; n < 256; n++) {
+        zeros[0][n] = gf2_matrix_times(op, n);
+        zeros[1][n] = gf2_matrix_times(op, n << 8);
+        zeros[2][n] = gf2_matrix_times(op, n << 16);
+        zeros[3][n] = gf2_matrix_times(op, n << 24);
+    }
+}
+
+static inline uint32_t crc32c_shift(uint32_t zeros[][256], uint32_t crc)
+{
+    return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^
+           zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *buf, size_t size)
+{
+    uint64_t crc0, crc1, crc2;
+    const unsigned char *end;
+
+    crc0 = ~crc;
+
+    while (size > 0 && ((uintptr_t) buf & 7) != 0) {
+        crc0 = _mm_crc32_u8(crc0, *buf++);
+        size--;
+    }
+
+    while (size >= CRC32C_LONG * 3) {
+        crc1 = 0;
+        crc2 = 0;
+        end = buf + CRC32C_LONG;
+        do {
+            crc0 = _mm_crc32_u64(crc0, *(const uint64_t *) buf);
+            crc1 = _mm_crc32_u64(crc1,
+                    *(const uint64_t *) (buf + CRC32C_LONG));
+            crc2 = _mm_crc32_u64(crc2,
+                    *(const uint64_t *) (buf + 2 * CRC32C_LONG));
+            buf += 8;
+        } while (buf < end);
+        crc0 = crc32c_shift(crc32c_long, crc0) ^ crc1;
+        crc0 = crc32c_shift(crc32c_long, crc0) ^ crc2;
+        buf += 2 * CRC32C_LONG;
+        size -= 3 * CRC32C_LONG;
+    }
+
+    while (size >= CRC32C_SHORT * 3) {
+        crc1 = 0;
+        crc2 = 0;
+        end = buf + CRC32C_SHORT;
+        do {
+            crc0 = _mm_crc32_u64(crc0, *(const uint64_t *) buf);
+            crc1 = _mm_crc32_u64(crc1,
+                    *(const uint64_t *) (buf + CRC32C_SHORT));
+            crc2 = _mm_crc32_u64(crc2,
+                    *(const uint64_t *) (buf + 2 * CRC32C_SHORT));
+            buf += 8;
+        } while (buf < end);
+        crc0 = crc32c_shift(crc32c_short, crc0) ^ crc1;
+        crc0 = crc32c_shift(crc32c_short, crc0) ^ crc2;
+        buf += 2 * CRC32C_SHORT;
+        size -= 3 * CRC32C_SHORT;
+    }
+
+    while (size >= 8) {
+        crc0 = _mm_crc32_u64(crc0, *(const uint64_t *) buf);
+        buf += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc0 = _mm_crc32_u8(crc0, *buf++);
+        size--;
+    }
+
+    return ~(uint32_t) crc0;
+}
+
+#endif  // CRC32C_HW
+
+/* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
+
+/*
+ * Polynomial arithmetic modulo the CRC polynomial, bit-reflected as in the
+ * register, after zlib 1.2.12: appending n zero bytes to a message
+ * multiplies its CRC by x^(8n).
+ */
+static uint32_t crc32c_x2n[32];        /* x^(2^k) mod p */
+
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+
+    return p;
+}
+
+static uint32_t crc32c_x8nmodp(size_t n)
+{
+    uint32_t p = 1u << 31;              /* x^0 */
+    int k = 3;
+
+    while (n) {
+        if (n & 1) {
+            p = crc32c_multmodp(crc32c_x2n[k & 31], p);
+        }
+        n >>= 1;
+        k++;
+    }
+
+    return p;
+}
+
+static void crc32c_init(void)
+{
+    uint32_t n, crc;
+    int k;
+
+    for (n = 0; n < 256; n++) {
+        crc = n;
+        for (k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[0][n] = crc;
+    }
+    for (n = 0; n < 256; n++) {
+        crc = crc32c_table[0][n];
+        for (k = 1; k < 8; k++) {
+            crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+            crc32c_table[k][n] = crc;
+        }
+    }
+
+    crc32c_x2n[0] = 1u << 30;           /* x^1 */
+    for (k = 1; k < 32; k++) {
+        crc32c_x2n[k] = crc32c_multmodp(crc32c_x2n[k - 1],
+                                        crc32c_x2n[k - 1]);
+    }
+
+    crc32c_fn = crc32c_sw;
+    crc32c_name = "slicing-by-8";
+
+#ifdef CRC32C_HW
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c_zeros(crc32c_long, CRC32C_LONG);
+        crc32c_zeros(crc32c_short, CRC32C_SHORT);
+        crc32c_fn = crc32c_hw;
+        crc32c_name = "sse4.2";
+    }
+#endif
+}
+
+uint32_t liberasurecode_crc32c(uint32_t crc, const void *buf, size_t size)
+{
+    pthread_once(&crc32c_once, crc32c_init);
+
+    return crc32c_fn(crc, (const unsigned char *) buf, size);
+}
+
+uint32_t liberasurecode_crc32c_combine(uint32_t crc1, uint32_t crc2,
+                                       size_t size2)
+{
+    pthread_once(&crc32c_once, crc32c_init);
+
+    return crc32c_multmodp(crc32c_x8nmodp(size2), crc1) ^ crc2;
+}
+
+const char *liberasurecode_crc32c_impl(void)
+{
+    pthread_once(&crc32c_once, crc32c_init);
+
+    return crc32c_name;
+}
@@ -0,0 +1,289 @@
+/*
+ * <Copyright>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode multi-buffer MD5
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#include <pthread.h>
+
+#include "erasurecode_crc.h"
+#include "erasurecode_stdinc.h"
+#include "md5.h"
+
+/*
+ * All fragments of a stripe have the same length, so k + m digests can be
+ * computed in lockstep, one fragment per vector lane.  MD5 itself is a
+ * long serial dependency chain; running several chains side by side is the
+ * only way to keep the vector units busy.
+ */
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MD5_MB_AVX2 1
+#endif
+
+#define MD5_MB_MAX_LANES    8
+
+typedef uint32_t md5_v4 __attribute__((vector_size(16)));
+typedef uint32_t md5_v8 __attribute__((vector_size(32)));
+
+typedef void (*md5_lanes_func)(const unsigned char **p, size_t nblocks,
+                               uint32_t state[4][MD5_MB_MAX_LANES]);
+
+static md5_lanes_func md5_lanes_fn;
+static int md5_lanes;
+static const char *md5_name;
+static pthread_once_t md5_once = PTHREAD_ONCE_INIT;
+
+/* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
+
+/* Same round functions as md5.c, applied lane-wise */
+#define F(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z)  ((y) ^ ((z) & ((x) ^ (y))))
+#define H(x, y, z)  ((x) ^ (y) ^ (z))
+#define I(x, y, z)  ((y) ^ ((x) | ~(z)))
+
+#define STEP(f, a, b, c, d, x, t, s) \
+    (a) += f((b), (c), (d)) + (x) + (t); \
+    (a) = ((a) << (s)) | ((a) >> (32 - (s))); \
+    (a) += (b);
+
+#define MD5_MB_ROUNDS(a, b, c, d, X) \
+    STEP(F, a, b, c, d, X[0], 0xd76aa478, 7) \
+    STEP(F, d, a, b, c, X[1], 0xe8c7b756, 12) \
+    STEP(F, c, d, a, b, X[2], 0x242070db, 17) \
+    STEP(F, b, c, d, a, X[3], 0xc1bdceee, 22) \
+    STEP(F, a, b, c, d, X[4], 0xf57c0faf, 7) \
+    STEP(F, d, a, b, c, X[5], 0x4787c62a, 12) \
+    STEP(F, c, d, a, b, X[6], 0xa8304613, 17) \
+    STEP(F, b, c, d, a, X[7], 0xfd469501, 22) \
+    STEP(F, a, b, c, d, X[8], 0x698098d8, 7) \
+    STEP(F, d, a, b, c, X[9], 0x8b44f7af, 12) \
+    STEP(F, c, d, a, b, X[10], 0xffff5bb1, 17) \
+    STEP(F, b, c, d, a, X[11], 0x895cd7be, 22) \
+    STEP(F, a, b, c, d, X[12], 0x6b901122, 7) \
+    STEP(F, d, a, b, c, X[13], 0xfd987193, 12) \
+    STEP(F, c, d, a, b, X[14], 0xa679438e, 17) \
+    STEP(F, b, c, d, a, X[15], 0x49b40821, 22) \
+    STEP(G, a, b, c, d, X[1], 0xf61e2562, 5) \
+    STEP(G, d, a, b, c, X[6], 0xc040b340, 9) \
+    STEP(G, c, d, a, b, X[11], 0x265e5a51, 14) \
+    STEP(G, b, c, d, a, X[0], 0xe9b6c7aa, 20) \
+    STEP(G, a, b, c, d, X[5], 0xd62f105d, 5) \
+    STEP(G, d, a, b, c, X[10], 0x02441453, 9) \
+    STEP(G, c, d, a, b, X[15], 0xd8a1e681, 14) \
+    STEP(G, b, c, d, a, X[4], 0xe7d3fbc8, 20) \
+    STEP(G, a, b, c, d, X[9], 0x21e1cde6, 5) \
+    STEP(G, d, a, b, c, X[14], 0xc33707d6, 9) \
+    STEP(G, c, d, a, b, X[3], 0xf4d50d87, 14) \
+    STEP(G, b, c, d, a, X[8], 0x455a14ed, 20) \
+    STEP(G, a, b, c, d, X[13], 0xa9e3e905, 5) \
+    STEP(G, d, a, b, c, X[2], 0xfcefa3f8, 9) \
+    STEP(G, c, d, a, b, X[7], 0x676f02d9, 14) \
+    STEP(G, b, c, d, a, X[12], 0x8d2a4c8a, 20) \
+    STEP(H, a, b, c, d, X[5], 0xfffa3942, 4) \
+    STEP(H, d, a, b, c, X[8], 0x8771f681, 11) \
+    STEP(H, c, d, a, b, X[11], 0x6d9d6122, 16) \
+    STEP(H, b, c, d, a, X[14], 0xfde5380c, 23) \
+    STEP(H, a, b, c, d, X[1], 0xa4beea44, 4) \
+    STEP(H, d, a, b, c, X[4], 0x4bdecfa9, 11) \
+    STEP(H, c, d, a, b, X[7], 0xf6bb4b60, 16) \
+    STEP(H, b, c, d, a, X[10], 0xbebfbc70, 23) \
+    STEP(H, a, b, c, d, X[13], 0x289b7ec6, 4) \
+    STEP(H, d, a, b, c, X[0], 0xeaa127fa, 11) \
+    STEP(H, c, d, a, b, X[3], 0xd4ef3085, 16) \
+    STEP(H, b, c, d, a, X[6], 0x04881d05, 23) \
+    STEP(H, a, b, c, d, X[9], 0xd9d4d039, 4) \
+    STEP(H, d, a, b, c, X[12], 0xe6db99e5, 11) \
+    STEP(H, c, d, a, b, X[15], 0x1fa27cf8, 16) \
+    STEP(H, b, c, d, a, X[2], 0xc4ac5665, 23) \
+    STEP(I, a, b, c, d, X[0], 0xf4292244, 6) \
+    STEP(I, d, a, b, c, X[7], 0x432aff97, 10) \
+    STEP(I, c, d, a, b, X[14], 0xab9423a7, 15) \
+    STEP(I, b, c, d, a, X[5], 0xfc93a039, 21) \
+    STEP(I, a, b, c, d, X[12], 0x655b59c3, 6) \
+    STEP(I, d, a, b, c, X[3], 0x8f0ccc92, 10) \
+    STEP(I, c, d, a, b, X[10], 0xffeff47d, 15) \
+    STEP(I, b, c, d, a, X[1], 0x85845dd1, 21) \
+    STEP(I, a, b, c, d, X[8], 0x6fa87e4f, 6) \
+    STEP(I, d, a, b, c, X[15], 0xfe2ce6e0, 10) \
+    STEP(I, c, d, a, b, X[6], 0xa3014314, 15) \
+    STEP(I, b, c, d, a, X[13], 0x4e0811a1, 21) \
+    STEP(I, a, b, c, d, X[4], 0xf7537e82, 6) \
+    STEP(I, d, a, b, c, X[11], 0xbd3af235, 10) \
+    STEP(I, c, d, a, b, X[2], 0x2ad7d2bb, 15) \
+    STEP(I, b, c, d, a, X[9], 0xeb86d391, 21)
+
+/*
+ * Runs nblocks 64-byte blocks through each lane, advancing the lane
+ * pointers.  The message words are gathered lane by lane; loading them
+ * costs far less than the 64 dependent steps they feed.
+ */
+#define MD5_MB_BODY(vec, lanes, p, nblocks, state) \
+    do { \
+        vec a, b, c, d, sa, sb, sc, sd, X[16]; \
+        int j, l; \
+        for (l = 0; l < (lanes); l++) { \
+            a[l] = state[0][l]; \
+            b[l] = state[1][l]; \
+            c[l] = state[2][l]; \
+            d[l] = state[3][l]; \
+        } \
+        while (nblocks--) { \
+            for (j = 0; j < 16; j++) { \
+                for (l = 0; l < (lanes); l++) { \
+                    X[j][l] = md5_load32(p[l] + 4 * j); \
+                } \
+            } \
+            sa = a; sb = b; sc = c; sd = d; \
+            MD5_MB_ROUNDS(a, b, c, d, X) \
+            a += sa; b += sb; c += sc; d += sd; \
+            for (l = 0; l < (lanes); l++) { \
+                p[l] += 64; \
+            } \
+        } \
+        for (l = 0; l < (lanes); l++) { \
+            state[0][l] = a[l]; \
+            state[1][l] = b[l]; \
+            state[2][l] = c[l]; \
+            state[3][l] = d[l]; \
+        } \
+    } while (0)
+
+static inline uint32_t md5_load32(const unsigned char *p)
+{
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 |
+           (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static void md5_x4(const unsigned char **p, size_t nblocks,
+                   uint32_t state[4][MD5_MB_MAX_LANES])
+{
+    MD5_MB_BODY(md5_v4, 4, p, nblocks, state);
+}
+
+#ifdef MD5_MB_AVX2
+__attribute__((target("avx2")))
+static void md5_x8(const unsigned char **p, size_t nblocks,
+                   uint32_t state[4][MD5_MB_MAX_LANES])
+{
+    MD5_MB_BODY(md5_v8, 8, p, nblocks, state);
+}
+#endif
+
+/* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
+
+static void md5_init(void)
+{
+    md5_lanes_fn = md5_x4;
+    md5_lanes = 4;
+    md5_name = "4-lane";
+
+#ifdef MD5_MB_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        md5_lanes_fn = md5_x8;
+        md5_lanes = 8;
+        md5_name = "avx2 8-lane";
+    }
+#endif
+}
+
+void liberasurecode_md5(const void *buf, size_t size, uint32_t digest[4])
+{
+    unsigned char result[16];
+    MD5_CTX ctx;
+    int i;
+
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, (void *) buf, size);
+    MD5_Final(result, &ctx);
+
+    for (i = 0; i < 4; i++) {
+        digest[i] = md5_load32(result + 4 * i);
+    }
+}
+
+void liberasurecode_md5_mb(const void **bufs, int nbufs, size_t size,
+                           uint32_t (*digests)[4])
+{
+    const unsigned char *p[MD5_MB_MAX_LANES];
+    unsigned char tail[MD5_MB_MAX_LANES][128];
+    uint32_t state[4][MD5_MB_MAX_LANES];
+    uint64_t bits = (uint64_t) size << 3;
+    size_t rem = size & 63;
+    size_t ntail = (rem < 56) ? 1 : 2;
+    int i, l, n;
+
+    pthread_once(&md5_once, md5_init);
+
+    if (nbufs == 1) {
+        liberasurecode_md5(bufs[0], size, digests[0]);
+        return;
+    }
+
+    for (i = 0; i < nbufs; i += md5_lanes) {
+        n = nbufs - i < md5_lanes ? nbufs - i : md5_lanes;
+
+        /* spare lanes rehash the first buffer and are ignored */
+        for (l = 0; l < md5_lanes; l++) {
+            p[l] = bufs[i + (l < n ? l : 0)];
+            state[0][l] = 0x67452301;
+            state[1][l] = 0xefcdab89;
+            state[2][l] = 0x98badcfe;
+            state[3][l] = 0x10325476;
+        }
+        md5_lanes_fn(p, size >> 6, state);
+
+        /* equal lengths, so every lane pads out the same way */
+        for (l = 0; l < md5_lanes; l++) {
+            unsigned char *t = tail[l];
+            unsigned char *len = t + ntail * 64 - 8;
+            int k;
+
+            memcpy(t, p[l], rem);
+            t[rem] = 0x80;
+            memset(t + rem + 1, 0, ntail * 64 - rem - 1);
+            for (k = 0; k < 8; k++) {
+                len[k] = (unsigned char) (bits >> (8 * k));
+            }
+            p[l] = t;
+        }
+        md5_lanes_fn(p, ntail, state);
+
+        for (l = 0; l < n; l++) {
+            digests[i + l][0] = state[0][l];
+            digests[i + l][1] = state[1][l];
+            digests[i + l][2] = state[2][l];
+            digests[i + l][3] = state[3][l];
+        }
+    }
+}
+
+const char *liberasurecode_md5_impl(void)
+{
+    pthread_once(&md5_once, md5_init);
+
+    return md5_name;
+}
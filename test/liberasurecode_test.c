@@ -27,13 +27,19 @@
  */
 
 #include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <zlib.h>
 #include "erasurecode.h"
+#include "erasurecode_async.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
 #include "erasurecode_preprocessing.h"
 #include "erasurecode_backend.h"
+#include "erasurecode_crc.h"
+#include "erasurecode_stream.h"
 #include "alg_sig.h"
 #define NULL_BACKEND "null"
 #define FLAT_XOR_HD_BACKEND "flat_xor_hd"
@@ -471,13 +477,22 @@ static void validate_fragment_checksum(struct ec_args *args,
     uint32_t chksum = metadata->chksum[0];
     uint32_t computed = 0;
     uint32_t size = metadata->size;
+    uint32_t digest[4];
     switch (args->ct) {
         case CHKSUM_MD5:
-            assert(false); //currently only have support crc32
-            break;
+            liberasurecode_md5(fragment_data, size, digest);
+            if (metadata->chksum_mismatch) {
+                assert(memcmp(metadata->chksum, digest, sizeof(digest)) != 0);
+            } else {
+                assert(memcmp(metadata->chksum, digest, sizeof(digest)) == 0);
+            }
+            return;
         case CHKSUM_CRC32:
             computed = crc32(0, (unsigned char *) fragment_data, size);
             break;
+        case CHKSUM_CRC32C:
+            computed = liberasurecode_crc32c(0, fragment_data, size);
+            break;
         case CHKSUM_NONE:
             assert(metadata->chksum_mismatch == 0);
             break;
@@ -545,6 +560,38 @@ static void test_create_backend_invalid_args()
     assert(-EINVALIDPARAMS == desc);
 }
 
+static void test_create_backend_legacy_args()
+{
+    struct ec_pool_stats stats;
+    struct ec_args args;
+    size_t legacy_size = offsetof(struct ec_args, pool_max_bytes);
+    int desc;
+
+    // Whatever follows ct is not part of a pre-1.7.0 caller's struct
+    memset(&args, 0xff, sizeof(args));
+    memcpy(&args, &null_args, legacy_size);
+
+    desc = liberasurecode_instance_create_sized(EC_BACKEND_NULL, &args,
+                                                legacy_size - 1);
+    assert(-EINVALIDPARAMS == desc);
+
+    desc = liberasurecode_instance_create_sized(EC_BACKEND_NULL, &args,
+                                                legacy_size);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+    assert(-EINVALIDPARAMS == liberasurecode_get_pool_stats(desc, &stats));
+    assert(0 == liberasurecode_instance_destroy(desc));
+
+    // The entry point older binaries link against does not look further
+    desc = (liberasurecode_instance_create)(EC_BACKEND_NULL, &args);
+    assert(desc > 0);
+    assert(-EINVALIDPARAMS == liberasurecode_get_pool_stats(desc, &stats));
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
 static void test_destroy_backend_invalid_args()
 {
     int desc = -1;
@@ -600,6 +647,23 @@ static void test_encode_invalid_args()
             &encoded_data, &encoded_parity, NULL);
     assert(rc < 0);
 
+    rc = liberasurecode_encode_iov(desc, NULL, 1,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc < 0);
+
+    {
+        struct iovec iov[2] = {
+            { .iov_base = orig_data, .iov_len = orig_data_size },
+            { .iov_base = NULL, .iov_len = 1 },
+        };
+        rc = liberasurecode_encode_iov(desc, iov, 0,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(rc < 0);
+        rc = liberasurecode_encode_iov(desc, iov, 2,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(rc < 0);
+    }
+
     instance = liberasurecode_backend_instance_get_by_desc(desc);
     orig_encode_func = instance->common.ops->encode;
     instance->common.ops->encode = encode_failure_stub;
@@ -612,6 +676,85 @@ static void test_encode_invalid_args()
     free(orig_data);
 }
 
+static void test_encode_into_invalid_args()
+{
+    int i, rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024;
+    char *orig_data = create_buffer(orig_data_size, 'x');
+    char *encoded_data[EC_MAX_FRAGMENTS], *encoded_parity[EC_MAX_FRAGMENTS];
+    uint64_t encoded_fragment_len = 0;
+    int buffer_size = 0;
+
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            encoded_data, encoded_parity, 0, &encoded_fragment_len);
+    assert(rc < 0);
+    assert(liberasurecode_get_fragment_buffer_size(desc, orig_data_size) < 0);
+
+    desc = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    buffer_size = liberasurecode_get_fragment_buffer_size(desc, orig_data_size);
+    assert(buffer_size > (int) sizeof(fragment_header_t));
+    assert(buffer_size == liberasurecode_get_fragment_size(desc,
+                orig_data_size) + (int) sizeof(fragment_header_t));
+    for (i = 0; i < null_args.k; i++) {
+        assert(0 == posix_memalign((void **) &encoded_data[i], 16, buffer_size));
+    }
+    for (i = 0; i < null_args.m; i++) {
+        assert(0 == posix_memalign((void **) &encoded_parity[i], 16, buffer_size));
+    }
+
+    rc = liberasurecode_encode_into(desc, NULL, orig_data_size,
+            encoded_data, encoded_parity, buffer_size, &encoded_fragment_len);
+    assert(rc < 0);
+
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            NULL, encoded_parity, buffer_size, &encoded_fragment_len);
+    assert(rc < 0);
+
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            encoded_data, NULL, buffer_size, &encoded_fragment_len);
+    assert(rc < 0);
+
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            encoded_data, encoded_parity, buffer_size, NULL);
+    assert(rc < 0);
+
+    /* buffers too small */
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            encoded_data, encoded_parity, buffer_size - 1,
+            &encoded_fragment_len);
+    assert(rc == -EINVALIDPARAMS);
+
+    /* unaligned buffer */
+    encoded_parity[0] += 1;
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            encoded_data, encoded_parity, buffer_size,
+            &encoded_fragment_len);
+    assert(rc == -EINVALIDPARAMS);
+    encoded_parity[0] -= 1;
+
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            encoded_data, encoded_parity, buffer_size, &encoded_fragment_len);
+    assert(rc == 0);
+    assert(encoded_fragment_len == (uint64_t) buffer_size);
+
+    for (i = 0; i < null_args.k; i++) {
+        free(encoded_data[i]);
+    }
+    for (i = 0; i < null_args.m; i++) {
+        free(encoded_parity[i]);
+    }
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
 static void test_encode_cleanup_invalid_args()
 {
     int rc = 0;
@@ -766,6 +909,140 @@ static void test_decode_cleanup_invalid_args()
     free(orig_data);
 }
 
+static void test_get_pool_stats_invalid_args()
+{
+    int desc = -1;
+    struct ec_args pool_args = null_args;
+    struct ec_pool_stats stats;
+
+    assert(liberasurecode_get_pool_stats(-1, &stats) == -EBACKENDNOTAVAIL);
+
+    desc = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+    /* no pool configured */
+    assert(liberasurecode_get_pool_stats(desc, &stats) == -EINVALIDPARAMS);
+    liberasurecode_instance_destroy(desc);
+
+    pool_args.pool_max_bytes = 1024 * 1024;
+    desc = liberasurecode_instance_create(EC_BACKEND_NULL, &pool_args);
+    assert(desc > 0);
+    assert(liberasurecode_get_pool_stats(desc, NULL) == -EINVALIDPARAMS);
+    assert(liberasurecode_get_pool_stats(desc, &stats) == 0);
+    assert(stats.max_bytes == pool_args.pool_max_bytes);
+    assert(stats.cached_buffers == 0 && stats.in_use_buffers == 0);
+    liberasurecode_instance_destroy(desc);
+}
+
+static void test_instance_descriptors()
+{
+    int i, j;
+    int num_descs = 300;
+    int *descs = malloc(sizeof(int) * num_descs);
+    int stale_desc;
+
+    assert(descs != NULL);
+    for (i = 0; i < num_descs; i++) {
+        descs[i] = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+        if (-EBACKENDNOTAVAIL == descs[i]) {
+            fprintf(stderr, "Backend library not available!\n");
+            for (j = 0; j < i; j++) {
+                liberasurecode_instance_destroy(descs[j]);
+            }
+            free(descs);
+            return;
+        }
+        assert(descs[i] > 0);
+        for (j = 0; j < i; j++) {
+            assert(descs[i] != descs[j]);
+        }
+        assert(liberasurecode_backend_instance_get_by_desc(descs[i]) != NULL);
+    }
+
+    /* a destroyed descriptor stays invalid once its slot is reused */
+    stale_desc = descs[0];
+    assert(0 == liberasurecode_instance_destroy(stale_desc));
+    assert(-EBACKENDNOTAVAIL == liberasurecode_instance_destroy(stale_desc));
+    descs[0] = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+    assert(descs[0] > 0 && descs[0] != stale_desc);
+    assert(liberasurecode_backend_instance_get_by_desc(stale_desc) == NULL);
+    assert(liberasurecode_get_fragment_size(stale_desc, 1024) ==
+           -EBACKENDNOTAVAIL);
+
+    for (i = 0; i < num_descs; i++) {
+        assert(0 == liberasurecode_instance_destroy(descs[i]));
+    }
+    free(descs);
+}
+
+struct destroy_race_args {
+    int desc;
+    int ok;         /* encodes that went through */
+};
+
+static void *destroy_race_encoder(void *arg)
+{
+    struct destroy_race_args *race = arg;
+    int orig_data_size = 64 * 1024;
+    char *orig_data = create_buffer(orig_data_size, 'x');
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    int i, rc;
+
+    assert(orig_data != NULL);
+    for (;;) {
+        rc = liberasurecode_encode(race->desc, orig_data, orig_data_size,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        if (rc == -EBACKENDNOTAVAIL) {
+            break;
+        }
+        assert(rc == 0);
+        rc = liberasurecode_encode_cleanup(race->desc, encoded_data,
+                                           encoded_parity);
+        if (rc == -EBACKENDNOTAVAIL) {
+            /* destroyed between encode and cleanup; no pool, so free() */
+            for (i = 0; i < null_args.k; i++) {
+                free(encoded_data[i]);
+            }
+            for (i = 0; i < null_args.m; i++) {
+                free(encoded_parity[i]);
+            }
+            free(encoded_data);
+            free(encoded_parity);
+            break;
+        }
+        assert(rc == 0);
+        __atomic_add_fetch(&race->ok, 1, __ATOMIC_RELAXED);
+    }
+    free(orig_data);
+
+    return NULL;
+}
+
+static void test_destroy_while_encoding()
+{
+    struct destroy_race_args race = { 0 };
+    pthread_t tid;
+
+    race.desc = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+    if (-EBACKENDNOTAVAIL == race.desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(race.desc > 0);
+
+    assert(0 == pthread_create(&tid, NULL, destroy_race_encoder, &race));
+    while (__atomic_load_n(&race.ok, __ATOMIC_RELAXED) < 10) {
+        sched_yield();
+    }
+    /* waits for the in-flight encode, then fails every later call */
+    assert(0 == liberasurecode_instance_destroy(race.desc));
+    assert(0 == pthread_join(tid, NULL));
+}
+
 static void test_reconstruct_fragment_invalid_args()
 {
     int rc = -1;
@@ -899,6 +1176,44 @@ static void test_verify_stripe_metadata_invalid_args() {
     free(frags);
 }
 
+static void test_verify_stripe_payloads_invalid_args() {
+    int rc = -1;
+    int num_frags = 6;
+    int desc = -1;
+    uint64_t bad = 0;
+    char **frags = calloc(num_frags, sizeof(char *));
+
+    rc = liberasurecode_verify_stripe_payloads(desc, frags, num_frags, &bad);
+    assert(rc == -EINVALIDPARAMS);
+
+    desc = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        free(frags);
+        return;
+    }
+    assert(desc > 0);
+
+    rc = liberasurecode_verify_stripe_payloads(desc, NULL, num_frags, &bad);
+    assert(rc == -EINVALIDPARAMS);
+
+    rc = liberasurecode_verify_stripe_payloads(desc, frags, num_frags, NULL);
+    assert(rc == -EINVALIDPARAMS);
+
+    rc = liberasurecode_verify_stripe_payloads(desc, frags, 0, &bad);
+    assert(rc == -EINVALIDPARAMS);
+
+    rc = liberasurecode_verify_stripe_payloads(desc, frags, 65, &bad);
+    assert(rc == -EINVALIDPARAMS);
+
+    /* missing fragments are reported, not an error */
+    rc = liberasurecode_verify_stripe_payloads(desc, frags, num_frags, &bad);
+    assert(rc == 0);
+    assert(bad == (1ULL << num_frags) - 1);
+    liberasurecode_instance_destroy(desc);
+    free(frags);
+}
+
 static void test_get_fragment_partition()
 {
     int i;
@@ -1567,109 +1882,1919 @@ static void test_simple_encode_decode(const ec_backend_id_t be_id,
     free(skip);
 }
 
-static void test_jerasure_rs_vand_simple_encode_decode_over32()
-{
-    struct ec_args over32_args = {
-        .k = 30,
-        .m = 20,
-    };
-
-    int *skip = create_skips_array(&over32_args, 1);
-    assert(skip != NULL);
-    // should return an error
-    encode_decode_test_impl(EC_BACKEND_JERASURE_RS_VAND,
-                            &over32_args, skip);
-    free(skip);
-}
-
-static void test_simple_reconstruct(const ec_backend_id_t be_id,
-                                    struct ec_args *args)
-{
-    int i = 0;
-    for (i = 0; i < args->k + args->m; i++) {
-        int *skip = create_skips_array(args,i);
-        assert(skip != NULL);
-        reconstruct_test_impl(be_id, args, skip);
-        free(skip);
-    }
-}
-
-static void test_fragments_needed(const ec_backend_id_t be_id,
-                                  struct ec_args *args)
-{
-    test_fragments_needed_impl(be_id, args);
-}
-
-static void test_verify_stripe_metadata(const ec_backend_id_t be_id,
-                                        struct ec_args *args)
+static void test_encode_into(const ec_backend_id_t be_id,
+                             struct ec_args *args)
 {
-    int orig_data_size = 1024;
+    int i, rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 3;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
     char **encoded_data = NULL, **encoded_parity = NULL;
-    char **avail_frags = NULL;
-    uint64_t encoded_fragment_len = 0;
-    int rc = -1;
-    int num_avail_frags = -1;
-    int *skip = create_skips_array(args,-1);
-    char *orig_data = create_buffer(orig_data_size, 'x');
-    int desc = liberasurecode_instance_create(be_id, args);
+    char *data_bufs[EC_MAX_FRAGMENTS], *parity_bufs[EC_MAX_FRAGMENTS];
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t encoded_fragment_len = 0, into_fragment_len = 0;
+    uint64_t decoded_data_len = 0;
+    char *decoded_data = NULL;
+    int buffer_size = 0;
 
+    desc = liberasurecode_instance_create(be_id, args);
     if (-EBACKENDNOTAVAIL == desc) {
         fprintf(stderr, "Backend library not available!\n");
-        free(orig_data);
-        free(skip);
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
         return;
     }
     assert(desc > 0);
 
+    orig_data = create_buffer(orig_data_size, 'x');
     assert(orig_data != NULL);
     rc = liberasurecode_encode(desc, orig_data, orig_data_size,
             &encoded_data, &encoded_parity, &encoded_fragment_len);
     assert(0 == rc);
 
-    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
-            encoded_parity, args, skip);
+    buffer_size = liberasurecode_get_fragment_buffer_size(desc, orig_data_size);
+    assert(buffer_size == (int) encoded_fragment_len);
 
-    rc = liberasurecode_verify_stripe_metadata(desc, avail_frags,
-            num_avail_frags);
+    /* dirty caller buffers must not leak into the fragments */
+    for (i = 0; i < num_fragments; i++) {
+        char *buf = NULL;
+        assert(0 == posix_memalign((void **) &buf, 16, buffer_size));
+        memset(buf, 0xa5, buffer_size);
+        if (i < args->k) {
+            data_bufs[i] = buf;
+        } else {
+            parity_bufs[i - args->k] = buf;
+        }
+        frags[i] = buf;
+    }
+
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            data_bufs, parity_bufs, buffer_size, &into_fragment_len);
+    assert(0 == rc);
+    assert(into_fragment_len == encoded_fragment_len);
+
+    /* shss & libphazr fragments are not deterministic */
+    if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+        for (i = 0; i < args->k; i++) {
+            assert(memcmp(data_bufs[i], encoded_data[i],
+                          encoded_fragment_len) == 0);
+        }
+        for (i = 0; i < args->m; i++) {
+            assert(memcmp(parity_bufs[i], encoded_parity[i],
+                          encoded_fragment_len) == 0);
+        }
+    }
+
+    /* drop the first data fragment to exercise parity as well */
+    rc = liberasurecode_decode(desc, frags + 1, num_fragments - 1,
+                               into_fragment_len, 1,
+                               &decoded_data, &decoded_data_len);
     assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
 
+    liberasurecode_decode_cleanup(desc, decoded_data);
     liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
-    liberasurecode_instance_destroy(desc);
+    for (i = 0; i < num_fragments; i++) {
+        free(frags[i]);
+    }
+    assert(0 == liberasurecode_instance_destroy(desc));
     free(orig_data);
-    free(skip);
-    free(avail_frags);
 }
 
-static void verify_fragment_metadata_mismatch_impl(const ec_backend_id_t be_id, struct ec_args *args,
-        fragment_mismatch_scenario_t scenario)
+static void test_encode_iov(const ec_backend_id_t be_id,
+                            struct ec_args *args)
 {
-    int orig_data_size = 1024;
+    int i, rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 3;
+    char *orig_data = NULL;
     char **encoded_data = NULL, **encoded_parity = NULL;
-    char **avail_frags = NULL;
-    uint64_t encoded_fragment_len = 0;
-    int rc = -1;
-    int num_avail_frags = -1;
-    int i = 0;
-    uint32_t orig_libec_ver = 0;
-    uint32_t orig_be_ver = 0;
-    uint8_t orig_be_id = 0;
-    uint32_t orig_frag_idx = 0;
-    int *skip = create_skips_array(args,-1);
-    char *orig_data = create_buffer(orig_data_size, 'x');
-    int desc = liberasurecode_instance_create(be_id, args);
+    char **iov_data = NULL, **iov_parity = NULL;
+    uint64_t encoded_fragment_len = 0, iov_fragment_len = 0;
+    uint64_t decoded_data_len = 0;
+    char *decoded_data = NULL;
+    struct iovec iov[5];
 
+    desc = liberasurecode_instance_create(be_id, args);
     if (-EBACKENDNOTAVAIL == desc) {
         fprintf(stderr, "Backend library not available!\n");
-        free(orig_data);
-        free(skip);
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
         return;
     }
     assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
     assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char) (i * 7);
+    }
     rc = liberasurecode_encode(desc, orig_data, orig_data_size,
             &encoded_data, &encoded_parity, &encoded_fragment_len);
     assert(0 == rc);
-    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+
+    /* odd-sized chunks that straddle fragment boundaries, one empty */
+    iov[0].iov_base = orig_data;
+    iov[0].iov_len = 1;
+    iov[1].iov_base = orig_data + 1;
+    iov[1].iov_len = 4095;
+    iov[2].iov_base = NULL;
+    iov[2].iov_len = 0;
+    iov[3].iov_base = orig_data + 4096;
+    iov[3].iov_len = orig_data_size / 2 - 4096 + 1;
+    iov[4].iov_base = orig_data + orig_data_size / 2 + 1;
+    iov[4].iov_len = orig_data_size - orig_data_size / 2 - 1;
+
+    rc = liberasurecode_encode_iov(desc, iov, 5,
+            &iov_data, &iov_parity, &iov_fragment_len);
+    assert(0 == rc);
+    assert(iov_fragment_len == encoded_fragment_len);
+
+    /* shss & libphazr fragments are not deterministic */
+    if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+        for (i = 0; i < args->k; i++) {
+            assert(memcmp(iov_data[i], encoded_data[i],
+                          encoded_fragment_len) == 0);
+        }
+        for (i = 0; i < args->m; i++) {
+            assert(memcmp(iov_parity[i], encoded_parity[i],
+                          encoded_fragment_len) == 0);
+        }
+    }
+
+    rc = liberasurecode_decode(desc, iov_data, args->k, iov_fragment_len, 1,
+                               &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+
+    liberasurecode_decode_cleanup(desc, decoded_data);
+    liberasurecode_encode_cleanup(desc, iov_data, iov_parity);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(desc));
+    free(orig_data);
+}
+
+static void test_decode_into(const ec_backend_id_t be_id,
+                             struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 3;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t encoded_fragment_len = 0;
+    uint64_t decoded_data_len = 0;
+    char *out = NULL;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+    }
+
+    out = malloc(orig_data_size + 1);
+    assert(out != NULL);
+
+    rc = liberasurecode_decode_into(desc, frags, num_fragments,
+            encoded_fragment_len, 0, NULL, orig_data_size, &decoded_data_len);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_decode_into(desc, frags, num_fragments,
+            encoded_fragment_len, 0, out, orig_data_size - 1,
+            &decoded_data_len);
+    assert(rc == -EINVALIDPARAMS);
+
+    /* all data fragments available */
+    memset(out, 0, orig_data_size + 1);
+    rc = liberasurecode_decode_into(desc, frags, num_fragments,
+            encoded_fragment_len, 0, out, orig_data_size + 1,
+            &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(out, orig_data, orig_data_size) == 0);
+    assert(out[orig_data_size] == 0);
+
+    /* first data fragment missing, forces a decode */
+    memset(out, 0, orig_data_size + 1);
+    rc = liberasurecode_decode_into(desc, frags + 1, num_fragments - 1,
+            encoded_fragment_len, 1, out, orig_data_size,
+            &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(out, orig_data, orig_data_size) == 0);
+
+    free(out);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(desc));
+    free(orig_data);
+}
+
+static void test_decode_iov(const ec_backend_id_t be_id,
+                            struct ec_args *args)
+{
+    int i, j, rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 3;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *frags[EC_MAX_FRAGMENTS];
+    char **decoded_fragments = NULL;
+    uint64_t encoded_fragment_len = 0;
+    struct iovec iov[EC_MAX_FRAGMENTS];
+    int iovcnt = 0;
+    char *out = NULL;
+    int off = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char) (i * 13);
+    }
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+    }
+    out = malloc(orig_data_size);
+    assert(out != NULL);
+
+    iovcnt = args->k - 1;
+    rc = liberasurecode_decode_iov(desc, frags, num_fragments,
+            encoded_fragment_len, 0, iov, &iovcnt, &decoded_fragments);
+    assert(rc == -EINVALIDPARAMS);
+
+    /* j == 0: all fragments, j == 1: first data fragment missing */
+    for (j = 0; j < 2; j++) {
+        iovcnt = EC_MAX_FRAGMENTS;
+        rc = liberasurecode_decode_iov(desc, frags + j, num_fragments - j,
+                encoded_fragment_len, 1, iov, &iovcnt, &decoded_fragments);
+        assert(0 == rc);
+        assert(iovcnt > 0 && iovcnt <= args->k);
+        if (j == 0 && be_id != EC_BACKEND_SHSS &&
+                be_id != EC_BACKEND_LIBPHAZR) {
+            /* zero-copy: the view points into the data fragments */
+            assert(decoded_fragments == NULL);
+            assert(iov[0].iov_base ==
+                   encoded_data[0] + sizeof(fragment_header_t));
+        }
+        for (i = 0, off = 0; i < iovcnt; i++) {
+            assert(off + iov[i].iov_len <= orig_data_size);
+            memcpy(out + off, iov[i].iov_base, iov[i].iov_len);
+            off += iov[i].iov_len;
+        }
+        assert(off == orig_data_size);
+        assert(memcmp(out, orig_data, orig_data_size) == 0);
+        assert(0 == liberasurecode_decode_iov_cleanup(desc, decoded_fragments));
+    }
+
+    free(out);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(desc));
+    free(orig_data);
+}
+
+static void test_encode_slab(const ec_backend_id_t be_id,
+                             struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1, slab_desc = -1;
+    int orig_data_size = 1024 * 1024 + 3;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **slab_data = NULL, **slab_parity = NULL;
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t encoded_fragment_len = 0, slab_fragment_len = 0;
+    uint64_t decoded_data_len = 0;
+    char *decoded_data = NULL;
+    size_t stride = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+    args->flags = EC_ARGS_SLAB_ENCODE;
+    slab_desc = liberasurecode_instance_create(be_id, args);
+    assert(slab_desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    rc = liberasurecode_encode(slab_desc, orig_data, orig_data_size,
+            &slab_data, &slab_parity, &slab_fragment_len);
+    assert(0 == rc);
+    assert(slab_fragment_len == encoded_fragment_len);
+
+    /* One slab: arrays first, then the fragments in index order */
+    assert(slab_parity == slab_data + args->k);
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? slab_data[i] : slab_parity[i - args->k];
+        assert(((uintptr_t) frags[i] % 64) == 0);
+        assert(frags[i] >= (char *) (slab_data + num_fragments));
+        if (i == 1) {
+            stride = frags[1] - frags[0];
+            assert(stride >= slab_fragment_len && stride < slab_fragment_len + 64);
+        } else if (i > 1) {
+            assert((size_t) (frags[i] - frags[i - 1]) == stride);
+        }
+        if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+            char *cmp = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+            assert(memcmp(frags[i], cmp, encoded_fragment_len) == 0);
+        }
+    }
+
+    rc = liberasurecode_decode(slab_desc, frags + 1, num_fragments - 1,
+            slab_fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(slab_desc, decoded_data);
+
+    assert(0 == liberasurecode_encode_cleanup(slab_desc, slab_data, slab_parity));
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+
+    /* The parity array alone is enough to release the slab */
+    rc = liberasurecode_encode(slab_desc, orig_data, orig_data_size,
+            &slab_data, &slab_parity, &slab_fragment_len);
+    assert(0 == rc);
+    assert(0 == liberasurecode_encode_cleanup(slab_desc, NULL, slab_parity));
+
+    assert(0 == liberasurecode_instance_destroy(slab_desc));
+    assert(0 == liberasurecode_instance_destroy(desc));
+    free(orig_data);
+}
+
+static void test_payload_align(const ec_backend_id_t be_id,
+                               struct ec_args *args)
+{
+    static const int aligns[] = { 0, 32, 64, 4096 };
+    int a, c, i, rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    int orig_data_size = 128 * 1024 + 3;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **batch_data[2], **batch_parity[2];
+    const char *batch_orig[2];
+    uint64_t batch_size[2], batch_len[2];
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t fragment_len = 0;
+    uint64_t decoded_data_len = 0;
+    char *decoded_data = NULL;
+    char *out = NULL;
+    struct ec_args align_args = *args;
+
+    if (!liberasurecode_backend_available(be_id)) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    align_args.payload_align = 48;
+    assert(-EINVALIDPARAMS ==
+           liberasurecode_instance_create(be_id, &align_args));
+
+    orig_data = create_buffer(orig_data_size, 'a');
+    assert(orig_data != NULL);
+
+    /* Plain, pooled and slab allocations, at each alignment */
+    for (a = 0; a < (int) (sizeof(aligns) / sizeof(aligns[0])); a++) {
+        int align = aligns[a] ? aligns[a] : 16;
+
+        for (c = 0; c < 3; c++) {
+            align_args = *args;
+            align_args.payload_align = aligns[a];
+            align_args.pool_max_bytes = (c == 1) ? 16 * 1024 * 1024 : 0;
+            align_args.flags = (c == 2) ? EC_ARGS_SLAB_ENCODE : 0;
+            desc = liberasurecode_instance_create(be_id, &align_args);
+            if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+                assert(-EINVALIDPARAMS == desc);
+                free(orig_data);
+                return;
+            }
+            assert(desc > 0);
+
+            rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+                    &encoded_data, &encoded_parity, &fragment_len);
+            assert(0 == rc);
+            for (i = 0; i < num_fragments; i++) {
+                frags[i] = (i < args->k) ? encoded_data[i] :
+                                           encoded_parity[i - args->k];
+                assert(((uintptr_t) get_data_ptr_from_fragment(frags[i]) %
+                        align) == 0);
+            }
+
+            rc = liberasurecode_decode(desc, frags + 1, num_fragments - 1,
+                    fragment_len, 1, &decoded_data, &decoded_data_len);
+            assert(0 == rc);
+            assert(decoded_data_len == orig_data_size);
+            assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+            liberasurecode_decode_cleanup(desc, decoded_data);
+
+            out = malloc(fragment_len);
+            assert(out != NULL);
+            rc = liberasurecode_reconstruct_fragment(desc, frags + 1,
+                    num_fragments - 1, fragment_len, 0, out);
+            assert(0 == rc);
+            if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+                assert(memcmp(out, frags[0], fragment_len) == 0);
+            }
+            free(out);
+            assert(0 == liberasurecode_encode_cleanup(desc, encoded_data,
+                                                      encoded_parity));
+
+            /* Every stripe of a batch slab */
+            batch_orig[0] = batch_orig[1] = orig_data;
+            batch_size[0] = orig_data_size;
+            batch_size[1] = 1000;
+            rc = liberasurecode_encode_batch(desc, 2, batch_orig, batch_size,
+                    batch_data, batch_parity, batch_len);
+            assert(0 == rc);
+            for (i = 0; i < num_fragments; i++) {
+                assert(((uintptr_t) get_data_ptr_from_fragment(
+                        (i < args->k) ? batch_data[1][i] :
+                                        batch_parity[1][i - args->k]) %
+                        align) == 0);
+            }
+            assert(0 == liberasurecode_encode_batch_cleanup(desc, 2,
+                    batch_data, batch_parity));
+
+            assert(0 == liberasurecode_instance_destroy(desc));
+        }
+    }
+
+    free(orig_data);
+}
+
+static void test_buffer_pool(const ec_backend_id_t be_id,
+                             struct ec_args *args)
+{
+    int i, round, rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 3;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t encoded_fragment_len = 0;
+    uint64_t decoded_data_len = 0;
+    char *decoded_data = NULL;
+    char *out = NULL;
+    struct ec_pool_stats stats;
+
+    args->pool_max_bytes = 64 * 1024 * 1024;
+    args->flags = EC_ARGS_POOL_PREFAULT;
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+
+    /* The second round should be served from what the first one returned */
+    for (round = 0; round < 2; round++) {
+        rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(0 == rc);
+        for (i = 0; i < num_fragments; i++) {
+            frags[i] = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+        }
+
+        rc = liberasurecode_decode(desc, frags + 1, num_fragments - 1,
+                encoded_fragment_len, 0, &decoded_data, &decoded_data_len);
+        assert(0 == rc);
+        assert(decoded_data_len == orig_data_size);
+        assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+
+        out = malloc(encoded_fragment_len);
+        assert(out != NULL);
+        rc = liberasurecode_reconstruct_fragment(desc, frags + 1,
+                num_fragments - 1, encoded_fragment_len, 0, out);
+        assert(0 == rc);
+        assert(memcmp(out, frags[0], encoded_fragment_len) == 0);
+        free(out);
+
+        assert(0 == liberasurecode_get_pool_stats(desc, &stats));
+        assert(stats.in_use_buffers > 0);
+
+        liberasurecode_decode_cleanup(desc, decoded_data);
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    }
+
+    assert(0 == liberasurecode_get_pool_stats(desc, &stats));
+    assert(stats.max_bytes == args->pool_max_bytes);
+    assert(stats.in_use_buffers == 0);
+    assert(stats.in_use_bytes == 0);
+    assert(stats.cached_buffers > 0);
+    assert(stats.cached_bytes <= stats.max_bytes);
+    assert(stats.hits >= num_fragments);
+    assert(stats.drops == 0);
+    assert(0 == liberasurecode_instance_destroy(desc));
+
+    /* A pool too small to hold anything hands everything back */
+    args->pool_max_bytes = 1;
+    args->flags = 0;
+    desc = liberasurecode_instance_create(be_id, args);
+    assert(desc > 0);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_get_pool_stats(desc, &stats));
+    assert(stats.cached_buffers == 0);
+    assert(stats.cached_bytes == 0);
+    assert(stats.drops == num_fragments);
+    assert(0 == liberasurecode_instance_destroy(desc));
+
+    free(orig_data);
+}
+
+/*
+ * Encode/decode buffers are no longer zero-filled up front.  Recycle dirty
+ * buffers through the pool and check that nothing stale leaks into the
+ * fragments or the decoded data.
+ */
+static void test_encode_reused_buffers(const ec_backend_id_t be_id,
+                                       struct ec_args *args)
+{
+    int i, j, rc = 0;
+    int desc = -1, ref_desc = -1;
+    int orig_data_size = 1024 * 1024 + 3;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **ref_data = NULL, **ref_parity = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t ref_fragment_len = 0, encoded_fragment_len = 0;
+    uint64_t decoded_data_len = 0;
+    char *decoded_data = NULL;
+
+    if (be_id == EC_BACKEND_SHSS || be_id == EC_BACKEND_LIBPHAZR) {
+        return;
+    }
+    ref_desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == ref_desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == ref_desc);
+        return;
+    }
+    assert(ref_desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(ref_desc, orig_data, orig_data_size,
+            &ref_data, &ref_parity, &ref_fragment_len);
+    assert(0 == rc);
+
+    /* j == 0: separate fragments, j == 1: slab */
+    for (j = 0; j < 2; j++) {
+        args->pool_max_bytes = 64 * 1024 * 1024;
+        args->flags = j ? EC_ARGS_SLAB_ENCODE : 0;
+        desc = liberasurecode_instance_create(be_id, args);
+        assert(desc > 0);
+
+        /* Leave garbage in everything that goes back to the pool */
+        rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(0 == rc);
+        for (i = 0; i < num_fragments; i++) {
+            frags[i] = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+        }
+        rc = liberasurecode_decode(desc, frags + 1, num_fragments - 1,
+                encoded_fragment_len, 0, &decoded_data, &decoded_data_len);
+        assert(0 == rc);
+        memset(decoded_data, 0xa5, decoded_data_len);
+        liberasurecode_decode_cleanup(desc, decoded_data);
+        for (i = 0; i < num_fragments; i++) {
+            memset(frags[i], 0xa5, encoded_fragment_len);
+        }
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+
+        rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(0 == rc);
+        assert(encoded_fragment_len == ref_fragment_len);
+        for (i = 0; i < num_fragments; i++) {
+            char *ref = (i < args->k) ? ref_data[i] : ref_parity[i - args->k];
+            frags[i] = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+            assert(memcmp(frags[i], ref, ref_fragment_len) == 0);
+        }
+        rc = liberasurecode_decode(desc, frags + 1, num_fragments - 1,
+                encoded_fragment_len, 0, &decoded_data, &decoded_data_len);
+        assert(0 == rc);
+        assert(decoded_data_len == orig_data_size);
+        assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+        liberasurecode_decode_cleanup(desc, decoded_data);
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+        assert(0 == liberasurecode_instance_destroy(desc));
+    }
+
+    liberasurecode_encode_cleanup(ref_desc, ref_data, ref_parity);
+    assert(0 == liberasurecode_instance_destroy(ref_desc));
+    free(orig_data);
+}
+
+static void test_encode_decode_batch(const ec_backend_id_t be_id,
+                                     struct ec_args *args)
+{
+    int i, j, rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    int sizes[] = { 1, 100, 4096, 4097, 64 * 1024 - 1, 333, 8192 };
+    int num_objects = sizeof(sizes) / sizeof(sizes[0]);
+    const char *orig_data[7];
+    uint64_t orig_data_size[7];
+    char **encoded_data[7], **encoded_parity[7];
+    uint64_t fragment_len[7];
+    char *frags[7][EC_MAX_FRAGMENTS];
+    char **avail[7];
+    int num_avail[7];
+    char *decoded_data[7];
+    uint64_t decoded_data_len[7];
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    for (i = 0; i < num_objects; i++) {
+        orig_data[i] = create_buffer(sizes[i], 'a' + i);
+        assert(orig_data[i] != NULL);
+        orig_data_size[i] = sizes[i];
+    }
+
+    assert(-EINVALIDPARAMS == liberasurecode_encode_batch(desc, 0,
+            orig_data, orig_data_size, encoded_data, encoded_parity,
+            fragment_len));
+    assert(-EBACKENDNOTAVAIL == liberasurecode_encode_batch(-1, num_objects,
+            orig_data, orig_data_size, encoded_data, encoded_parity,
+            fragment_len));
+
+    rc = liberasurecode_encode_batch(desc, num_objects, orig_data,
+            orig_data_size, encoded_data, encoded_parity, fragment_len);
+    assert(0 == rc);
+
+    for (i = 0; i < num_objects; i++) {
+        char **data = NULL, **parity = NULL;
+        uint64_t len = 0;
+
+        /* Same fragments as encoding the object on its own */
+        rc = liberasurecode_encode(desc, orig_data[i], orig_data_size[i],
+                &data, &parity, &len);
+        assert(0 == rc);
+        assert(len == fragment_len[i]);
+        for (j = 0; j < num_fragments; j++) {
+            frags[i][j] = (j < args->k) ? encoded_data[i][j] :
+                                          encoded_parity[i][j - args->k];
+            assert(((uintptr_t) frags[i][j] % 64) == 0);
+            if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+                char *cmp = (j < args->k) ? data[j] : parity[j - args->k];
+                assert(memcmp(frags[i][j], cmp, len) == 0);
+            }
+        }
+        liberasurecode_encode_cleanup(desc, data, parity);
+
+        /* Drop the first fragment of every object */
+        avail[i] = frags[i] + 1;
+        num_avail[i] = num_fragments - 1;
+    }
+
+    rc = liberasurecode_decode_batch(desc, num_objects, avail, num_avail,
+            fragment_len, 1, decoded_data, decoded_data_len);
+    assert(0 == rc);
+    for (i = 0; i < num_objects; i++) {
+        assert(decoded_data_len[i] == orig_data_size[i]);
+        assert(memcmp(decoded_data[i], orig_data[i], orig_data_size[i]) == 0);
+    }
+    assert(0 == liberasurecode_decode_batch_cleanup(desc, num_objects,
+                                                    decoded_data));
+    assert(decoded_data[0] == NULL);
+
+    /* One bad object fails the whole batch */
+    num_avail[num_objects - 1] = 0;
+    rc = liberasurecode_decode_batch(desc, num_objects, avail, num_avail,
+            fragment_len, 1, decoded_data, decoded_data_len);
+    assert(-EINVALIDPARAMS == rc);
+    for (i = 0; i < num_objects; i++) {
+        assert(decoded_data[i] == NULL);
+    }
+
+    assert(0 == liberasurecode_encode_batch_cleanup(desc, num_objects,
+                encoded_data, encoded_parity));
+    assert(encoded_data[0] == NULL && encoded_parity[0] == NULL);
+
+    for (i = 0; i < num_objects; i++) {
+        free((char *) orig_data[i]);
+    }
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+struct stream_encode_check {
+    int desc;
+    struct ec_args *args;
+    ec_backend_id_t be_id;
+    const char *orig_data;
+    uint64_t orig_data_size;
+    uint64_t segment_size;
+    uint64_t segments;
+    char *stripe[2];        /* first data fragment of the last two segments */
+};
+
+static int stream_encode_check_segment(void *arg, uint64_t segment_idx,
+        char **encoded_data, char **encoded_parity, uint64_t fragment_len)
+{
+    struct stream_encode_check *check = arg;
+    int i, rc;
+    int k = check->args->k, m = check->args->m;
+    uint64_t off = segment_idx * check->segment_size;
+    uint64_t len = check->orig_data_size - off;
+    char **data = NULL, **parity = NULL;
+    uint64_t ref_len = 0;
+    char *frags[EC_MAX_FRAGMENTS];
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+
+    assert(segment_idx == check->segments);
+    if (len > check->segment_size) {
+        len = check->segment_size;
+    }
+
+    /* Double buffered: alternate between two stripes */
+    if (segment_idx >= 2) {
+        assert(encoded_data[0] == check->stripe[segment_idx % 2]);
+    }
+    if (segment_idx >= 1) {
+        assert(encoded_data[0] != check->stripe[(segment_idx - 1) % 2]);
+    }
+    check->stripe[segment_idx % 2] = encoded_data[0];
+
+    /* Same fragments as encoding the segment on its own */
+    rc = liberasurecode_encode(check->desc, check->orig_data + off, len,
+                               &data, &parity, &ref_len);
+    assert(0 == rc);
+    assert(ref_len == fragment_len);
+    for (i = 0; i < k + m; i++) {
+        frags[i] = (i < k) ? encoded_data[i] : encoded_parity[i - k];
+        assert(((uintptr_t) frags[i] % 64) == 0);
+        if (check->be_id != EC_BACKEND_SHSS &&
+                check->be_id != EC_BACKEND_LIBPHAZR) {
+            char *cmp = (i < k) ? data[i] : parity[i - k];
+            assert(memcmp(frags[i], cmp, fragment_len) == 0);
+        }
+    }
+    liberasurecode_encode_cleanup(check->desc, data, parity);
+
+    rc = liberasurecode_decode(check->desc, frags + 1, k + m - 1,
+                               fragment_len, 1,
+                               &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == len);
+    assert(memcmp(decoded_data, check->orig_data + off, len) == 0);
+    liberasurecode_decode_cleanup(check->desc, decoded_data);
+
+    check->segments++;
+    return 0;
+}
+
+static void test_stream_encoder(const ec_backend_id_t be_id,
+                                struct ec_args *args)
+{
+    int desc = -1;
+    uint64_t chunk, off = 0;
+    uint64_t chunks[] = { 1000, 7777, 1, 40000, 3 };
+    int i = 0;
+    struct stream_encode_check check = { 0 };
+    struct ec_stream_encoder *encoder = NULL;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    check.desc = desc;
+    check.args = args;
+    check.be_id = be_id;
+    check.segment_size = 3 * 4096 + 5;
+    check.orig_data_size = 6 * check.segment_size + 123;
+    check.orig_data = create_buffer(check.orig_data_size, 'x');
+    assert(check.orig_data != NULL);
+
+    assert(NULL == ec_stream_encoder_create(desc, 0,
+                stream_encode_check_segment, &check));
+    assert(NULL == ec_stream_encoder_create(-1, check.segment_size,
+                stream_encode_check_segment, &check));
+
+    encoder = ec_stream_encoder_create(desc, check.segment_size,
+                                       stream_encode_check_segment, &check);
+    assert(encoder != NULL);
+
+    /* Arbitrary chunk sizes, some spanning several segments */
+    while (off < check.orig_data_size) {
+        chunk = chunks[i++ % (sizeof(chunks) / sizeof(chunks[0]))];
+        if (chunk > check.orig_data_size - off) {
+            chunk = check.orig_data_size - off;
+        }
+        assert(0 == ec_stream_encoder_feed(encoder,
+                                           check.orig_data + off, chunk));
+        off += chunk;
+    }
+    assert(check.segments == 6);
+    assert(0 == ec_stream_encoder_flush(encoder));
+    assert(check.segments == 7);
+    assert(0 == ec_stream_encoder_flush(encoder));
+    assert(check.segments == 7);
+
+    ec_stream_encoder_destroy(encoder);
+    free((char *) check.orig_data);
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_stream_decoder(const ec_backend_id_t be_id,
+                                struct ec_args *args)
+{
+    int i, j, rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    int num_segments = 7, ring_size = 3;
+    uint64_t segment_size = 2 * 4096 + 11;
+    uint64_t orig_data_size = (num_segments - 1) * segment_size + 77;
+    char *orig_data = NULL;
+    char *outs[7];
+    struct ec_stream_decoder *decoder = NULL;
+    struct ec_decode_stats stats;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < (int) orig_data_size; i++) {
+        orig_data[i] = (char) (i * 7 + i / 4096);
+    }
+
+    assert(NULL == ec_stream_decoder_create(desc, segment_size, 0));
+    assert(NULL == ec_stream_decoder_create(-1, segment_size, ring_size));
+    decoder = ec_stream_decoder_create(desc, segment_size, ring_size);
+    assert(decoder != NULL);
+
+    for (i = 0; i < num_segments; i++) {
+        uint64_t off = i * segment_size;
+        uint64_t len = orig_data_size - off;
+        char **encoded_data = NULL, **encoded_parity = NULL;
+        uint64_t fragment_len = 0;
+        char *frags[EC_MAX_FRAGMENTS];
+        char *unaligned[EC_MAX_FRAGMENTS] = { NULL };
+        char *others[EC_MAX_FRAGMENTS];
+        char **avail = frags + 1;
+        int num_avail = num_fragments - 1;
+        uint64_t out_len = 0;
+
+        if (len > segment_size) {
+            len = segment_size;
+        }
+        rc = liberasurecode_encode(desc, orig_data + off, len,
+                &encoded_data, &encoded_parity, &fragment_len);
+        assert(0 == rc);
+        for (j = 0; j < num_fragments; j++) {
+            frags[j] = (j < args->k) ? encoded_data[j]
+                                     : encoded_parity[j - args->k];
+        }
+
+        /*
+         * Vary the fragment set: same, all, no parity, unaligned, then
+         * another missing fragment (and decode plan)
+         */
+        if (i == 2) {
+            avail = frags;
+            num_avail = num_fragments;
+        } else if (i == 3) {
+            avail = frags;
+        } else if (i == 4) {
+            for (j = 1; j < num_fragments; j++) {
+                unaligned[j] = malloc(fragment_len + 1);
+                assert(unaligned[j] != NULL);
+                memcpy(unaligned[j] + 1, frags[j], fragment_len);
+                unaligned[j] += 1;
+            }
+            avail = unaligned + 1;
+        } else if (i == 5) {
+            others[0] = frags[0];
+            for (j = 2; j < num_fragments; j++) {
+                others[j - 1] = frags[j];
+            }
+            avail = others;
+        }
+
+        rc = ec_stream_decoder_feed(decoder, avail, num_avail, fragment_len,
+                                    &outs[i], &out_len);
+        assert(0 == rc);
+        assert(out_len == len);
+        assert(memcmp(outs[i], orig_data + off, len) == 0);
+
+        /* Unaligned fragments are only copied for backends that need it */
+        if (i == 4) {
+            rc = liberasurecode_get_decode_stats(desc, &stats);
+            assert(0 == rc);
+            if (be_id == EC_BACKEND_FLAT_XOR_HD ||
+                    be_id == EC_BACKEND_ISA_L_RS_VAND ||
+                    be_id == EC_BACKEND_ISA_L_RS_CAUCHY ||
+                    be_id == EC_BACKEND_LIBERASURECODE_RS_VAND) {
+                assert(stats.unaligned_in_place > 0);
+                assert(0 == stats.unaligned_copies);
+            } else {
+                assert(stats.unaligned_copies > 0);
+            }
+        }
+
+        /* Ring of output buffers: the previous ones are left alone */
+        if (i >= ring_size) {
+            assert(outs[i] == outs[i - ring_size]);
+        }
+        for (j = 1; j < ring_size && j <= i; j++) {
+            assert(outs[i - j] != outs[i]);
+            assert(memcmp(outs[i - j], orig_data + (i - j) * segment_size,
+                          segment_size) == 0);
+        }
+
+        for (j = 0; j < num_fragments; j++) {
+            if (unaligned[j]) {
+                free(unaligned[j] - 1);
+            }
+        }
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    }
+
+    ec_stream_decoder_destroy(decoder);
+    free(orig_data);
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_decode_unaligned(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    int orig_data_size = 64 * 1024 + 9;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t fragment_len = 0;
+    char *bufs[EC_MAX_FRAGMENTS] = { NULL };
+    char *unaligned[EC_MAX_FRAGMENTS];
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    char *out = NULL;
+    struct ec_decode_stats stats;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    assert(-EBACKENDNOTAVAIL == liberasurecode_get_decode_stats(-1, &stats));
+    assert(-EINVALIDPARAMS == liberasurecode_get_decode_stats(desc, NULL));
+    rc = liberasurecode_get_decode_stats(desc, &stats);
+    assert(0 == rc);
+    assert(0 == stats.unaligned_in_place);
+    assert(0 == stats.unaligned_copies);
+
+    orig_data = create_buffer(orig_data_size, 'u');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &fragment_len);
+    assert(0 == rc);
+
+    /* Copies at assorted odd offsets, without the first data fragment */
+    for (i = 1; i < num_fragments; i++) {
+        bufs[i] = malloc(fragment_len + 16);
+        assert(bufs[i] != NULL);
+        unaligned[i] = bufs[i] + 1 + (i % 8) * 2;
+        memcpy(unaligned[i], (i < args->k) ? encoded_data[i] :
+                             encoded_parity[i - args->k], fragment_len);
+    }
+
+    rc = liberasurecode_decode(desc, unaligned + 1, num_fragments - 1,
+            fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    out = malloc(fragment_len);
+    assert(out != NULL);
+    rc = liberasurecode_reconstruct_fragment(desc, unaligned + 1,
+            num_fragments - 1, fragment_len, 0, out);
+    assert(0 == rc);
+    assert(memcmp(out, encoded_data[0], fragment_len) == 0);
+
+    rc = liberasurecode_get_decode_stats(desc, &stats);
+    assert(0 == rc);
+    if (be_id == EC_BACKEND_FLAT_XOR_HD ||
+            be_id == EC_BACKEND_ISA_L_RS_VAND ||
+            be_id == EC_BACKEND_ISA_L_RS_CAUCHY ||
+            be_id == EC_BACKEND_LIBERASURECODE_RS_VAND) {
+        assert(stats.unaligned_in_place > 0);
+        assert(0 == stats.unaligned_copies);
+        assert(0 == stats.unaligned_copy_bytes);
+    } else {
+        assert(stats.unaligned_copies > 0);
+        assert(stats.unaligned_copy_bytes ==
+               stats.unaligned_copies * fragment_len);
+    }
+
+    free(out);
+    for (i = 1; i < num_fragments; i++) {
+        free(bufs[i]);
+    }
+    free(orig_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_decode_range(const ec_backend_id_t be_id,
+                              struct ec_args *args)
+{
+    int i, j, r, rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    int orig_data_size = 256 * 1024 + 3;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t fragment_len = 0;
+    char *frags[EC_MAX_FRAGMENTS];
+    char *partial[EC_MAX_FRAGMENTS];
+    char *out = NULL;
+    uint64_t blocksize;
+    struct ec_fragment_range ranges[EC_MAX_FRAGMENTS];
+    struct ec_fragment_range window;
+    int num_ranges;
+    uint64_t range_specs[][2] = {
+        { 0, 1 },
+        { 100, 4096 },
+        { 0, 0 },
+        { 0, 0 },                   /* whole object, filled in below */
+        { 0, 0 },                   /* straddles fragments 0 and 1 */
+        { 0, 0 },                   /* tail of the object */
+    };
+    int num_specs = sizeof(range_specs) / sizeof(range_specs[0]);
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char) (i * 13 + i / 1000);
+    }
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &fragment_len);
+    assert(0 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+        partial[i] = malloc(fragment_len);
+        assert(partial[i] != NULL);
+    }
+    blocksize = get_fragment_payload_size(frags[0]);
+    range_specs[3][1] = orig_data_size;
+    range_specs[4][0] = blocksize - 10;
+    range_specs[4][1] = 20 < orig_data_size - range_specs[4][0] ?
+                        20 : orig_data_size - range_specs[4][0];
+    range_specs[5][0] = orig_data_size - 5;
+    range_specs[5][1] = 5;
+    out = malloc(orig_data_size);
+    assert(out != NULL);
+
+    assert(-EINVALIDPARAMS == liberasurecode_decode_range(desc, frags,
+                num_fragments, fragment_len, orig_data_size - 1, 2, out));
+
+    for (r = 0; r < num_specs; r++) {
+        uint64_t offset = range_specs[r][0], length = range_specs[r][1];
+
+        /* All fragments, then with the first data fragment missing */
+        memset(out, 0, orig_data_size);
+        rc = liberasurecode_decode_range(desc, frags, num_fragments,
+                                         fragment_len, offset, length, out);
+        assert(0 == rc);
+        assert(memcmp(out, orig_data + offset, length) == 0);
+
+        memset(out, 0, orig_data_size);
+        rc = liberasurecode_decode_range(desc, frags + 1, num_fragments - 1,
+                                         fragment_len, offset, length, out);
+        assert(0 == rc);
+        assert(memcmp(out, orig_data + offset, length) == 0);
+
+        num_ranges = args->k;
+        rc = liberasurecode_get_fragment_ranges(desc, orig_data_size,
+                offset, length, ranges, &num_ranges, &window);
+        if (be_id == EC_BACKEND_SHSS || be_id == EC_BACKEND_LIBPHAZR) {
+            assert(-EECMETHODNOTIMPL == rc);
+            continue;
+        }
+        assert(0 == rc);
+        assert(num_ranges == (length ? (int) ((offset + length - 1) /
+                blocksize - offset / blocksize + 1) : 0));
+
+        /* Only the headers and the reported parts need to be there */
+        for (i = 0; i < num_fragments; i++) {
+            memset(partial[i], 0xa5, fragment_len);
+            memcpy(partial[i], frags[i], sizeof(fragment_header_t));
+            memcpy(partial[i] + window.offset, frags[i] + window.offset,
+                   window.length);
+        }
+        for (j = 0; j < num_ranges; j++) {
+            struct ec_fragment_range *range = &ranges[j];
+            memcpy(partial[range->index] + range->offset,
+                   frags[range->index] + range->offset, range->length);
+        }
+        memset(out, 0, orig_data_size);
+        rc = liberasurecode_decode_range(desc, partial + 1, num_fragments - 1,
+                                         fragment_len, offset, length, out);
+        assert(0 == rc);
+        assert(memcmp(out, orig_data + offset, length) == 0);
+    }
+
+    for (i = 0; i < num_fragments; i++) {
+        free(partial[i]);
+    }
+    free(out);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    free(orig_data);
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_encode_decode_threads(const ec_backend_id_t be_id,
+                                       struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1, single_desc = -1;
+    int num_fragments = args->k + args->m;
+    int orig_data_size = 4 * 1024 * 1024 + 3;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **single_data = NULL, **single_parity = NULL;
+    uint64_t fragment_len = 0, single_len = 0;
+    char *frags[EC_MAX_FRAGMENTS];
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    char *out_frag = NULL;
+    struct ec_args threaded_args = *args;
+
+    threaded_args.num_threads = 4;
+    desc = liberasurecode_instance_create(be_id, &threaded_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+    single_desc = liberasurecode_instance_create(be_id, args);
+    assert(single_desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char) (i * 31 + (i >> 12));
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &fragment_len);
+    assert(0 == rc);
+    rc = liberasurecode_encode(single_desc, orig_data, orig_data_size,
+            &single_data, &single_parity, &single_len);
+    assert(0 == rc);
+    assert(fragment_len == single_len);
+
+    /* Splitting the work must not change a single byte */
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? encoded_data[i] :
+                                   encoded_parity[i - args->k];
+        if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+            char *cmp = (i < args->k) ? single_data[i] :
+                                        single_parity[i - args->k];
+            assert(memcmp(frags[i], cmp, fragment_len) == 0);
+        }
+    }
+
+    /* Decode without the first fragment */
+    rc = liberasurecode_decode(desc, frags + 1, num_fragments - 1,
+            fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    /* Rebuild the first fragment from the others */
+    out_frag = malloc(fragment_len);
+    assert(out_frag != NULL);
+    rc = liberasurecode_reconstruct_fragment(desc, frags + 1,
+            num_fragments - 1, fragment_len, 0, out_frag);
+    assert(0 == rc);
+    assert(memcmp(out_frag, frags[0], fragment_len) == 0);
+
+    free(out_frag);
+    free(orig_data);
+    liberasurecode_encode_cleanup(single_desc, single_data, single_parity);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(single_desc));
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_encode_tiled(const ec_backend_id_t be_id,
+                              struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1, single_desc = -1;
+    int num_fragments = args->k + args->m;
+    int orig_data_size = 3 * 1024 * 1024 + 5;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *data_bufs[EC_MAX_FRAGMENTS], *parity_bufs[EC_MAX_FRAGMENTS];
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t fragment_len = 0, into_len = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    int buffer_size = 0;
+    struct iovec iov[3];
+    struct ec_args threaded_args = *args;
+
+    threaded_args.num_threads = 4;
+    desc = liberasurecode_instance_create(be_id, &threaded_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+    single_desc = liberasurecode_instance_create(be_id, args);
+    assert(single_desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char) (i * 13 + (i >> 9));
+    }
+
+    /* odd sized pieces so tiles straddle iovec boundaries */
+    iov[0].iov_base = orig_data;
+    iov[0].iov_len = 4097;
+    iov[1].iov_base = orig_data + 4097;
+    iov[1].iov_len = 1024 * 1024 + 11;
+    iov[2].iov_base = orig_data + iov[0].iov_len + iov[1].iov_len;
+    iov[2].iov_len = orig_data_size - iov[0].iov_len - iov[1].iov_len;
+    rc = liberasurecode_encode_iov(desc, iov, 3,
+            &encoded_data, &encoded_parity, &fragment_len);
+    assert(0 == rc);
+
+    /* the staged encode_into path is the reference */
+    buffer_size = liberasurecode_get_fragment_buffer_size(single_desc,
+                                                          orig_data_size);
+    assert(buffer_size == (int) fragment_len);
+    for (i = 0; i < num_fragments; i++) {
+        char *buf = NULL;
+        assert(0 == posix_memalign((void **) &buf, 16, buffer_size));
+        if (i < args->k) {
+            data_bufs[i] = buf;
+        } else {
+            parity_bufs[i - args->k] = buf;
+        }
+    }
+    rc = liberasurecode_encode_into(single_desc, orig_data, orig_data_size,
+            data_bufs, parity_bufs, buffer_size, &into_len);
+    assert(0 == rc);
+    assert(into_len == fragment_len);
+
+    for (i = 0; i < num_fragments; i++) {
+        fragment_metadata_t metadata;
+        char *ref = (i < args->k) ? data_bufs[i] : parity_bufs[i - args->k];
+
+        frags[i] = (i < args->k) ? encoded_data[i] :
+                                   encoded_parity[i - args->k];
+        rc = liberasurecode_get_fragment_metadata(frags[i], &metadata);
+        assert(0 == rc);
+        assert(metadata.chksum_type == args->ct);
+        assert(metadata.chksum_mismatch == 0);
+        validate_fragment_checksum(args, &metadata,
+                                   get_data_ptr_from_fragment(frags[i]));
+        /* shss & libphazr fragments are not deterministic */
+        if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+            assert(memcmp(frags[i], ref, fragment_len) == 0);
+        }
+    }
+
+    rc = liberasurecode_decode(desc, frags + 1, num_fragments - 1,
+            fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+
+    liberasurecode_decode_cleanup(desc, decoded_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    for (i = 0; i < args->k; i++) {
+        free(data_bufs[i]);
+    }
+    for (i = 0; i < args->m; i++) {
+        free(parity_bufs[i]);
+    }
+    free(orig_data);
+    assert(0 == liberasurecode_instance_destroy(single_desc));
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_decode_with_plan(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    int i, j, rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    int num_lost = (be_id == EC_BACKEND_FLAT_XOR_HD) ? args->hd - 1 : args->m;
+    int orig_data_size = 96 * 1024 + 5;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t fragment_len = 0;
+    char *frags[EC_MAX_FRAGMENTS];
+    char *avail[EC_MAX_FRAGMENTS];
+    char *out_frags[EC_MAX_FRAGMENTS];
+    int num_avail = 0, num_wanted = 0;
+    uint64_t available_bm = 0, lost_bm = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    struct ec_decode_plan *plan = NULL;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'p');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &fragment_len);
+    assert(0 == rc);
+
+    /* Lose the first data fragment and, if we can afford it, a parity */
+    if (num_lost > 2) {
+        num_lost = 2;
+    }
+    lost_bm = 1;
+    if (num_lost > 1) {
+        lost_bm |= 1ULL << args->k;
+    }
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? encoded_data[i] :
+                                   encoded_parity[i - args->k];
+        if (lost_bm & (1ULL << i)) {
+            out_frags[num_wanted++] = malloc(fragment_len);
+            assert(out_frags[num_wanted - 1] != NULL);
+        } else {
+            available_bm |= 1ULL << i;
+        }
+    }
+    /* Fragments may come in any order */
+    for (i = num_fragments - 1; i >= 0; i--) {
+        if (available_bm & (1ULL << i)) {
+            avail[num_avail++] = frags[i];
+        }
+    }
+
+    assert(NULL == liberasurecode_plan_create(-1, available_bm, lost_bm));
+    assert(NULL == liberasurecode_plan_create(desc, available_bm, 1ULL << 1));
+    assert(NULL == liberasurecode_plan_create(desc,
+            (1ULL << (args->k - 1)) - 1, lost_bm));
+    plan = liberasurecode_plan_create(desc, available_bm, lost_bm);
+    assert(plan != NULL);
+
+    /* The plan is reused stripe after stripe */
+    for (j = 0; j < 3; j++) {
+        rc = liberasurecode_decode_with_plan(plan, avail, num_avail,
+                fragment_len, 1, &decoded_data, &decoded_data_len);
+        assert(0 == rc);
+        assert(decoded_data_len == orig_data_size);
+        assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+        liberasurecode_decode_cleanup(desc, decoded_data);
+
+        rc = liberasurecode_reconstruct_with_plan(plan, avail, num_avail,
+                fragment_len, out_frags);
+        assert(0 == rc);
+        for (i = 0, num_wanted = 0; i < num_fragments; i++) {
+            if (lost_bm & (1ULL << i)) {
+                assert(memcmp(out_frags[num_wanted++], frags[i],
+                              fragment_len) == 0);
+            }
+        }
+    }
+
+    /* A different set of fragments does not match the plan */
+    if (num_avail > args->k) {
+        rc = liberasurecode_decode_with_plan(plan, avail, num_avail - 1,
+                fragment_len, 0, &decoded_data, &decoded_data_len);
+        assert(-EINVALIDPARAMS == rc);
+        rc = liberasurecode_reconstruct_with_plan(plan, avail,
+                num_avail - 1, fragment_len, out_frags);
+        assert(-EINVALIDPARAMS == rc);
+    }
+
+    liberasurecode_plan_destroy(plan);
+    for (i = 0; i < num_wanted; i++) {
+        free(out_frags[i]);
+    }
+    free(orig_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_reconstruct_fragments(const ec_backend_id_t be_id,
+                                       struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    int num_lost = (be_id == EC_BACKEND_FLAT_XOR_HD) ? args->hd - 1 : args->m;
+    int orig_data_size = 96 * 1024 + 5;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t fragment_len = 0;
+    char *frags[EC_MAX_FRAGMENTS];
+    char *avail[EC_MAX_FRAGMENTS];
+    char *out_frags[EC_MAX_FRAGMENTS + 1];
+    int lost[3];
+    int destination_idxs[EC_MAX_FRAGMENTS + 1];
+    int num_avail = 0, num_dest = 0;
+    uint64_t lost_bm = 0;
+    char *unaligned = NULL;
+    char *unaligned_frag = NULL;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'r');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &fragment_len);
+    assert(0 == rc);
+
+    /* Lose the first parity and up to two data fragments */
+    if (num_lost > 3) {
+        num_lost = 3;
+    }
+    if (num_lost > args->k + 1) {
+        num_lost = args->k + 1;
+    }
+    lost[0] = args->k;
+    lost[1] = 0;
+    lost[2] = args->k - 1;
+    for (i = 0; i < num_lost; i++) {
+        lost_bm |= 1ULL << lost[i];
+    }
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? encoded_data[i] :
+                                   encoded_parity[i - args->k];
+        if (!(lost_bm & (1ULL << i))) {
+            avail[num_avail++] = frags[i];
+        }
+    }
+    for (i = 0; i <= EC_MAX_FRAGMENTS; i++) {
+        out_frags[i] = NULL;
+    }
+
+    /* Every lost fragment, out of index order, plus an available one */
+    for (i = 0; i < num_lost; i++) {
+        destination_idxs[num_dest++] = lost[i];
+    }
+    destination_idxs[num_dest++] = num_fragments - 1;
+    destination_idxs[num_dest] = -1;
+    for (i = 0; i < num_dest; i++) {
+        out_frags[i] = malloc(fragment_len);
+        assert(out_frags[i] != NULL);
+    }
+
+    rc = liberasurecode_reconstruct_fragments(desc, avail, num_avail,
+            fragment_len, destination_idxs, out_frags);
+    assert(0 == rc);
+    for (i = 0; i < num_dest; i++) {
+        assert(memcmp(out_frags[i], frags[destination_idxs[i]],
+                      fragment_len) == 0);
+    }
+
+    /* Only some of the lost fragments */
+    destination_idxs[0] = lost[num_lost - 1];
+    destination_idxs[1] = -1;
+    memset(out_frags[0], 0, fragment_len);
+    rc = liberasurecode_reconstruct_fragments(desc, avail, num_avail,
+            fragment_len, destination_idxs, out_frags);
+    assert(0 == rc);
+    assert(memcmp(out_frags[0], frags[lost[num_lost - 1]],
+                  fragment_len) == 0);
+
+    /* Unaligned output buffers are rebuilt aside and copied out */
+    unaligned = malloc(fragment_len + 1);
+    assert(unaligned != NULL);
+    unaligned_frag = unaligned + 1;
+    destination_idxs[0] = lost[0];
+    destination_idxs[1] = -1;
+    rc = liberasurecode_reconstruct_fragments(desc, avail, num_avail,
+            fragment_len, destination_idxs, &unaligned_frag);
+    assert(0 == rc);
+    assert(memcmp(unaligned_frag, frags[lost[0]], fragment_len) == 0);
+    free(unaligned);
+
+    /* An available destination may be its own output buffer */
+    destination_idxs[0] = num_fragments - 1;
+    rc = liberasurecode_reconstruct_fragments(desc, avail, num_avail,
+            fragment_len, destination_idxs, &frags[num_fragments - 1]);
+    assert(0 == rc);
+
+    /* Bad destination lists */
+    destination_idxs[0] = 0;
+    destination_idxs[1] = 0;
+    destination_idxs[2] = -1;
+    rc = liberasurecode_reconstruct_fragments(desc, avail, num_avail,
+            fragment_len, destination_idxs, out_frags);
+    assert(-EINVALIDPARAMS == rc);
+    destination_idxs[0] = num_fragments;
+    destination_idxs[1] = -1;
+    rc = liberasurecode_reconstruct_fragments(desc, avail, num_avail,
+            fragment_len, destination_idxs, out_frags);
+    assert(-EINVALIDPARAMS == rc);
+    rc = liberasurecode_reconstruct_fragments(desc, avail, num_avail,
+            fragment_len, NULL, out_frags);
+    assert(-EINVALIDPARAMS == rc);
+    rc = liberasurecode_reconstruct_fragments(-1, avail, num_avail,
+            fragment_len, destination_idxs, out_frags);
+    assert(-EBACKENDNOTAVAIL == rc);
+
+    for (i = 0; i < num_dest; i++) {
+        free(out_frags[i]);
+    }
+    free(orig_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+struct async_waiter {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int completed;
+    int ret;
+    bool hold;                  /* keep the worker in the callback */
+};
+
+static void async_waiter_cb(void *user_data, int ret)
+{
+    struct async_waiter *waiter = user_data;
+
+    pthread_mutex_lock(&waiter->lock);
+    while (waiter->hold) {
+        pthread_cond_wait(&waiter->cond, &waiter->lock);
+    }
+    waiter->ret = ret;
+    waiter->completed++;
+    pthread_cond_broadcast(&waiter->cond);
+    pthread_mutex_unlock(&waiter->lock);
+}
+
+static int async_waiter_wait(struct async_waiter *waiter, int completed)
+{
+    int ret;
+
+    pthread_mutex_lock(&waiter->lock);
+    while (waiter->completed < completed) {
+        pthread_cond_wait(&waiter->cond, &waiter->lock);
+    }
+    ret = waiter->ret;
+    pthread_mutex_unlock(&waiter->lock);
+
+    return ret;
+}
+
+static struct ec_async_completion async_cq_wait(
+        struct ec_completion_queue *cq)
+{
+    struct ec_async_completion completion;
+    struct pollfd pfd = { .fd = ec_completion_queue_fd(cq),
+                          .events = POLLIN };
+
+    while (ec_completion_queue_poll(cq, &completion, 1) == 0) {
+        assert(poll(&pfd, 1, 10000) == 1);
+    }
+    return completion;
+}
+
+static void test_async_submit(const ec_backend_id_t be_id,
+                              struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    int orig_data_size = 64 * 1024 + 7;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **held_data = NULL, **held_parity = NULL;
+    uint64_t fragment_len = 0, held_len = 0;
+    char *frags[EC_MAX_FRAGMENTS];
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    char *out_frag = NULL;
+    struct ec_async_config config = { 2, 0, 0 };
+    struct async_waiter waiter = {
+        PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, false
+    };
+    struct ec_completion_queue *cq = NULL;
+    struct ec_async_done by_cb = { async_waiter_cb, NULL, &waiter };
+    struct ec_async_done by_cq = { NULL, NULL, &decoded_data };
+    struct ec_async_done both = { async_waiter_cb, NULL, &waiter };
+    struct ec_async_completion completion;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+    assert(0 == liberasurecode_async_configure(&config));
+
+    cq = ec_completion_queue_create();
+    assert(cq != NULL);
+    assert(ec_completion_queue_fd(cq) >= 0);
+    assert(0 == ec_completion_queue_poll(cq, &completion, 1));
+    by_cq.cq = cq;
+    both.cq = cq;
+
+    orig_data = create_buffer(orig_data_size, 'q');
+    assert(orig_data != NULL);
+
+    assert(-EINVALIDPARAMS == liberasurecode_submit_encode(desc, orig_data,
+            orig_data_size, &encoded_data, &encoded_parity, &fragment_len,
+            &both));
+    assert(-EBACKENDNOTAVAIL == liberasurecode_submit_encode(-1, orig_data,
+            orig_data_size, &encoded_data, &encoded_parity, &fragment_len,
+            &by_cb));
+
+    /* Encode, completing through a callback */
+    rc = liberasurecode_submit_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &fragment_len, &by_cb);
+    assert(0 == rc);
+    assert(0 == async_waiter_wait(&waiter, 1));
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? encoded_data[i] :
+                                   encoded_parity[i - args->k];
+    }
+
+    /* Decode without the first fragment, completing through the queue */
+    rc = liberasurecode_submit_decode(desc, frags + 1, num_fragments - 1,
+            fragment_len, 1, &decoded_data, &decoded_data_len, &by_cq);
+    assert(0 == rc);
+    completion = async_cq_wait(cq);
+    assert(completion.user_data == &decoded_data);
+    assert(0 == completion.ret);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    /* Rebuild the first fragment */
+    out_frag = malloc(fragment_len);
+    assert(out_frag != NULL);
+    rc = liberasurecode_submit_reconstruct(desc, frags + 1,
+            num_fragments - 1, fragment_len, 0, out_frag, &by_cq);
+    assert(0 == rc);
+    completion = async_cq_wait(cq);
+    assert(0 == completion.ret);
+    assert(memcmp(out_frag, frags[0], fragment_len) == 0);
+
+    /* One job per instance: a second one bounces while the first is held */
+    config.max_jobs_per_instance = 1;
+    assert(0 == liberasurecode_async_configure(&config));
+    waiter.hold = true;
+    while (-EAGAIN == (rc = liberasurecode_submit_encode(desc, orig_data,
+                orig_data_size, &held_data, &held_parity, &held_len,
+                &by_cb))) {
+        sched_yield();          /* last job may still be winding down */
+    }
+    assert(0 == rc);
+    rc = liberasurecode_submit_reconstruct(desc, frags + 1,
+            num_fragments - 1, fragment_len, 0, out_frag, &by_cq);
+    assert(-EAGAIN == rc);
+    pthread_mutex_lock(&waiter.lock);
+    waiter.hold = false;
+    pthread_cond_broadcast(&waiter.cond);
+    pthread_mutex_unlock(&waiter.lock);
+    assert(0 == async_waiter_wait(&waiter, 2));
+    liberasurecode_encode_cleanup(desc, held_data, held_parity);
+
+    /* The slot frees up once the completion has been delivered */
+    while (-EAGAIN == (rc = liberasurecode_submit_reconstruct(desc,
+                frags + 1, num_fragments - 1, fragment_len, 0, out_frag,
+                &by_cq))) {
+        sched_yield();
+    }
+    assert(0 == rc);
+    completion = async_cq_wait(cq);
+    assert(0 == completion.ret);
+
+    liberasurecode_async_shutdown();
+    config.max_jobs_per_instance = 0;
+    assert(0 == liberasurecode_async_configure(&config));
+    ec_completion_queue_destroy(cq);
+    free(out_frag);
+    free(orig_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_jerasure_rs_vand_simple_encode_decode_over32()
+{
+    struct ec_args over32_args = {
+        .k = 30,
+        .m = 20,
+    };
+
+    int *skip = create_skips_array(&over32_args, 1);
+    assert(skip != NULL);
+    // should return an error
+    encode_decode_test_impl(EC_BACKEND_JERASURE_RS_VAND,
+                            &over32_args, skip);
+    free(skip);
+}
+
+static void test_simple_reconstruct(const ec_backend_id_t be_id,
+                                    struct ec_args *args)
+{
+    int i = 0;
+    for (i = 0; i < args->k + args->m; i++) {
+        int *skip = create_skips_array(args,i);
+        assert(skip != NULL);
+        reconstruct_test_impl(be_id, args, skip);
+        free(skip);
+    }
+}
+
+static void test_fragments_needed(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    test_fragments_needed_impl(be_id, args);
+}
+
+static void test_verify_stripe_metadata(const ec_backend_id_t be_id,
+                                        struct ec_args *args)
+{
+    int orig_data_size = 1024;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **avail_frags = NULL;
+    uint64_t encoded_fragment_len = 0;
+    int rc = -1;
+    int num_avail_frags = -1;
+    int *skip = create_skips_array(args,-1);
+    char *orig_data = create_buffer(orig_data_size, 'x');
+    int desc = liberasurecode_instance_create(be_id, args);
+
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        free(orig_data);
+        free(skip);
+        return;
+    }
+    assert(desc > 0);
+
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+            encoded_parity, args, skip);
+
+    rc = liberasurecode_verify_stripe_metadata(desc, avail_frags,
+            num_avail_frags);
+    assert(0 == rc);
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+    free(skip);
+    free(avail_frags);
+}
+
+static void verify_fragment_metadata_mismatch_impl(const ec_backend_id_t be_id, struct ec_args *args,
+        fragment_mismatch_scenario_t scenario)
+{
+    int orig_data_size = 1024;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **avail_frags = NULL;
+    uint64_t encoded_fragment_len = 0;
+    int rc = -1;
+    int num_avail_frags = -1;
+    int i = 0;
+    uint32_t orig_libec_ver = 0;
+    uint32_t orig_be_ver = 0;
+    uint8_t orig_be_id = 0;
+    uint32_t orig_frag_idx = 0;
+    int *skip = create_skips_array(args,-1);
+    char *orig_data = create_buffer(orig_data_size, 'x');
+    int desc = liberasurecode_instance_create(be_id, args);
+
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        free(orig_data);
+        free(skip);
+        return;
+    }
+    assert(desc > 0);
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
             encoded_parity, args, skip);
     for (i = 0; i < num_avail_frags; i++) {
         char * cur_frag = avail_frags[i];
@@ -1840,6 +3965,402 @@ static void test_metadata_crcs_be()
     assert(is_invalid_fragment_header((fragment_header_t *) header) == 1);
 }
 
+/* The original byte loop behind liberasurecode_crc32_alt() */
+static int crc32_alt_bytewise(int crc, const unsigned char *buf, size_t size)
+{
+    int tab[256];
+    uint32_t c;
+    int n, k;
+
+    for (n = 0; n < 256; n++) {
+        c = n;
+        for (k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ 0xedb88320 : c >> 1;
+        }
+        tab[n] = (int) c;
+    }
+
+    crc = crc ^ ~0U;
+    while (size--) {
+        crc = tab[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ ~0U;
+}
+
+static void check_crc32(const unsigned char *buf, size_t size)
+{
+    size_t i, len, off;
+
+    srand(3);
+    for (i = 0; i < 96; i++) {
+        off = i % 16;
+        len = (i < 80) ? i : size - 16 - rand() % 1024;
+        assert(liberasurecode_crc32(0, buf + off, len) ==
+               crc32(0, buf + off, len));
+        assert(liberasurecode_crc32(liberasurecode_crc32(0, buf + off,
+                len / 3), buf + off + len / 3, len - len / 3) ==
+               crc32(0, buf + off, len));
+        assert(liberasurecode_crc32_alt(0, buf + off, len) ==
+               crc32_alt_bytewise(0, buf + off, len));
+        assert(liberasurecode_crc32_alt(liberasurecode_crc32_alt(0,
+                buf + off, len / 3), buf + off + len / 3, len - len / 3) ==
+               crc32_alt_bytewise(0, buf + off, len));
+    }
+}
+
+static void test_crc32()
+{
+    const size_t size = 64 * 1024 + 100;
+    unsigned char *buf = malloc(size);
+    struct ec_args args = { .k = 4, .m = 2, .hd = 3 };
+    size_t i;
+    int desc;
+
+    assert(buf != NULL);
+    assert(liberasurecode_crc32(0, "123456789", 9) == 0xcbf43926);
+    for (i = 0; i < size; i++) {
+        buf[i] = rand();
+    }
+    check_crc32(buf, size);
+
+    // Loading ISA-L switches the implementation over; results must not move
+    desc = liberasurecode_instance_create(EC_BACKEND_ISA_L_RS_VAND, &args);
+    if (desc > 0) {
+        assert(strcmp(liberasurecode_crc32_impl(), "isa-l") == 0);
+        check_crc32(buf, size);
+        liberasurecode_instance_destroy(desc);
+        check_crc32(buf, size);
+    }
+    free(buf);
+}
+
+static uint32_t crc32c_bitwise(uint32_t crc, const unsigned char *buf,
+                               size_t size)
+{
+    int k;
+
+    crc = ~crc;
+    while (size--) {
+        crc ^= *buf++;
+        for (k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static void test_crc32c()
+{
+    const size_t size = 3 * 8192 * 2 + 3 * 256 + 100;
+    unsigned char *buf = malloc(size + 8);
+    size_t i, len, off;
+    uint32_t crc;
+
+    assert(buf != NULL);
+    assert(liberasurecode_crc32c_impl() != NULL);
+
+    assert(liberasurecode_crc32c(0, "", 0) == 0);
+    assert(liberasurecode_crc32c(0, "123456789", 9) == 0xe3069283);
+    memset(buf, 0, 32);
+    assert(liberasurecode_crc32c(0, buf, 32) == 0x8a9136aa);
+    memset(buf, 0xff, 32);
+    assert(liberasurecode_crc32c(0, buf, 32) == 0x62a8ab43);
+
+    srand(4);
+    for (i = 0; i < size + 8; i++) {
+        buf[i] = rand();
+    }
+
+    // Cover every path of the interleaved loop, at every alignment
+    for (i = 0; i < 64; i++) {
+        off = i % 8;
+        len = (i < 32) ? i : size - rand() % 1024;
+        if (i == 63) {
+            len = size;
+        }
+        crc = crc32c_bitwise(0, buf + off, len);
+        assert(liberasurecode_crc32c(0, buf + off, len) == crc);
+        // and chained across an arbitrary split
+        assert(liberasurecode_crc32c(liberasurecode_crc32c(0, buf + off,
+                len / 3), buf + off + len / 3, len - len / 3) == crc);
+    }
+    free(buf);
+}
+
+static void test_chksum_mismatch(const ec_backend_id_t be_id,
+                                 struct ec_args *args)
+{
+    int i, rc, desc;
+    int orig_data_size = 4096;
+    char *orig_data = NULL, *decoded_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **avail_frags = NULL;
+    uint64_t encoded_fragment_len = 0, decoded_data_len = 0;
+    fragment_metadata_t metadata;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+
+    for (i = 0; i < args->k; i++) {
+        char *data = get_data_ptr_from_fragment(encoded_data[i]);
+
+        rc = liberasurecode_get_fragment_metadata(encoded_data[i], &metadata);
+        assert(rc == 0);
+        assert(metadata.chksum_type == args->ct);
+        assert(metadata.chksum_mismatch == 0);
+        validate_fragment_checksum(args, &metadata, data);
+
+        data[metadata.size / 2] ^= 0x01;
+        rc = liberasurecode_get_fragment_metadata(encoded_data[i], &metadata);
+        assert(rc == 0);
+        assert(metadata.chksum_mismatch == 1);
+        validate_fragment_checksum(args, &metadata, data);
+        data[metadata.size / 2] ^= 0x01;
+    }
+
+    // A checked decode must refuse k fragments when one of them is bad
+    avail_frags = malloc(sizeof(char *) * (args->k + args->m));
+    assert(avail_frags != NULL);
+    for (i = 0; i < args->k; i++) {
+        avail_frags[i] = encoded_data[i];
+    }
+    for (i = 0; i < args->m; i++) {
+        avail_frags[args->k + i] = encoded_parity[i];
+    }
+    rc = liberasurecode_decode(desc, avail_frags, args->k + args->m,
+            encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(rc == 0);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    // Leave out a data fragment so that a real decode (and check) runs
+    avail_frags[0] = encoded_parity[0];
+    get_data_ptr_from_fragment(avail_frags[1])[7] ^= 0x80;
+    rc = liberasurecode_decode(desc, avail_frags, args->k,
+            encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(rc == -EINSUFFFRAGS);
+    get_data_ptr_from_fragment(avail_frags[1])[7] ^= 0x80;
+
+    free(avail_frags);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+/*
+ * Releases before 1.7.0 took CHKSUM_MD5 but stored an all-zero digest;
+ * their fragments must still read back and decode as unchecked.
+ */
+static void test_legacy_md5_fragments(const ec_backend_id_t be_id,
+                                      struct ec_args *args)
+{
+    int i, rc, desc;
+    int num_fragments = args->k + args->m;
+    int orig_data_size = 4096;
+    char *orig_data = NULL, *decoded_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t encoded_fragment_len = 0, decoded_data_len = 0;
+    uint64_t bad = ~0ULL;
+    fragment_metadata_t metadata;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+
+    for (i = 0; i < num_fragments; i++) {
+        fragment_header_t *header;
+
+        frags[i] = (i < args->k) ? encoded_data[i] :
+                                   encoded_parity[i - args->k];
+        header = (fragment_header_t *) frags[i];
+        memset(header->meta.chksum, 0, sizeof(header->meta.chksum));
+        header->libec_version = (1 << 16) | (6 << 8);
+        /* the metadata sits at the head of the header */
+        header->metadata_chksum = liberasurecode_crc32(0, frags[i],
+                sizeof(fragment_metadata_t));
+    }
+
+    for (i = 0; i < num_fragments; i++) {
+        rc = liberasurecode_get_fragment_metadata(frags[i], &metadata);
+        assert(rc == 0);
+        assert(metadata.chksum_type == CHKSUM_MD5);
+        assert(metadata.chksum_mismatch == 0);
+    }
+
+    rc = liberasurecode_verify_stripe_payloads(desc, frags, num_fragments,
+                                               &bad);
+    assert(0 == rc);
+    assert(0 == bad);
+
+    // Leave out a data fragment so that a real, checked decode runs
+    rc = liberasurecode_decode(desc, frags + 1, num_fragments - 1,
+            encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(rc == 0);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_verify_stripe_payloads(const ec_backend_id_t be_id,
+                                        struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1, single_desc = -1;
+    int num_fragments = args->k + args->m;
+    int orig_data_size = 2 * 1024 * 1024 + 7;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *frags[EC_MAX_FRAGMENTS];
+    uint64_t fragment_len = 0;
+    uint64_t bad = 0, expected = 0;
+    struct ec_args threaded_args = *args;
+
+    threaded_args.num_threads = 4;
+    desc = liberasurecode_instance_create(be_id, &threaded_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    } else if ((args->k + args->m) > EC_MAX_FRAGMENTS) {
+        assert(-EINVALIDPARAMS == desc);
+        return;
+    }
+    assert(desc > 0);
+    single_desc = liberasurecode_instance_create(be_id, args);
+    assert(single_desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char) (i * 7 + (i >> 11));
+    }
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &fragment_len);
+    assert(0 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        frags[i] = (i < args->k) ? encoded_data[i] :
+                                   encoded_parity[i - args->k];
+    }
+
+    /* checksums set on the pool must hold up on a single thread too */
+    rc = liberasurecode_verify_stripe_payloads(desc, frags, num_fragments,
+                                               &bad);
+    assert(0 == rc);
+    assert(0 == bad);
+    bad = ~0ULL;
+    rc = liberasurecode_verify_stripe_payloads(single_desc, frags,
+                                               num_fragments, &bad);
+    assert(0 == rc);
+    assert(0 == bad);
+
+    /* damage a data payload, the last parity payload and one header */
+    get_data_ptr_from_fragment(frags[0])[fragment_len / 3] ^= 0x10;
+    expected |= 1ULL << 0;
+    get_data_ptr_from_fragment(frags[num_fragments - 1])[5] ^= 0x01;
+    expected |= 1ULL << (num_fragments - 1);
+    if (num_fragments > 2) {
+        ((fragment_header_t *) frags[1])->meta.orig_data_size ^= 1;
+        expected |= 1ULL << 1;
+    }
+
+    rc = liberasurecode_verify_stripe_payloads(desc, frags, num_fragments,
+                                               &bad);
+    assert(0 == rc);
+    assert(expected == bad);
+    rc = liberasurecode_verify_stripe_payloads(single_desc, frags,
+                                               num_fragments, &bad);
+    assert(0 == rc);
+    assert(expected == bad);
+
+    /* fewer fragments than workers: CRCs get split and combined */
+    rc = liberasurecode_verify_stripe_payloads(desc,
+            frags + num_fragments - 1, 1, &bad);
+    assert(0 == rc);
+    assert(1 == bad);
+    get_data_ptr_from_fragment(frags[num_fragments - 1])[5] ^= 0x01;
+    rc = liberasurecode_verify_stripe_payloads(desc,
+            frags + num_fragments - 1, 1, &bad);
+    assert(0 == rc);
+    assert(0 == bad);
+
+    free(orig_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(0 == liberasurecode_instance_destroy(single_desc));
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+static void test_md5()
+{
+    static const char *vectors[][2] = {
+        { "", "d41d8cd98f00b204e9800998ecf8427e" },
+        { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+        { "12345678901234567890123456789012345678901234567890123456789012"
+          "345678901234567890", "57edf4a22be3c955ac49da2e2107b67a" },
+    };
+    const size_t size = 3 * 4096 + 77;
+    const void *bufs[17];
+    uint32_t digests[17][4], digest[4];
+    unsigned char *buf = malloc(size + 17);
+    char hex[33];
+    size_t i, len;
+    int j, n;
+
+    assert(buf != NULL);
+    assert(liberasurecode_md5_impl() != NULL);
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        liberasurecode_md5(vectors[i][0], strlen(vectors[i][0]), digest);
+        for (j = 0; j < 16; j++) {
+            sprintf(hex + 2 * j, "%02x",
+                    (digest[j / 4] >> (8 * (j % 4))) & 0xff);
+        }
+        assert(strcmp(hex, vectors[i][1]) == 0);
+    }
+
+    for (i = 0; i < size + 17; i++) {
+        buf[i] = rand();
+    }
+
+    // Every lane count and every padding case must match the scalar MD5
+    for (n = 1; n <= 17; n++) {
+        for (len = 0; len <= size; len += (len < 130) ? 1 : 4093) {
+            for (j = 0; j < n; j++) {
+                bufs[j] = buf + j;
+            }
+            liberasurecode_md5_mb(bufs, n, len, digests);
+            for (j = 0; j < n; j++) {
+                liberasurecode_md5(bufs[j], len, digest);
+                assert(memcmp(digests[j], digest, sizeof(digest)) == 0);
+            }
+        }
+    }
+    free(buf);
+}
+
 //static void test_verify_str
 
 /* An individual test, useful to ensure the reported name
@@ -1849,6 +4370,25 @@ static void test_metadata_crcs_be()
 #define TEST_SUITE(backend) \
     TEST(test_create_and_destroy_backend,               backend, CHKSUM_NONE), \
     TEST(test_simple_encode_decode,                     backend, CHKSUM_NONE), \
+    TEST(test_encode_into,                              backend, CHKSUM_CRC32), \
+    TEST(test_encode_iov,                               backend, CHKSUM_CRC32), \
+    TEST(test_decode_into,                              backend, CHKSUM_NONE), \
+    TEST(test_decode_iov,                               backend, CHKSUM_NONE), \
+    TEST(test_encode_slab,                              backend, CHKSUM_CRC32), \
+    TEST(test_buffer_pool,                              backend, CHKSUM_CRC32), \
+    TEST(test_payload_align,                            backend, CHKSUM_CRC32), \
+    TEST(test_encode_reused_buffers,                    backend, CHKSUM_CRC32), \
+    TEST(test_encode_decode_batch,                      backend, CHKSUM_CRC32), \
+    TEST(test_stream_encoder,                           backend, CHKSUM_CRC32), \
+    TEST(test_stream_decoder,                           backend, CHKSUM_CRC32), \
+    TEST(test_decode_range,                             backend, CHKSUM_NONE), \
+    TEST(test_decode_unaligned,                         backend, CHKSUM_CRC32), \
+    TEST(test_encode_decode_threads,                    backend, CHKSUM_CRC32), \
+    TEST(test_encode_tiled,                             backend, CHKSUM_CRC32), \
+    TEST(test_encode_tiled,                             backend, CHKSUM_CRC32C), \
+    TEST(test_async_submit,                             backend, CHKSUM_CRC32), \
+    TEST(test_decode_with_plan,                         backend, CHKSUM_CRC32), \
+    TEST(test_reconstruct_fragments,                    backend, CHKSUM_CRC32), \
     TEST(test_decode_with_missing_data,                 backend, CHKSUM_NONE), \
     TEST(test_decode_with_missing_parity,               backend, CHKSUM_NONE), \
     TEST(test_decode_with_missing_multi_data,           backend, CHKSUM_NONE), \
@@ -1858,6 +4398,14 @@ static void test_metadata_crcs_be()
     TEST(test_fragments_needed,                         backend, CHKSUM_NONE), \
     TEST(test_get_fragment_metadata,                    backend, CHKSUM_NONE), \
     TEST(test_get_fragment_metadata,                    backend, CHKSUM_CRC32), \
+    TEST(test_get_fragment_metadata,                    backend, CHKSUM_CRC32C), \
+    TEST(test_get_fragment_metadata,                    backend, CHKSUM_MD5), \
+    TEST(test_chksum_mismatch,                          backend, CHKSUM_CRC32C), \
+    TEST(test_chksum_mismatch,                          backend, CHKSUM_MD5), \
+    TEST(test_legacy_md5_fragments,                     backend, CHKSUM_MD5), \
+    TEST(test_verify_stripe_payloads,                   backend, CHKSUM_CRC32), \
+    TEST(test_verify_stripe_payloads,                   backend, CHKSUM_CRC32C), \
+    TEST(test_verify_stripe_payloads,                   backend, CHKSUM_MD5), \
     TEST(test_verify_stripe_metadata,                   backend, CHKSUM_CRC32), \
     TEST(test_verify_stripe_metadata_libec_mismatch,    backend, CHKSUM_CRC32), \
     TEST(test_verify_stripe_metadata_magic_mismatch,    backend, CHKSUM_CRC32), \
@@ -1869,19 +4417,28 @@ struct testcase testcases[] = {
     TEST(test_backend_available_invalid_args, EC_BACKENDS_MAX, 0),
     TEST(test_backend_available, EC_BACKEND_NULL, 0),
     TEST(test_create_backend_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST(test_create_backend_legacy_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_destroy_backend_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_encode_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST(test_encode_into_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_encode_cleanup_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_decode_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_decode_cleanup_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST(test_get_pool_stats_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST(test_instance_descriptors, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST(test_destroy_while_encoding, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_reconstruct_fragment_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_get_fragment_metadata_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_verify_stripe_metadata_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST(test_verify_stripe_payloads_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_fragments_needed_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_get_fragment_partition, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_liberasurecode_get_version, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_metadata_crcs_le, EC_BACKENDS_MAX, 0),
     TEST(test_metadata_crcs_be, EC_BACKENDS_MAX, 0),
+    TEST(test_crc32, EC_BACKENDS_MAX, 0),
+    TEST(test_crc32c, EC_BACKENDS_MAX, 0),
+    TEST(test_md5, EC_BACKENDS_MAX, 0),
     // NULL backend test
     TEST(test_create_and_destroy_backend, EC_BACKEND_NULL, CHKSUM_NONE),
     TEST(test_simple_encode_decode, EC_BACKEND_NULL, CHKSUM_NONE),